@@ -0,0 +1,54 @@
+cbuffer animatedMeshBuffer : register(b0)
+{
+    float4x4 W;
+    float4x4 VP;
+    float4 bones[512]; // per bone a rotation quaternion then its dual part, 32 bytes instead of 64
+};
+struct VS_INPUT
+{
+    float4 Pos : POSITION;
+    float3 Normal : NORMAL;
+    float3 Tangent : TANGENT;
+    float2 TexCoords : TEXCOORD;
+    uint4 BoneIDs : BONEIDS;
+    float4 BoneWeights : BONEWEIGHTS;
+};
+struct PS_INPUT
+{
+    float4 Pos : SV_POSITION;
+    float3 Normal : NORMAL;
+    float3 Tangent : TANGENT;
+    float2 TexCoords : TEXCOORD;
+};
+float3 rotate(float4 q, float3 v)
+{
+    return v + 2.0f * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+PS_INPUT VS(VS_INPUT input)
+{
+    PS_INPUT output;
+    // dual quaternion linear blend, each bone flipped onto the first one's hemisphere
+    float4 real0 = bones[input.BoneIDs[0] * 2];
+    float4 real = real0 * input.BoneWeights[0];
+    float4 dual = bones[input.BoneIDs[0] * 2 + 1] * input.BoneWeights[0];
+    for (int i = 1; i < 4; i++)
+    {
+        float4 r = bones[input.BoneIDs[i] * 2];
+        float w = dot(real0, r) < 0.0f ? -input.BoneWeights[i] : input.BoneWeights[i];
+        real += r * w;
+        dual += bones[input.BoneIDs[i] * 2 + 1] * w;
+    }
+    float len = length(real);
+    real /= len;
+    dual /= len;
+    float3 translation = 2.0f * (real.w * dual.xyz - dual.w * real.xyz + cross(real.xyz, dual.xyz));
+    output.Pos = float4(rotate(real, input.Pos.xyz) + translation, 1.0f);
+    output.Pos = mul(output.Pos, W);
+    output.Pos = mul(output.Pos, VP);
+    output.Normal = mul(rotate(real, input.Normal), (float3x3) W);
+    output.Normal = normalize(output.Normal);
+    output.Tangent = mul(rotate(real, input.Tangent), (float3x3) W);
+    output.Tangent = normalize(output.Tangent);
+    output.TexCoords = input.TexCoords;
+    return output;
+}
@@ -0,0 +1,41 @@
+cbuffer animatedMeshBuffer : register(b0)
+{
+    float4x4 W;
+    float4x4 VP;
+    row_major float3x4 bones[256]; // top three rows of each bone, 48 bytes instead of 64
+};
+struct VS_INPUT
+{
+    float4 Pos : POSITION;
+    float3 Normal : NORMAL;
+    float3 Tangent : TANGENT;
+    float2 TexCoords : TEXCOORD;
+    uint4 BoneIDs : BONEIDS;
+    float4 BoneWeights : BONEWEIGHTS;
+};
+struct PS_INPUT
+{
+    float4 Pos : SV_POSITION;
+    float3 Normal : NORMAL;
+    float3 Tangent : TANGENT;
+    float2 TexCoords : TEXCOORD;
+};
+PS_INPUT VS(VS_INPUT input)
+{
+    PS_INPUT output;
+    float3x4 transform = bones[input.BoneIDs[0]] * input.BoneWeights[0];
+    transform += bones[input.BoneIDs[1]] * input.BoneWeights[1];
+    transform += bones[input.BoneIDs[2]] * input.BoneWeights[2];
+    transform += bones[input.BoneIDs[3]] * input.BoneWeights[3];
+    output.Pos = float4(mul(transform, float4(input.Pos.xyz, 1.0f)), 1.0f);
+    output.Pos = mul(output.Pos, W);
+    output.Pos = mul(output.Pos, VP);
+    output.Normal = mul((float3x3) transform, input.Normal);
+    output.Normal = mul(output.Normal, (float3x3) W);
+    output.Normal = normalize(output.Normal);
+    output.Tangent = mul((float3x3) transform, input.Tangent);
+    output.Tangent = mul(output.Tangent, (float3x3) W);
+    output.Tangent = normalize(output.Tangent);
+    output.TexCoords = input.TexCoords;
+    return output;
+}
@@ -4,8 +4,14 @@
 #include "Mesh.h"
 #include "Window.h"
 #include "Animation.h"
+#include "AnimationLOD.h"
+#include "PaletteAtlas.h"
+#include "BonePalette.h"
+#include "Transform.h"
 #include "EventBus.h"
+#include "JobSystem.h"
 #include <memory>
+#include <unordered_set>
 
 
 #define PLAYER_WALK_SPEED 6.0f
@@ -22,7 +28,7 @@ protected:
 
 public:
 	Vec3 position = Vec3(0.0f, 0.0f, 0.0f);
-	Vec4 rotation = Vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	Quat rotation;
 	Vec3 scale = Vec3(1.0f, 1.0f, 1.0f);
 	Mat4 worldMatrix;
 
@@ -32,29 +38,129 @@ public:
 	Vec3 up = Vec3(0.0f, 1.0f, 0.0f);
 
 	int type = 0;
+
+	// animation LOD, assigned by ActorList::updateAnimationLOD
+	int lodTier = 0;
+	int animationInterval = 1;
+	int animationFrame = 0;
+	float animationTime = 0.0f;	// time accumulated since the last pose update
+	bool animationUpdated = false;
+
+	// layout the bones are uploaded in, set through setPaletteFormat so the meshes use the matching PSO
+	PaletteFormat paletteFormat = PALETTE_MAT4;
+	BonePalette palette;	// draw's packed bones, kept so the buffer is only allocated once per actor
 	
 	virtual void init(Object* obj) {
 		object = obj;
 		sequencer = Sequencer();
-		sequencer.addAllAnimations(&object->animation, 0.0f, 0.0f, 1.0f);
+		sequencer.addAllAnimations(&object->model->animation, 0.0f, 0.0f, 1.0f);
 		stateMachine = StateMachine(&sequencer);
 	}
 
 	void updateWorldMatrix() {
-		Mat4 t = Mat4().Translate(position.v[0], position.v[1], position.v[2]);
-		Mat4 r = Mat4().rotationQuaternion(rotation.v[0], rotation.v[1], rotation.v[2], rotation.v[3]);
-		Mat4 s = Mat4().Scale(scale.v[0], scale.v[1], scale.v[2]);
 		object->updateWorldMatrix();
-		worldMatrix = t * r * s * object->worldMatrix;
+		Mat4::multiplyAffine(composeTRS(position, rotation, scale), object->worldMatrix, worldMatrix);
+	}
+
+	// Batched path used by ActorList: two entries per actor, the object's TRS then the actor's own
+	void addTransforms(TransformBatch& batch) const {
+		batch.add(object->position, object->rotation, object->scale);
+		batch.add(position, rotation, scale);
+	}
+
+	void setWorldMatrix(const Mat4& objectMatrix, const Mat4& actorMatrix) {
+		object->worldMatrix = objectMatrix;
+		Mat4::multiplyAffine(actorMatrix, objectMatrix, worldMatrix);
 	}
 
 	Mat4* getWorldMatrix() {
 		return &worldMatrix;
 	}
 
+	// phase spreads actors sharing an interval over different frames
+	void setAnimationLOD(int tier, int interval, const PoseDetail& detail, int phase) {
+		lodTier = tier;
+		animationInterval = interval < 1 ? 1 : interval;
+		animationFrame = phase % animationInterval;
+		sequencer.detail = detail;
+	}
+
+	void setPoseCache(PoseCache* cache) {
+		sequencer.poseCache = cache;
+	}
+
+	// (clip, frame, blend) of the strongest clip, for drawing from a PaletteAtlas baked from this
+	// actor's animation instead of uploading its bones
+	PaletteAtlas::Sample atlasSample(const PaletteAtlas& atlas) {
+		PaletteAtlas::Sample none = { 0, 0, 0.0f };
+		int i = sequencer.dominantItem();
+		if (i < 0 || atlas.clips.empty()) return none;
+		const Sequencer::Item& item = sequencer.items[i];
+		// atlas clips follow the animation's map order, the same as the clip handles
+		if (item.clip < 0 || item.clip >= (int)atlas.clips.size()) return none;
+		return atlas.lookup(item.clip, item.animationInstance.t);
+	}
+
+	// shared with every actor whose object came from the same ModelCache entry
+	Animation* getAnimation() {
+		return &object->model->animation;
+	}
+
+	int frozenBones() {
+		return getAnimation()->frozenBones(sequencer.detail);
+	}
+
+	// Frees clips nobody has played on this actor's animation since the last call, see
+	// Animation::evictUnused. Actors can share an animation, so call it once per animation.
+	int evictUnusedClips() {
+		return getAnimation()->evictUnused();
+	}
+
+	size_t animationKeyBytes() const {
+		return object->model->animation.keyBytes();
+	}
+
+	// loads the clips the next updateAnimation can play, see StateMachine::useClips
+	void useClips() {
+		stateMachine.useClips();
+	}
+
+	// Model space bounds of the current pose: the baked segment of every clip with weight, merged and
+	// grown by blendMargin while clips cross fade, or the bind pose before any clip plays. Clips are
+	// baked on first use, so call it from one thread.
+	Bounds localBounds() {
+		Bounds result;
+		int clips = 0;
+		AnimatedBounds& bounds = object->model->bounds;
+		for (const Sequencer::Item& item : sequencer.items) {
+			if (item.weight <= 0.0f || sequencer.globalTime < item.startTime) continue;
+			result.merge(bounds.at(object->model->animation, item.clip, item.animationInstance.t));
+			clips++;
+		}
+		if (result.empty()) return bounds.bindBounds;
+		if (clips > 1)
+			result.grow(bounds.blendMargin * bounds.bindBounds.radius);
+		return result;
+	}
+
+	// localBounds placed by the last world matrix
+	Bounds worldBounds() {
+		return localBounds().transformed(worldMatrix);
+	}
+
+	// runs the state machine every animationInterval frames with the time accumulated in between
+	void updateAnimation(float dt) {
+		animationTime += dt;
+		animationUpdated = false;
+		if (++animationFrame < animationInterval) return;
+		animationFrame = 0;
+		stateMachine.update(animationTime);
+		animationTime = 0.0f;
+		animationUpdated = true;
+	}
+
 	virtual void update(float dt) {
-		// Update object
-		updateWorldMatrix();
+		// world matrix is built afterwards by ActorList::updateWorldMatrices
 		// check forward vector length
 		if (forward.getLength() == 0.0f) {
 			forward = Vec3(0.0f, 0.0f, 1.0f);
@@ -87,9 +193,26 @@ public:
 		return sequencer.getBoneMatrices();
 	}
 
+	static const char* palettePSO(PaletteFormat format) {
+		switch (format) {
+		case PALETTE_MAT3X4: return "animated3x4PSO";
+		case PALETTE_DUAL_QUAT: return "animatedDualQuatPSO";
+		default: return "animatedPSO";
+		}
+	}
+
+	// call after init, PALETTE_DUAL_QUAT needs rigid bones (BonePalette::isRigid)
+	void setPaletteFormat(PaletteFormat format) {
+		paletteFormat = format;
+		object->setPSOName(palettePSO(format));
+	}
+
 	virtual void draw(Core* core) {
-		object->psoManager->getShader("animatedPSO")->updateConstantBuffer("animatedMeshBuffer", "bones", getBoneMatrices(), VERTEX_SHADER);
-		object->psoManager->getShader("animatedPSO")->updateConstantBuffer("animatedMeshBuffer", "W", getWorldMatrix(), VERTEX_SHADER);
+		// only the skeleton's bones are copied, the rest of the shader's 256 slots are never indexed
+		palette.pack(getBoneMatrices(), sequencer.boneCount(), paletteFormat);
+		Shader* shader = object->psoManager->getShader(palettePSO(paletteFormat));
+		shader->updateConstantBuffer("animatedMeshBuffer", "bones", palette.bytes(), palette.sizeInBytes(), VERTEX_SHADER);
+		shader->updateConstantBuffer("animatedMeshBuffer", "W", getWorldMatrix(), VERTEX_SHADER);
 		object->draw(core);
 	}
 };
@@ -104,6 +227,14 @@ private:
 
 	bool isCatching = false;
 
+	// state handles, resolved in init
+	int idleState = -1;
+	int idleCarryState = -1;
+	int walkState = -1;
+	int walkCarryState = -1;
+	int runState = -1;
+	int grabState = -1;
+
 public:
 	Player(Window* window) : win(window) {
 		Sequencer sequencer;
@@ -111,8 +242,17 @@ public:
 
 	void init(Object* obj) override {
 		Actor::init(obj);
+		idleState = stateMachine.findState("idle basic 01");
+		idleCarryState = stateMachine.findState("idle basic 02");
+		walkState = stateMachine.findState("walk");
+		walkCarryState = stateMachine.findState("walk carry");
+		runState = stateMachine.findState("run");
+		grabState = stateMachine.findState("grab low");
+		// blend times into each state, everything else uses the default 0.2 s
+		stateMachine.setTransitionTime(runState, 0.3f);
+		stateMachine.setTransitionTime(grabState, 0.1f);
 		//set initial state
-		stateMachine.setCurrentState("idle basic 01");
+		stateMachine.setCurrentState(idleState);
 	}
 
 	void bindCamera(Camera* cam) {
@@ -127,23 +267,23 @@ public:
 
 		// change state based on speed
 		if (speed > PLAYER_WALK_SPEED) {
-			stateMachine.transitionTo("run", 0.3f);
+			stateMachine.transitionTo(runState);
 		}
 		else if (speed > 0.1f) {
 			if (isCatching)
-				stateMachine.transitionTo("walk carry", 0.2f);
+				stateMachine.transitionTo(walkCarryState);
 			else
-				stateMachine.transitionTo("walk", 0.2f);
+				stateMachine.transitionTo(walkState);
 		}
 		else {
 			if (isCatching)
-				stateMachine.transitionTo("idle basic 02", 0.2f);
+				stateMachine.transitionTo(idleCarryState);
 			else
-				stateMachine.transitionTo("idle basic 01", 0.2f);
+				stateMachine.transitionTo(idleState);
 		}
 		
 		//update animation
-		stateMachine.update(dt);
+		updateAnimation(dt);
 
 		updateWorldMatrix();
 	}
@@ -172,7 +312,7 @@ public:
 			if (forward.normalize_GetLength() == 0.0f) forward = Vec3(0.0f, 0.0f, 1.0f);
 			forward = forward.normalize();
 			Vec4 rot = quatFromTo(Vec3(0.0f, 0.0f, 1.0f), forward);
-			rotation = slerp(rotation, rot, dt * 10.0f);
+			rotation = Quat::slerp(rotation, rot, dt * 10.0f).normalize();
 		}
 		else {
 			speed -= 50.0f * dt;
@@ -189,7 +329,7 @@ public:
 				catchEvent.catchPosition = position;
 				catchEvent.playerForward = forward;
 				eventBus->queue<PlayerCatchEvent>(catchEvent);
-				stateMachine.transitionTo("grab low", 0.1f);
+				stateMachine.transitionTo(grabState);
 				stateMachine.sequencer->resetTime();
 				eKeyPressed = true;	
 			}
@@ -207,7 +347,7 @@ public:
 				releaseEvent.releasePosition = position;
 				releaseEvent.playerForward = forward;
 				eventBus->queue<PlayerReleaseEvent>(releaseEvent);
-				stateMachine.transitionTo("grab low", 0.1f);
+				stateMachine.transitionTo(grabState);
 				stateMachine.sequencer->resetTime();
 				qKeyPressed = true;
 			}
@@ -236,12 +376,24 @@ private:
 	bool isScared = false;
 	bool isCatched = false;
 
+	// state handles, resolved in init
+	int idleState = -1;
+	int runState = -1;
+	int caughtState = -1;
+
 public:
 
 	void init(Object* obj) override {
 		Actor::init(obj);
+		idleState = stateMachine.findState("idle");
+		runState = stateMachine.findState("run forward");
+		caughtState = stateMachine.findState("swim eating");
+		// slow settle into idle, quick start when scared or caught
+		stateMachine.setTransitionTime(idleState, 1.0f);
+		stateMachine.setTransitionTime(runState, 0.1f);
+		stateMachine.setTransitionTime(caughtState, 0.1f);
 		//set initial state
-		stateMachine.setCurrentState("idle");
+		stateMachine.setCurrentState(idleState);
 	}
 
 	void setPlayer(Player* p) {
@@ -275,7 +427,7 @@ public:
 				if (dir.Dot(forward) < 0.0f)
 					forward = dir;
 				Vec4 rot = quatFromTo(Vec3(0.0f, 0.0f, 1.0f), forward);
-				rotation = slerp(rotation, rot, dt * 10.0f);
+				rotation = Quat::slerp(rotation, rot, dt * 10.0f).normalize();
 			}
 			else{
 				speed -= 10.0f * dt;
@@ -283,10 +435,10 @@ public:
 			}
 			// change state based on speed
 			if (speed > 0.0f) {
-				stateMachine.transitionTo("run forward", 0.1f);
+				stateMachine.transitionTo(runState);
 			}
 			else {
-				stateMachine.transitionTo("idle", 1.0f);
+				stateMachine.transitionTo(idleState);
 			}
 			catchEventSent = false;
 		}
@@ -304,9 +456,7 @@ public:
 					catchEventSent = true;
 				}
 			}
-		
-		//update animation
-		stateMachine.update(dt);
+		// animation runs afterwards in ActorList's pose pass
 		Actor::update(dt);
 	}
 
@@ -345,7 +495,7 @@ public:
 						// Hen is caught
 						isCatched = true;
 							speed = 0.0f;
-							stateMachine.transitionTo("swim eating", 0.1f);
+							stateMachine.transitionTo(caughtState);
 							object->position += Vec3(0.0f, 0.0f, 1.0f); // raise hen above player
 						}
 					}
@@ -361,7 +511,7 @@ public:
 					position.v[1] = 0.0f; // keep on ground
 					isCatched = false;
 					isScared = true;
-					stateMachine.transitionTo("run forward", 0.1f);
+					stateMachine.transitionTo(runState);
 					object->position -= Vec3(0.0f, 0.0f, 1.0f); // raise hen above player
 				}
 			}
@@ -374,22 +524,101 @@ public:
 class ActorList {
 public:
 	std::vector<Actor*> actors;
+	TransformBatch transforms;
+	AnimationLOD animationLOD;
+	PoseCache poseCache;	// palettes shared between actors in the same clip and phase
+	float clipEvictionInterval = 10.0f;	// seconds between evictions of clips nobody played, 0 to keep them
+	JobSystem* jobs = nullptr;	// optional, spreads the pose and world matrix passes over its threads
+	int actorsPerJob = 16;		// chunk size handed to a thread, kept even (see updateWorldMatrices)
 
 	int numActors = 0;
 
 	ActorList() {}
 
 	void addActor(Actor* actor) {
+		actor->setPoseCache(&poseCache);
 		actors.push_back(actor);
 		numActors++;
 	}
 
+	// picks every actor's animation tier from the camera and its bounds, call before update
+	void updateAnimationLOD(const Camera& camera) {
+		for (int i = 0; i < (int)actors.size(); i++) {
+			Bounds bounds = actors[i]->worldBounds();
+			int tier = bounds.empty() ? animationLOD.selectTier(camera, actors[i]->position)
+				: animationLOD.selectTier(camera, bounds.center, bounds.radius);
+			if (tier != actors[i]->lodTier) {
+				const AnimationLODTier& t = animationLOD.tiers[tier];
+				actors[i]->setAnimationLOD(tier, t.updateInterval, t.detail, i);
+			}
+		}
+	}
+
+	// Three phases: gameplay for every actor in list order on this thread, so events are queued in the
+	// same order every run, along with loading the clips the poses need; then poses, which only touch
+	// their own actor, the pose cache and their animation's pose pool, split over the job system; then
+	// world matrices. Results don't depend on the thread count.
 	void update(float dt) {
+		poseCache.resetCounters();
+		poseCache.trim();
 		for (auto& actor : actors) {
 			actor->update(dt);
+			actor->useClips();
+		}
+		forEachRange([&](int begin, int end) {
+			for (int i = begin; i < end; i++)
+				actors[i]->updateAnimation(dt);
+		});
+		updateWorldMatrices();
+		clipEvictionTimer += dt;
+		if (clipEvictionInterval > 0.0f && clipEvictionTimer >= clipEvictionInterval) {
+			clipEvictionTimer = 0.0f;
+			// once per animation, a second call would find its clips just unmarked and evict them all
+			std::unordered_set<Animation*> evicted;
+			for (auto& actor : actors)
+				if (evicted.insert(actor->getAnimation()).second)
+					actor->evictUnusedClips();
+		}
+		// tally the animation work per tier
+		animationLOD.resetCounters();
+		for (auto& actor : actors) {
+			AnimationLODCounters& c = animationLOD.counters[actor->lodTier];
+			c.actors++;
+			if (actor->animationUpdated) {
+				c.updates++;
+				c.frozenBones += actor->frozenBones();
+			}
+			else {
+				c.skipped++;
+			}
 		}
 	}
 
+	// World matrices of every actor and its object, batched compose passes over ranges of actors. Even
+	// range starts keep the same transforms in the same SIMD groups of four as one serial build.
+	void updateWorldMatrices() {
+		transforms.clear();
+		for (auto& actor : actors)
+			actor->addTransforms(transforms);
+		transforms.matrices.resize(transforms.size());
+		forEachRange([&](int begin, int end) {
+			transforms.build(2 * begin, 2 * end);
+			for (int i = begin; i < end; i++)
+				actors[i]->setWorldMatrix(transforms.matrices[2 * i], transforms.matrices[2 * i + 1]);
+		});
+	}
+
+	// work(begin, end) over the actors, on the job system when there is one
+	template<typename Work>
+	void forEachRange(Work work) {
+		int count = (int)actors.size();
+		if (jobs == nullptr) {
+			work(0, count);
+			return;
+		}
+		jobs->parallelFor(count, (actorsPerJob + 1) & ~1, work);
+	}
+
 	void draw(Core* core) {
 		for (auto& actor : actors) {
 			actor->draw(core);
@@ -416,4 +645,7 @@ public:
 		actors.clear();
 		numActors = 0;
 	}
+
+private:
+	float clipEvictionTimer = 0.0f;
 };
@@ -0,0 +1,228 @@
+#pragma once
+#include <vector>
+#include <cmath>
+#include <cfloat>
+#include "Matrix.h"
+#include "Vector.h"
+#include "Animation.h"
+
+
+
+// Axis aligned box plus a sphere around it, empty until the first point goes in
+struct Bounds
+{
+	Vec3 min = Vec3(FLT_MAX, FLT_MAX, FLT_MAX);
+	Vec3 max = Vec3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	Vec3 center;
+	float radius = 0.0f;
+
+	bool empty() const
+	{
+		return min.v[0] > max.v[0];
+	}
+
+	void add(const Vec3& p)
+	{
+		for (int c = 0; c < 3; c++) {
+			min.v[c] = p.v[c] < min.v[c] ? p.v[c] : min.v[c];
+			max.v[c] = p.v[c] > max.v[c] ? p.v[c] : max.v[c];
+		}
+	}
+
+	// box only, call fitSphere once everything is in
+	void addBox(const Bounds& other)
+	{
+		if (other.empty()) return;
+		add(other.min);
+		add(other.max);
+	}
+
+	// sphere around the box's centre through its corners
+	void fitSphere()
+	{
+		if (empty()) return;
+		center = (min + max) * 0.5f;
+		radius = (max - center).getLength();
+	}
+
+	void grow(float amount)
+	{
+		if (empty()) return;
+		min = min - Vec3(amount, amount, amount);
+		max = max + Vec3(amount, amount, amount);
+		radius += amount;
+	}
+
+	// Box and sphere around both, the sphere from the two spheres rather than refitted to the box
+	void merge(const Bounds& other)
+	{
+		if (other.empty()) return;
+		if (empty()) {
+			*this = other;
+			return;
+		}
+		addBox(other);
+		Vec3 d = other.center - center;
+		float distance = d.getLength();
+		if (distance + other.radius <= radius) return;
+		if (distance + radius <= other.radius) {
+			center = other.center;
+			radius = other.radius;
+			return;
+		}
+		float merged = (distance + radius + other.radius) * 0.5f;
+		center = center + d * ((merged - radius) / distance);
+		radius = merged;
+	}
+
+	// Box around the transformed box (centre and extent through the matrix, Arvo's method) and the
+	// sphere moved with it, its radius scaled by the largest axis scale. m is affine.
+	Bounds transformed(const Mat4& m) const
+	{
+		Bounds out;
+		if (empty()) return out;
+		Vec3 c = (min + max) * 0.5f;
+		Vec3 e = (max - c);
+		float largest = 0.0f;
+		for (int r = 0; r < 3; r++) {
+			float mid = m.m[r][0] * c.v[0] + m.m[r][1] * c.v[1] + m.m[r][2] * c.v[2] + m.m[r][3];
+			float extent = fabsf(m.m[r][0]) * e.v[0] + fabsf(m.m[r][1]) * e.v[1] + fabsf(m.m[r][2]) * e.v[2];
+			out.min.v[r] = mid - extent;
+			out.max.v[r] = mid + extent;
+			out.center.v[r] = m.m[r][0] * center.v[0] + m.m[r][1] * center.v[1] + m.m[r][2] * center.v[2] + m.m[r][3];
+			float scale = sqrtf(m.m[0][r] * m.m[0][r] + m.m[1][r] * m.m[1][r] + m.m[2][r] * m.m[2][r]);
+			largest = scale > largest ? scale : largest;
+		}
+		out.radius = radius * largest;
+		return out;
+	}
+};
+
+
+
+// Conservative bounds of a skinned mesh per clip segment, without skinning any vertices at runtime.
+// Each bone keeps a box around the vertices it has weight on, in the space its global transform maps
+// to the model (skinOffset * bind position). A skinned vertex is a weighted average of its bones'
+// transforms of it, so it lies in the box around those bones' transformed boxes. Baking a clip
+// transforms the bone boxes at every key and every half key and unions them per segment of
+// framesPerSegment keys; the result is grown by half the largest move of a bone box between two
+// samples to cover the times in between. Clips are baked the first time they are asked for.
+class AnimatedBounds {
+public:
+	int framesPerSegment = 8;
+	int samplesPerFrame = 2;
+	// A blend of two clips can reach outside both clips' bounds; merged bounds are grown by this
+	// fraction of the bind radius while more than one clip has weight
+	float blendMargin = 0.3f;
+	std::vector<Bounds> boneBounds;	// per bone, empty for bones without weighted vertices
+	Bounds bindBounds;				// the mesh as loaded, for objects without animation or clips not played yet
+
+	struct Clip {
+		bool baked = false;
+		Bounds whole;
+		std::vector<Bounds> segments;
+	};
+	std::vector<Clip> clips;		// by clip handle
+
+	// call after skeleton.prepare(), once per vertex
+	void addVertex(const Skeleton& skeleton, const Vec3& position, const unsigned int bonesIDs[4], const float boneWeights[4])
+	{
+		bindBounds.add(position);
+		if (boneBounds.size() != skeleton.bones.size())
+			boneBounds.resize(skeleton.bones.size());
+		for (int k = 0; k < 4; k++) {
+			if (boneWeights[k] <= 0.0f || bonesIDs[k] >= boneBounds.size()) continue;
+			const Mat4& offset = skeleton.skinOffsets[bonesIDs[k]];
+			Vec3 p;
+			for (int r = 0; r < 3; r++)
+				p.v[r] = offset.m[r][0] * position.v[0] + offset.m[r][1] * position.v[1] + offset.m[r][2] * position.v[2] + offset.m[r][3];
+			boneBounds[bonesIDs[k]].add(p);
+		}
+	}
+
+	// static meshes, or before any clip is baked
+	void addPoint(const Vec3& position)
+	{
+		bindBounds.add(position);
+	}
+
+	// call once every vertex is in
+	void finish()
+	{
+		bindBounds.fitSphere();
+	}
+
+	// Bounds over the segment holding clip time t, bindBounds if the clip can't be baked
+	const Bounds& at(Animation& animation, int clip, float t)
+	{
+		const Clip* baked = bake(animation, clip);
+		if (baked == nullptr || baked->segments.empty()) return bindBounds;
+		AnimationSequence& sequence = animation.clip(clip);
+		int frame;
+		float interpolationFact;
+		sequence.calcFrame(t < 0.0f ? 0.0f : t, frame, interpolationFact);
+		int segment = frame / framesPerSegment;
+		int last = (int)baked->segments.size() - 1;
+		return baked->segments[segment < last ? segment : last];
+	}
+
+	// Bounds over the whole clip
+	const Bounds& whole(Animation& animation, int clip)
+	{
+		const Clip* baked = bake(animation, clip);
+		return baked != nullptr && !baked->whole.empty() ? baked->whole : bindBounds;
+	}
+
+	// Samples the clip once and keeps its segment bounds; nullptr for a bad handle or missing keys
+	const Clip* bake(Animation& animation, int clip)
+	{
+		if (clip < 0 || clip >= animation.clipCount()) return nullptr;
+		if ((int)clips.size() != animation.clipCount())
+			clips.resize(animation.clipCount());
+		Clip& out = clips[clip];
+		if (out.baked) return &out;
+		if (!animation.loadClip(clip) || boneBounds.empty()) return nullptr;
+		out.baked = true;
+		int frames = animation.clip(clip).frameCount();
+		int bones = animation.bonesSize();
+		int segments = frames > 1 ? (frames - 2) / framesPerSegment + 1 : 1;
+		out.segments.assign(segments, Bounds());
+		LocalPose pose;
+		std::vector<Mat4> globals(bones);
+		std::vector<Bounds> previous(bones), current(bones);
+		std::vector<float> step(segments, 0.0f);
+		for (int f = 0; f < frames; f++) {
+			for (int s = 0; s < samplesPerFrame; s++) {
+				if (s > 0 && f == frames - 1) break;
+				animation.samplePose(clip, f, (float)s / (float)samplesPerFrame, pose);
+				composeTRSBatch(pose.positions.data(), pose.rotations.data(), pose.scales.data(), globals.data(), bones);
+				animation.localToGlobal(globals.data());
+				bool first = f == 0 && s == 0;
+				// a key on a segment boundary ends one segment and starts the next
+				int segment = f / framesPerSegment;
+				int previousSegment = (s == 0 && f > 0 && f % framesPerSegment == 0) ? segment - 1 : segment;
+				segment = segment < segments ? segment : segments - 1;
+				for (int i = 0; i < bones; i++) {
+					if (boneBounds[i].empty()) continue;
+					current[i] = boneBounds[i].transformed(globals[i]);
+					out.segments[segment].addBox(current[i]);
+					if (previousSegment != segment)
+						out.segments[previousSegment].addBox(current[i]);
+					if (!first) {
+						float move = fmaxf((current[i].min - previous[i].min).getLength(), (current[i].max - previous[i].max).getLength());
+						step[previousSegment] = fmaxf(step[previousSegment], move);
+					}
+				}
+				current.swap(previous);
+			}
+		}
+		out.whole = Bounds();
+		for (int i = 0; i < segments; i++) {
+			out.segments[i].fitSphere();
+			out.segments[i].grow(step[i] * 0.5f);
+			out.whole.addBox(out.segments[i]);
+		}
+		out.whole.fitSphere();
+		return &out;
+	}
+};
@@ -2,9 +2,18 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <unordered_map>
+#include <functional>
+#include <deque>
+#include <iterator>
+#include <cstring>
+#include <mutex>
+#include "SIMD.h"
 #include "Matrix.h"
 #include "Vector.h"
 #include "Operators.h"
+#include "Transform.h"
+#include "CompressedClip.h"
 
 
 struct Bone
@@ -18,32 +27,354 @@ struct Skeleton
 {
 	std::vector<Bone> bones;
 	Mat4 globalInverse;
+	std::vector<Mat4> skinOffsets;	// offset * globalInverse per bone, built by prepare()
+	std::vector<int> order;			// bone indices with every parent ahead of its children
+	std::vector<int> heights;		// distance from each bone down to its deepest leaf, leaves are 0
+	std::vector<std::vector<int>> lodBones;	// lodBones[k]: bones with height >= k, in index order
+
+	// call once the bones and globalInverse are set
+	void prepare()
+	{
+		int n = (int)bones.size();
+		skinOffsets.resize(n);
+		for (int i = 0; i < n; i++)
+			Mat4::multiplyAffine(bones[i].offset, globalInverse, skinOffsets[i]);
+		prepareHierarchy();
+	}
+
+	// order, heights and lodBones only, for skeletons whose skinOffsets were loaded precomputed
+	void prepareHierarchy()
+	{
+		int n = (int)bones.size();
+		// GEM files already list parents first, so this normally ends up as 0..n-1
+		order.clear();
+		std::vector<char> placed(n, 0);
+		while ((int)order.size() < n) {
+			int before = (int)order.size();
+			for (int i = 0; i < n; i++) {
+				int parent = bones[i].parentIndex;
+				if (!placed[i] && (parent < 0 || placed[parent])) {
+					order.push_back(i);
+					placed[i] = 1;
+				}
+			}
+			if ((int)order.size() == before) break;	// cycle, leave the rest out
+		}
+		heights.assign(n, 0);
+		for (int k = (int)order.size() - 1; k >= 0; k--) {
+			int i = order[k];
+			int parent = bones[i].parentIndex;
+			if (parent > -1 && heights[i] + 1 > heights[parent])
+				heights[parent] = heights[i] + 1;
+		}
+		int maxHeight = 0;
+		for (int i = 0; i < n; i++)
+			maxHeight = heights[i] > maxHeight ? heights[i] : maxHeight;
+		lodBones.assign(maxHeight + 1, std::vector<int>());
+		for (int k = 0; k <= maxHeight; k++)
+			for (int i = 0; i < n; i++)
+				if (heights[i] >= k)
+					lodBones[k].push_back(i);
+	}
+
+	// bones still sampled when the lowest frozenLevels levels are frozen, nullptr for all of them;
+	// the root levels are never frozen
+	const std::vector<int>* bonesAboveLevel(int frozenLevels) const
+	{
+		if (frozenLevels <= 0 || lodBones.empty()) return nullptr;
+		int level = frozenLevels < (int)lodBones.size() ? frozenLevels : (int)lodBones.size() - 1;
+		return &lodBones[level];
+	}
+};
+
+// How much of a pose to recompute, lowered by the animation LOD for distant actors
+struct PoseDetail
+{
+	int frozenLevels = 0;		// bones this close to a leaf keep their last sampled transform, 1 = leaves
+	bool interpolate = true;	// false takes the nearest key instead of blending two
 };
 
-struct AnimationFrame
+// Local TRS of every bone, filled by AnimationSequence::sampleLocalPose
+struct LocalPose
 {
 	std::vector<Vec3> positions;
-	std::vector<Vec4> rotations;
+	std::vector<Quat> rotations;
 	std::vector<Vec3> scales;
+
+	void resize(int bones)
+	{
+		positions.resize(bones);
+		rotations.resize(bones);
+		scales.resize(bones);
+	}
+
+	// all zero, including the rotations, ready for accumulate()
+	void zero(int bones)
+	{
+		resize(bones);
+		memset(positions.data(), 0, bones * sizeof(Vec3));
+		memset(rotations.data(), 0, bones * sizeof(Quat));
+		memset(scales.data(), 0, bones * sizeof(Vec3));
+	}
+
+	// this += other * weight; each rotation is flipped onto the accumulated one's hemisphere first
+	void accumulate(const LocalPose& other, float weight, int bones)
+	{
+		maddFloats(positions.data()->v, other.positions.data()->v, weight, bones * 3);
+		maddFloats(scales.data()->v, other.scales.data()->v, weight, bones * 3);
+		for (int i = 0; i < bones; i++) {
+			const Quat& q = other.rotations[i];
+			float w = rotations[i].Dot(q) < 0.0f ? -weight : weight;
+			for (int k = 0; k < 4; k++)
+				rotations[i].v[k] += q.v[k] * w;
+		}
+	}
+
+	void normalizeRotations(int bones)
+	{
+		for (int i = 0; i < bones; i++)
+			rotations[i] = rotations[i].normalize();
+	}
+
+	size_t sizeInBytes() const
+	{
+		return positions.capacity() * sizeof(Vec3) + rotations.capacity() * sizeof(Quat) + scales.capacity() * sizeof(Vec3);
+	}
+
+private:
+	static void maddFloats(float* out, const float* a, float weight, int count)
+	{
+		int i = 0;
+		SIMD::vfloat vw = SIMD::set1(weight);
+		for (; i + SIMD::width <= count; i += SIMD::width)
+			SIMD::storeu(out + i, SIMD::madd(SIMD::loadu(a + i), vw, SIMD::loadu(out + i)));
+		for (; i < count; i++)
+			out[i] += a[i] * weight;
+	}
+};
+
+// Free list of LocalPose buffers for one skeleton. Sequencers take a buffer only while a clip has
+// weight and hand it back afterwards, so actors don't each keep a pose per clip. Copies start empty
+// because handed out pointers belong to the original. acquire and release can be called from several
+// threads at once, as actors sharing a model update their poses in parallel.
+class PosePool {
+public:
+	PosePool() {}
+	PosePool(const PosePool&) {}
+	PosePool& operator=(const PosePool&) { return *this; }
+
+	LocalPose* acquire(int bones)
+	{
+		LocalPose* pose;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (available.empty()) {
+				poses.emplace_back();
+				pose = &poses.back();
+			}
+			else {
+				pose = available.back();
+				available.pop_back();
+			}
+		}
+		pose->resize(bones);
+		return pose;
+	}
+
+	void release(LocalPose* pose)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		available.push_back(pose);
+	}
+
+	int size() const
+	{
+		return (int)poses.size();
+	}
+
+	int inUse() const
+	{
+		return (int)(poses.size() - available.size());
+	}
+
+private:
+	std::deque<LocalPose> poses;	// deque so handed out pointers stay valid as the pool grows
+	std::vector<LocalPose*> available;
+	std::mutex mutex;
+};
+
+// Keyframes of one clip in a single aligned allocation: a position, rotation and scale track,
+// each time-major (frame * boneCount + bone) and starting on a SIMD::alignment boundary, so
+// sampling a frame pair touches two contiguous runs per track instead of six separate vectors
+class KeyframeBuffer {
+public:
+	int frameCount;
+	int boneCount;
+	Vec3* positions;
+	Quat* rotations;
+	Vec3* scales;
+
+	KeyframeBuffer() : frameCount(0), boneCount(0), positions(nullptr), rotations(nullptr), scales(nullptr), data(nullptr), bytes(0) {}
+
+	KeyframeBuffer(const KeyframeBuffer& other) : KeyframeBuffer()
+	{
+		*this = other;
+	}
+
+	KeyframeBuffer(KeyframeBuffer&& other) noexcept : KeyframeBuffer()
+	{
+		swap(other);
+	}
+
+	KeyframeBuffer& operator=(const KeyframeBuffer& other)
+	{
+		if (this == &other) return *this;
+		allocate(other.frameCount, other.boneCount);
+		if (bytes > 0)
+			memcpy(data, other.data, bytes);
+		return *this;
+	}
+
+	KeyframeBuffer& operator=(KeyframeBuffer&& other) noexcept
+	{
+		swap(other);
+		return *this;
+	}
+
+	~KeyframeBuffer()
+	{
+		release();
+	}
+
+	void swap(KeyframeBuffer& other)
+	{
+		std::swap(frameCount, other.frameCount);
+		std::swap(boneCount, other.boneCount);
+		std::swap(positions, other.positions);
+		std::swap(rotations, other.rotations);
+		std::swap(scales, other.scales);
+		std::swap(data, other.data);
+		std::swap(bytes, other.bytes);
+	}
+
+	// one block holding all three tracks, contents zeroed
+	void allocate(int frames, int bones)
+	{
+		release();
+		frameCount = frames;
+		boneCount = bones;
+		size_t keys = (size_t)frames * bones;
+		size_t positionBytes = alignUp(keys * sizeof(Vec3));
+		size_t rotationBytes = alignUp(keys * sizeof(Quat));
+		bytes = positionBytes + rotationBytes + alignUp(keys * sizeof(Vec3));
+		if (bytes == 0) return;
+		data = (char*)SIMD::alignedAlloc(bytes);
+		memset(data, 0, bytes);
+		positions = (Vec3*)data;
+		rotations = (Quat*)(data + positionBytes);
+		scales = (Vec3*)(data + positionBytes + rotationBytes);
+	}
+
+	// first key of a frame in each track
+	Vec3* framePositions(int frame) const { return positions + (size_t)frame * boneCount; }
+	Quat* frameRotations(int frame) const { return rotations + (size_t)frame * boneCount; }
+	Vec3* frameScales(int frame) const { return scales + (size_t)frame * boneCount; }
+
+	size_t sizeInBytes() const
+	{
+		return bytes;
+	}
+
+	// all three tracks and the padding between them, sizeInBytes() long, for reading a clip in one go
+	void* block() const
+	{
+		return data;
+	}
+
+private:
+	char* data;
+	size_t bytes;
+
+	static size_t alignUp(size_t n)
+	{
+		return (n + SIMD::alignment - 1) / SIMD::alignment * SIMD::alignment;
+	}
+
+	void release()
+	{
+		if (data != nullptr)
+			SIMD::alignedFree(data);
+		data = nullptr;
+		positions = nullptr;
+		rotations = nullptr;
+		scales = nullptr;
+		frameCount = 0;
+		boneCount = 0;
+		bytes = 0;
+	}
+};
+
+
+
+// What an AnimationInstance does when its clip time runs past either end
+enum PlaybackMode {
+	PLAYBACK_LOOP,		// wrap around to the start, keeping the overshoot
+	PLAYBACK_PING_PONG,	// bounce and play backwards, then forwards again
+	PLAYBACK_CLAMP		// hold the last pose
 };
 
 
 
 class AnimationSequence {
 public:
-	std::vector<AnimationFrame> frames;
+	KeyframeBuffer keys;
+	CompressedClip compressed;	// replaces keys once Animation::compress has run
 	float ticksPerSecond;
+	int indexedFrames = 0;		// frame count from the file's clip index, for clips whose keys aren't loaded
+	bool used = false;			// played since the last Animation::evictUnused
+
+	int frameCount() const {
+		if (isCompressed()) return compressed.frameCount;
+		return keys.frameCount > 0 ? keys.frameCount : indexedFrames;
+	}
+
+	bool isCompressed() const {
+		return !compressed.empty();
+	}
+
+	// keys are in memory, raw or compressed
+	bool isResident() const {
+		return keys.frameCount > 0 || isCompressed();
+	}
+
+	void evict() {
+		keys = KeyframeBuffer();
+		compressed = CompressedClip();
+	}
+
+	size_t keyBytes() const {
+		return isCompressed() ? compressed.sizeInBytes() : keys.sizeInBytes();
+	}
+
+	// Swaps the raw keys for a CompressedClip, which every sampling path below then decodes from
+	void compress(const CompressionSettings& settings, ClipCompressionStats* stats = nullptr)
+	{
+		if (isCompressed() || keys.frameCount == 0)
+			return;
+		compressed = CompressedClip::compress(keys.frameCount, keys.boneCount, keys.framePositions(0), keys.frameRotations(0), keys.frameScales(0), settings, stats);
+		keys = KeyframeBuffer();
+	}
 
 	Vec3 interpolate(Vec3 p1, Vec3 p2, float t) {
 		return ((p1 * (1.0f - t)) + (p2 * t));
 	}
 
-	Vec4 interpolate(Vec4 q1, Vec4 q2, float t) {
-		return slerp(q1, q2, t);
+	Quat interpolate(const Quat& q1, const Quat& q2, float t) {
+		return Quat::slerp(q1, q2, t);
 	}
 
 	float duration() {
-		return ((float)frames.size() / ticksPerSecond);
+		return ((float)frameCount() / ticksPerSecond);
 	}
 
 	void calcFrame(float t, int& frame, float& interpolationFact)
@@ -51,38 +382,108 @@ public:
 		interpolationFact = t * ticksPerSecond;
 		frame = (int)floorf(interpolationFact);
 		interpolationFact = interpolationFact - (float)frame;
-		frame = min(frame, frames.size() - 1);
+		frame = min(frame, frameCount() - 1);
 	}
 
 	int nextFrame(int frame)
 	{
-		return min(frame + 1, frames.size() - 1);
+		return min(frame + 1, frameCount() - 1);
 
 	}
 
-	Mat4 interpolateBoneToGlobal(Mat4* matrices, int baseFrame, float interpolationFact, Skeleton* skeleton, int boneIndex)
+	// Local TRS of the first `bones` bones between baseFrame and the next frame: one linear pass per
+	// track, rotations through the batched slerp
+	void sampleLocalPose(int baseFrame, float interpolationFact, LocalPose& pose, int bones)
 	{
-		// scale
-		Vec3 scaleFactor = interpolate(frames[baseFrame].scales[boneIndex], frames[nextFrame(baseFrame)].scales[boneIndex], interpolationFact);
-		Mat4 scale = Mat4().Scale(scaleFactor.v[0], scaleFactor.v[1], scaleFactor.v[2]);
-		// rotation
-		Vec4 rotationFactor = interpolate(frames[baseFrame].rotations[boneIndex], frames[nextFrame(baseFrame)].rotations[boneIndex], interpolationFact);
-		float x = rotationFactor.v[0];
-		float y = rotationFactor.v[1];
-		float z = rotationFactor.v[2];
-		float w = rotationFactor.v[3];
-		Mat4 rotation = Mat4().rotationQuaternion(x, y, z, w);
-		// translation
-		Vec3 position = interpolate(frames[baseFrame].positions[boneIndex], frames[nextFrame(baseFrame)].positions[boneIndex], interpolationFact);
-		Mat4 translation = Mat4().Translate(position.v[0], position.v[1], position.v[2]);
-		Mat4 local = translation * rotation * scale;
-		if (skeleton->bones[boneIndex].parentIndex > -1)
-		{
-			Mat4 global = matrices[skeleton->bones[boneIndex].parentIndex] * local;
-			return global;
+		if (isCompressed()) {
+			compressed.sample(baseFrame, interpolationFact, pose.positions.data(), pose.rotations.data(), pose.scales.data(), bones);
+			return;
+		}
+		int next = nextFrame(baseFrame);
+		lerpFloats(keys.framePositions(baseFrame)->v, keys.framePositions(next)->v, interpolationFact, pose.positions.data()->v, bones * 3);
+		lerpFloats(keys.frameScales(baseFrame)->v, keys.frameScales(next)->v, interpolationFact, pose.scales.data()->v, bones * 3);
+		Quat::slerpBatch(keys.frameRotations(baseFrame), keys.frameRotations(next), interpolationFact, pose.rotations.data(), bones);
+	}
+
+	// Nearest key: the frame's keys copied as they are
+	void copyKeys(int frame, LocalPose& pose, int bones)
+	{
+		if (isCompressed()) {
+			compressed.sample(frame, 0.0f, pose.positions.data(), pose.rotations.data(), pose.scales.data(), bones);
+			return;
+		}
+		memcpy(pose.positions.data(), keys.framePositions(frame), bones * sizeof(Vec3));
+		memcpy(pose.rotations.data(), keys.frameRotations(frame), bones * sizeof(Quat));
+		memcpy(pose.scales.data(), keys.frameScales(frame), bones * sizeof(Vec3));
+	}
+
+	// Only the listed bones, everything else in the pose keeps its previous value
+	void sampleBones(int baseFrame, float interpolationFact, LocalPose& pose, const std::vector<int>& boneList, bool interpolateKeys)
+	{
+		int next = nextFrame(baseFrame);
+		if (isCompressed()) {
+			int frame = interpolateKeys ? baseFrame : (interpolationFact < 0.5f ? baseFrame : next);
+			float fact = interpolateKeys ? interpolationFact : 0.0f;
+			for (int i : boneList)
+				compressed.sampleBone(i, frame, fact, pose.positions[i], pose.rotations[i], pose.scales[i]);
+			return;
+		}
+		if (!interpolateKeys) {
+			int frame = interpolationFact < 0.5f ? baseFrame : next;
+			for (int i : boneList) {
+				pose.positions[i] = keys.framePositions(frame)[i];
+				pose.rotations[i] = keys.frameRotations(frame)[i];
+				pose.scales[i] = keys.frameScales(frame)[i];
+			}
+			return;
 		}
-		return local;
+		for (int i : boneList) {
+			pose.positions[i] = interpolate(keys.framePositions(baseFrame)[i], keys.framePositions(next)[i], interpolationFact);
+			pose.rotations[i] = interpolate(keys.frameRotations(baseFrame)[i], keys.frameRotations(next)[i], interpolationFact);
+			pose.scales[i] = interpolate(keys.frameScales(baseFrame)[i], keys.frameScales(next)[i], interpolationFact);
+		}
+	}
+
+private:
+	// out = a * (1 - t) + b * t over flat float arrays, same arithmetic as interpolate(Vec3)
+	static void lerpFloats(const float* a, const float* b, float t, float* out, int count)
+	{
+		int i = 0;
+		SIMD::vfloat vd = SIMD::set1(1.0f - t);
+		SIMD::vfloat vt = SIMD::set1(t);
+		for (; i + SIMD::width <= count; i += SIMD::width)
+			SIMD::storeu(out + i, SIMD::add(SIMD::mul(SIMD::loadu(a + i), vd), SIMD::mul(SIMD::loadu(b + i), vt)));
+		for (; i < count; i++)
+			out[i] = a[i] * (1.0f - t) + b[i] * t;
+	}
+};
+
+
+
+// Clip handle -> sequence for one Animation's map, rebuilt whenever the clip count changes. Copies
+// start empty since the pointers lead into the original's map.
+class ClipTable {
+public:
+	ClipTable() {}
+	ClipTable(const ClipTable&) {}
+	ClipTable& operator=(const ClipTable&) { clips.clear(); return *this; }
+
+	AnimationSequence& get(std::map<std::string, AnimationSequence>& animations, int handle)
+	{
+		if (clips.size() != animations.size())
+			rebuild(animations);
+		return *clips[handle];
 	}
+
+	void rebuild(std::map<std::string, AnimationSequence>& animations)
+	{
+		clips.clear();
+		for (auto& pair : animations)
+			clips.push_back(&pair.second);
+	}
+
+private:
+	std::vector<AnimationSequence*> clips;
 };
 
 
@@ -91,15 +492,34 @@ class Animation {
 public:
 	std::map<std::string, AnimationSequence> animations;
 	Skeleton skeleton;
+	PosePool posePool;	// shared by every sequencer playing this animation
+	size_t sourceId = 0;	// identifies the data for PoseCache, animations loaded from the same file share it
+	// Fills a clip's keys when they were left in the file, see Model::load. Empty when every clip
+	// was loaded up front, which also makes them impossible to evict.
+	std::function<bool(const std::string& name, AnimationSequence& sequence)> clipLoader;
 
-	void calcFrame(std::string name, float t, int& frame, float& interpolationFact)
+	size_t cacheKey() const
 	{
-		animations[name].calcFrame(t, frame, interpolationFact);
+		return sourceId != 0 ? sourceId : (size_t)this;
 	}
 
-	Mat4 interpolateBoneToGlobal(std::string name, Mat4* matrices, int baseFrame, float interpolationFact, int boneIndex) 
+	// Clip handle for a name, -1 if there is no such clip. Handles are positions in the map's order
+	// (the order addAllAnimations and PaletteAtlas::bake use too) and stay valid while no clips are
+	// added. Resolve names once at init; everything that runs per frame takes handles.
+	int findClip(const std::string& name)
 	{
-		return animations[name].interpolateBoneToGlobal(matrices, baseFrame, interpolationFact, &skeleton, boneIndex);
+		auto it = animations.find(name);
+		return it == animations.end() ? -1 : (int)std::distance(animations.begin(), it);
+	}
+
+	int clipCount() const
+	{
+		return (int)animations.size();
+	}
+
+	AnimationSequence& clip(int handle)
+	{
+		return clipTable.get(animations, handle);
 	}
 
 	int bonesSize()
@@ -107,14 +527,296 @@ public:
 		return (int)skeleton.bones.size();
 	}
 
+	// Makes sure a clip's keys are in memory, reading them through clipLoader the first time; false if
+	// they can't be. Compressed as they arrive once compress has been called.
+	bool loadClip(int handle)
+	{
+		if (handle < 0 || handle >= clipCount()) return false;
+		auto it = std::next(animations.begin(), handle);
+		AnimationSequence& sequence = it->second;
+		if (sequence.isResident()) return true;
+		if (!clipLoader || !clipLoader(it->first, sequence)) return false;
+		if (compressOnLoad)
+			sequence.compress(compression);
+		return true;
+	}
+
+	// Loads the clip if needed and marks it in use for evictUnused, called by Sequencer for every
+	// clip with weight. Writes nothing once the clip is loaded and marked, so sequencers sharing this
+	// animation can call it from several threads after Sequencer::useClips has run for them.
+	void useClip(int handle)
+	{
+		AnimationSequence& sequence = clip(handle);
+		if (!sequence.isResident())
+			loadClip(handle);
+		if (!sequence.used)
+			sequence.used = true;
+	}
+
+	// Frees the keys of every clip not played since the previous call and returns how many were freed.
+	// Only clips clipLoader can bring back are evicted; they reload on their next use.
+	int evictUnused()
+	{
+		if (!clipLoader) return 0;
+		int evicted = 0;
+		for (auto& pair : animations) {
+			AnimationSequence& sequence = pair.second;
+			if (!sequence.used && sequence.isResident()) {
+				sequence.evict();
+				evicted++;
+			}
+			sequence.used = false;
+		}
+		return evicted;
+	}
+
+	int residentClips() const
+	{
+		int count = 0;
+		for (const auto& pair : animations)
+			count += pair.second.isResident() ? 1 : 0;
+		return count;
+	}
+
+	// key memory of the resident clips
+	size_t keyBytes() const
+	{
+		size_t bytes = 0;
+		for (const auto& pair : animations)
+			bytes += pair.second.keyBytes();
+		return bytes;
+	}
+
+	// bones that samplePose leaves untouched at this detail
+	int frozenBones(const PoseDetail& detail)
+	{
+		prepare();
+		const std::vector<int>* boneList = skeleton.bonesAboveLevel(detail.frozenLevels);
+		return boneList == nullptr ? 0 : bonesSize() - (int)boneList->size();
+	}
+
+	void prepare()
+	{
+		if (skeleton.skinOffsets.size() != skeleton.bones.size())
+			skeleton.prepare();
+	}
+
+	// Builds the skeleton's derived data and the clip handle table up front, which are otherwise made
+	// on first use. Call once every clip is added if the animation is shared between actors, so the
+	// parallel pose pass only ever reads them.
+	void prepareForSharing()
+	{
+		prepare();
+		clipTable.rebuild(animations);
+	}
+
+	// Skinning matrices for clip `name` at time t, in three passes over the bones:
+	// sample local TRS, turn local into global in parent order, apply the folded offsets
+	void evaluatePose(int clipHandle, float t, LocalPose& pose, Mat4* matrices)
+	{
+		samplePose(clipHandle, t, pose);
+		poseToMatrices(pose, matrices);
+	}
+
+	// detail can freeze bones, which then keep whatever the pose held before
+	void samplePose(int clipHandle, float t, LocalPose& pose, const PoseDetail& detail = PoseDetail())
+	{
+		int frame = 0;
+		float interpolationFact = 0;
+		clip(clipHandle).calcFrame(t, frame, interpolationFact);
+		samplePose(clipHandle, frame, interpolationFact, pose, detail);
+	}
+
+	// between frame and the next one, as found by calcFrame
+	void samplePose(int clipHandle, int frame, float interpolationFact, LocalPose& pose, const PoseDetail& detail = PoseDetail())
+	{
+		prepare();
+		AnimationSequence& sequence = clip(clipHandle);
+		int bones = bonesSize();
+		pose.resize(bones);
+		if (!sequence.isResident() && !loadClip(clipHandle))
+			return;
+		const std::vector<int>* boneList = skeleton.bonesAboveLevel(detail.frozenLevels);
+		if (boneList != nullptr)
+			sequence.sampleBones(frame, interpolationFact, pose, *boneList, detail.interpolate);
+		else if (detail.interpolate)
+			sequence.sampleLocalPose(frame, interpolationFact, pose, bones);
+		else
+			sequence.copyKeys(interpolationFact < 0.5f ? frame : sequence.nextFrame(frame), pose, bones);
+	}
+
+	// Compresses every resident clip (see CompressedClip) and frees its raw keys; clips loaded later are
+	// compressed as they arrive. stats, when given, gets one entry per compressed clip in handle order, with maxJointError the worst model space joint position error the
+	// bone space errors add up to over the skeleton.
+	struct ClipStats : ClipCompressionStats {
+		std::string name;
+		float maxJointError = 0.0f;
+	};
+
+	void compress(const CompressionSettings& settings = CompressionSettings(), std::vector<ClipStats>* stats = nullptr)
+	{
+		compressOnLoad = true;
+		compression = settings;
+		prepare();
+		int bones = bonesSize();
+		LocalPose pose;
+		pose.resize(bones);
+		std::vector<Mat4> before(bones), after(bones);
+		for (auto& pair : animations) {
+			AnimationSequence& sequence = pair.second;
+			if (sequence.isCompressed() || !sequence.isResident())
+				continue;
+			ClipStats clipStats;
+			clipStats.name = pair.first;
+			AnimationSequence source;
+			if (stats != nullptr)
+				source.keys = sequence.keys;
+			sequence.compress(settings, &clipStats);
+			if (stats == nullptr)
+				continue;
+			for (int frame = 0; frame < source.frameCount(); frame++) {
+				source.copyKeys(frame, pose, bones);
+				composeTRSBatch(pose.positions.data(), pose.rotations.data(), pose.scales.data(), before.data(), bones);
+				localToGlobal(before.data());
+				sequence.copyKeys(frame, pose, bones);
+				composeTRSBatch(pose.positions.data(), pose.rotations.data(), pose.scales.data(), after.data(), bones);
+				localToGlobal(after.data());
+				for (int i = 0; i < bones; i++) {
+					Vec3 d(after[i].m[0][3] - before[i].m[0][3], after[i].m[1][3] - before[i].m[1][3], after[i].m[2][3] - before[i].m[2][3]);
+					clipStats.maxJointError = max(clipStats.maxJointError, sqrtf(d.v[0] * d.v[0] + d.v[1] * d.v[1] + d.v[2] * d.v[2]));
+				}
+			}
+			stats->push_back(clipStats);
+		}
+	}
+
+	void poseToMatrices(const LocalPose& pose, Mat4* matrices)
+	{
+		prepare();
+		composeTRSBatch(pose.positions.data(), pose.rotations.data(), pose.scales.data(), matrices, bonesSize());
+		localToGlobal(matrices);
+		calcFinalTransforms(matrices);
+	}
+
+	// matrices hold local transforms on entry and global ones on return
+	void localToGlobal(Mat4* matrices)
+	{
+		for (int i : skeleton.order) {
+			int parent = skeleton.bones[i].parentIndex;
+			if (parent > -1)
+				Mat4::multiplyAffine(matrices[parent], matrices[i], matrices[i]);
+		}
+	}
+
 	void calcFinalTransforms(Mat4* matrices)
 	{
 		for (int i = 0; i < bonesSize(); i++)
+			Mat4::multiplyAffine(matrices[i], skeleton.skinOffsets[i], matrices[i]);
+	}
+
+private:
+	ClipTable clipTable;
+	bool compressOnLoad = false;	// set by compress, for clips clipLoader brings in later
+	CompressionSettings compression;
+};
+
+
+
+// Skinning palettes shared by actors playing the same clip of the same model at nearly the same
+// time. Clip times snap to multiples of phaseTolerance and the palette is built at the snapped time,
+// so everyone in a bucket gets the same pose whichever actor filled it.
+// find and insert can be called from several threads at once. Entries are never changed once
+// inserted and only go away in trim or clear, which must not overlap with them.
+class PoseCache {
+public:
+	struct Key {
+		size_t model;
+		int clip;
+		int step;
+		bool interpolate;
+
+		bool operator==(const Key& other) const
 		{
-			matrices[i] = matrices[i] * skeleton.bones[i].offset * skeleton.globalInverse;
+			return model == other.model && clip == other.clip && step == other.step && interpolate == other.interpolate;
+		}
+	};
+
+	struct KeyHash {
+		size_t operator()(const Key& key) const
+		{
+			size_t h = key.model;
+			h ^= (size_t)key.clip + 0x9e3779b9 + (h << 6) + (h >> 2);
+			h ^= (size_t)key.step * 2 + (key.interpolate ? 1 : 0) + 0x9e3779b9 + (h << 6) + (h >> 2);
+			return h;
+		}
+	};
+
+	float phaseTolerance = 1.0f / 60.0f;	// seconds
+	int capacity = 4096;					// entries kept before trim flushes the cache
+	int hits = 0;
+	int misses = 0;
+
+	float snap(float t, int& step) const
+	{
+		step = (int)floorf(t / phaseTolerance + 0.5f);
+		return (float)step * phaseTolerance;
+	}
+
+	// cached palette, nullptr if it still has to be built
+	const Mat4* find(const Key& key)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		auto it = entries.find(key);
+		if (it == entries.end()) {
+			misses++;
+			return nullptr;
 		}
+		hits++;
+		return it->second.data();
+	}
+
+	// Copies a built palette in. When another thread got there first its copy is kept, the two are
+	// the same pose.
+	void insert(const Key& key, const Mat4* palette, int bones)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		auto inserted = entries.try_emplace(key);
+		if (inserted.second)
+			inserted.first->second.assign(palette, palette + bones);
+	}
+
+	// flushes the cache once it holds capacity entries, call between frames
+	void trim()
+	{
+		if ((int)entries.size() >= capacity)
+			entries.clear();
+	}
+
+	float hitRate() const
+	{
+		int lookups = hits + misses;
+		return lookups > 0 ? (float)hits / (float)lookups : 0.0f;
+	}
+
+	int size() const
+	{
+		return (int)entries.size();
 	}
 
+	void resetCounters()
+	{
+		hits = 0;
+		misses = 0;
+	}
+
+	void clear()
+	{
+		entries.clear();
+	}
+
+private:
+	std::unordered_map<Key, std::vector<Mat4>, KeyHash> entries;
+	std::mutex mutex;
 };
 
 
@@ -122,45 +824,86 @@ public:
 // Holds an instance of animation data, allows multiple characters to use same animation data
 class AnimationInstance {
 public:
-	Animation* animation;
-	std::string currentAnimation;
-	float t;
-	Mat4 matrices[256];
+	Animation* animation = nullptr;
+	int currentClip = -1;	// clip handle
+	float t = 0.0f;
+	PlaybackMode playback = PLAYBACK_LOOP;
+	float direction = 1.0f;	// -1 on the way back in PLAYBACK_PING_PONG
+	LocalPose pose;
+	std::vector<Mat4> matrices;	// bonesSize() entries, sized on the first update
 
 	void resetAnimationTime()
 	{
 		t = 0;
+		direction = 1.0f;
 	}
 
 	bool animationFinished()
 	{
-		if (t > animation->animations[currentAnimation].duration())
+		if (t > animation->clip(currentClip).duration())
 		{
 			return true;
 		}
 		return false;
 	}
 
-	void update(std::string name, float dt) {
-		if (name == currentAnimation) {
-			t += dt;
+	// moves the clip time on without evaluating a pose
+	void advance(int clip, float dt) {
+		if (clip == currentClip) {
+			t += dt * direction;
 		}
 		else {
-			currentAnimation = name;  t = 0;
+			currentClip = clip;
+			resetAnimationTime();
 		}
-		if (animationFinished() == true) { resetAnimationTime(); }
-		int frame = 0;
-		float interpolationFact = 0;
-		animation->calcFrame(name, t, frame, interpolationFact);
-		for (int i = 0; i < animation->bonesSize(); i++)
-		{
-			matrices[i] = animation->interpolateBoneToGlobal(name, matrices, frame, interpolationFact, i);
+		float duration = animation->clip(currentClip).duration();
+		if (t <= duration && t >= 0.0f) return;
+		if (duration <= 0.0f) {
+			t = 0.0f;
+			return;
 		}
-		animation->calcFinalTransforms(matrices);
+		switch (playback) {
+		case PLAYBACK_LOOP:
+			t = fmodf(t, duration);
+			t = t < 0.0f ? t + duration : t;
+			break;
+		case PLAYBACK_PING_PONG:
+			// whole there-and-back periods change nothing, then at most two bounces are left
+			t = fmodf(t, 2.0f * duration);
+			while (t > duration || t < 0.0f) {
+				if (t > duration) {
+					t = 2.0f * duration - t;
+					direction = -1.0f;
+				}
+				else {
+					t = -t;
+					direction = 1.0f;
+				}
+			}
+			break;
+		case PLAYBACK_CLAMP:
+			t = t < 0.0f ? 0.0f : duration;
+			break;
+		}
+	}
+
+	// frame pair for the current time
+	void calcFrame(int& frame, float& interpolationFact) {
+		animation->clip(currentClip).calcFrame(t, frame, interpolationFact);
+	}
+
+	void update(int clip, float dt) {
+		advance(clip, dt);
+		matrices.resize(animation->bonesSize());
+		int frame;
+		float interpolationFact;
+		calcFrame(frame, interpolationFact);
+		animation->samplePose(clip, frame, interpolationFact, pose);
+		animation->poseToMatrices(pose, matrices.data());
 	}
 
 	Mat4* getBoneMatrices() {
-		return matrices;
+		return matrices.data();
 	}
 
 };
@@ -169,31 +912,62 @@ public:
 
 class Sequencer {
 public:
+	// Every clip keeps an item for its name, weight and clip time. The pose buffer comes from the
+	// animation's PosePool and is only held while the clip has weight.
 	struct Item {
-		AnimationInstance* animationInstance;
+		AnimationInstance animationInstance;
 		std::string animationName;
+		int clip = -1;				// handle of animationName, resolved by addItem
 		float weight;
 		float startTime;
 		float speed;
+		LocalPose* pose = nullptr;
+		bool poseSampled = false;	// false right after the pose comes from the pool, frozen bones need a full sample first
 	};
 	float totalWeight;
 	std::vector<Item> items;
-	Mat4 matrices[256];
+	LocalPose blended;
+	std::vector<Mat4> matrices;	// bonesSize() entries
+	PoseDetail detail;			// set by the animation LOD
+	PoseCache* poseCache = nullptr;	// optional, shared between actors by ActorList
 
 	float globalTime = 0;
 
 	Sequencer() : totalWeight(0.0f) {}
 
+	Sequencer(const Sequencer& other) : Sequencer() {
+		*this = other;
+	}
+
+	// pooled poses stay with the original, the copy takes its own on its next update
+	Sequencer& operator=(const Sequencer& other) {
+		if (this == &other) return *this;
+		releasePoses();
+		totalWeight = other.totalWeight;
+		items = other.items;
+		for (auto& item : items)
+			item.pose = nullptr;
+		blended = other.blended;
+		matrices = other.matrices;
+		detail = other.detail;
+		poseCache = other.poseCache;
+		globalTime = other.globalTime;
+		return *this;
+	}
+
 	void addItem(Animation* animation, std::string name, float weight, float startTime, float speed) {
 		Item item;
-		item.animationInstance = new AnimationInstance();
-		item.animationInstance->animation = animation;
+		item.animationInstance.animation = animation;
 		item.animationName = name;
+		item.clip = animation->findClip(name);
 		item.weight = weight;
 		item.startTime = startTime;
 		item.speed = speed;
 		items.push_back(item);
 		totalWeight += weight;
+		// bind pose until the first update
+		if ((int)matrices.size() < animation->bonesSize())
+			matrices.resize(animation->bonesSize());
 	}
 
 	void addAllAnimations(Animation* animation, float weight, float startTime, float speed) {
@@ -202,31 +976,151 @@ public:
 		}
 	}
 
+	// Every started clip keeps its time running, but only clips with weight are sampled. Their
+	// local poses are blended (positions and scales linearly, rotations as a normalised weighted
+	// sum) and the result goes through the hierarchy once
 	void update(float dt) {
 		globalTime += dt;
+		float activeWeight = 0.0f;
+		int activeCount = 0;
+		int lastActive = -1;
 		for (int i = 0; i < items.size(); i++) {
-			if (globalTime >= items[i].startTime) {
-				items[i].animationInstance->update(items[i].animationName, dt * items[i].speed);
+			Item& item = items[i];
+			bool active = globalTime >= item.startTime && item.weight > 0.0f;
+			if (globalTime >= item.startTime)
+				item.animationInstance.advance(item.clip, dt * item.speed);
+			if (active) {
+				item.animationInstance.animation->useClip(item.clip);
+				activeWeight += item.weight;
+				activeCount++;
+				lastActive = i;
+				if (item.pose == nullptr) {
+					item.pose = item.animationInstance.animation->posePool.acquire(item.animationInstance.animation->bonesSize());
+					item.poseSampled = false;
+				}
+			}
+			else if (item.pose != nullptr) {
+				item.animationInstance.animation->posePool.release(item.pose);
+				item.pose = nullptr;
 			}
 		}
-		// blend matrices
-		for (int b = 0; b < 256; b++) {
-			matrices[b] = Mat4()._Identity().Scale(0.0f, 0.0f, 0.0f); // reset to zero matrix
-			for (int i = 0; i < items.size(); i++) {
-				if (globalTime >= items[i].startTime) {
-					Mat4* boneMatrices = items[i].animationInstance->getBoneMatrices();
-					if (totalWeight > 0.0f) {
-						boneMatrices[b] = boneMatrices[b] * (items[i].weight / totalWeight);
-						matrices[b] += boneMatrices[b];
-					}
-				}
+		// nothing weighted in yet, keep the last pose
+		if (activeCount == 0) return;
+		Animation* animation = items[lastActive].animationInstance.animation;
+		matrices.resize(animation->bonesSize());
+		if (activeCount == 1) {
+			Item& item = items[lastActive];
+			// frozen bones depend on earlier frames, so only full poses are shared
+			if (poseCache != nullptr && detail.frozenLevels == 0) {
+				cachedPose(item);
+				return;
 			}
-			
+			samplePose(item);
+			animation->poseToMatrices(*item.pose, matrices.data());
+			return;
 		}
+		int bones = animation->bonesSize();
+		blended.zero(bones);
+		for (int i = 0; i < items.size(); i++) {
+			Item& item = items[i];
+			if (item.pose == nullptr) continue;
+			samplePose(item);
+			blended.accumulate(*item.pose, item.weight / activeWeight, bones);
+		}
+		blended.normalizeRotations(bones);
+		animation->poseToMatrices(blended, matrices.data());
 	}
 
 	Mat4* getBoneMatrices() {
-		return matrices;
+		return matrices.data();
+	}
+
+	int boneCount() const {
+		return (int)matrices.size();
+	}
+
+	// Loads and marks every clip with weight, as update would, see StateMachine::useClips
+	void useClips() {
+		for (int i = 0; i < items.size(); i++)
+			if (items[i].weight > 0.0f)
+				useItem(i);
+	}
+
+	void useItem(int index) {
+		if (index < 0 || index >= items.size()) return;
+		items[index].animationInstance.animation->useClip(items[index].clip);
+	}
+
+	// reads the item's clip in if it was left in the file, ahead of it getting weight
+	void loadItem(int index) {
+		if (index < 0 || index >= items.size()) return;
+		items[index].animationInstance.animation->loadClip(items[index].clip);
+	}
+
+	// index of the item playing `name`, -1 if there is none; for init, not per frame
+	int findItem(const std::string& name) const {
+		for (int i = 0; i < items.size(); i++)
+			if (items[i].animationName == name)
+				return i;
+		return -1;
+	}
+
+	// item with the largest weight among the started clips, -1 while nothing has weight
+	int dominantItem() const {
+		int best = -1;
+		for (int i = 0; i < items.size(); i++) {
+			if (globalTime < items[i].startTime || items[i].weight <= 0.0f) continue;
+			if (best < 0 || items[i].weight > items[best].weight)
+				best = i;
+		}
+		return best;
+	}
+
+	// pose memory owned by this sequencer, including the pooled buffers it currently holds
+	size_t sizeInBytes() const {
+		size_t bytes = sizeof(Sequencer) + items.capacity() * sizeof(Item) + matrices.capacity() * sizeof(Mat4) + blended.sizeInBytes();
+		for (const auto& item : items) {
+			bytes += item.animationInstance.pose.sizeInBytes() + item.animationInstance.matrices.capacity() * sizeof(Mat4);
+			if (item.pose != nullptr)
+				bytes += sizeof(LocalPose) + item.pose->sizeInBytes();
+		}
+		return bytes;
+	}
+
+	void samplePose(Item& item) {
+		AnimationInstance& instance = item.animationInstance;
+		int frame;
+		float interpolationFact;
+		instance.calcFrame(frame, interpolationFact);
+		instance.animation->samplePose(item.clip, frame, interpolationFact, *item.pose, item.poseSampled ? detail : PoseDetail());
+		item.poseSampled = true;
+	}
+
+	void cachedPose(Item& item) {
+		Animation* animation = item.animationInstance.animation;
+		int bones = animation->bonesSize();
+		int step;
+		float t = poseCache->snap(item.animationInstance.t, step);
+		PoseCache::Key key = { animation->cacheKey(), item.clip, step, detail.interpolate };
+		const Mat4* palette = poseCache->find(key);
+		if (palette == nullptr) {
+			animation->samplePose(item.clip, t, *item.pose, detail);
+			animation->poseToMatrices(*item.pose, matrices.data());
+			poseCache->insert(key, matrices.data(), bones);
+		}
+		else {
+			memcpy(matrices.data(), palette, bones * sizeof(Mat4));
+		}
+		// the item's own pose wasn't touched on a hit
+		item.poseSampled = false;
+	}
+
+	void releasePoses() {
+		for (auto& item : items) {
+			if (item.pose != nullptr)
+				item.animationInstance.animation->posePool.release(item.pose);
+			item.pose = nullptr;
+		}
 	}
 
 	void setWeights(std::vector<float> weights) {
@@ -256,86 +1150,122 @@ public:
 	}
 
 	~Sequencer() {
+		releasePoses();
 		items.clear();
 	}
 };
 
 
 
+// States are sequencer items, addressed by the index findState returns. Blend times come from a
+// states x states transition table filled at init, so neither transitionTo nor update touch a name.
+// A state's clip is read from its file the first time the machine moves to it.
 class StateMachine {
 public:
 	Sequencer* sequencer;
-	std::string currentState;
-	std::vector<std::string> stateList;
+	int currentState;
+	std::vector<int> stateList;
 	std::vector<float> transitionTimes;
+	std::vector<float> transitionTable;	// [from * stateCount() + to], empty until the first setTransitionTime
+	float defaultTransitionTime = 0.2f;	// for transitions the table doesn't set
 	float transTime;	// remaining time for current transition
 
-	StateMachine() : sequencer(nullptr) {}
+	StateMachine() : sequencer(nullptr), currentState(-1), transTime(0.0f) {}
 
-	StateMachine(Sequencer* seq) : sequencer(seq), currentState(""), transTime(0.0f) {}
+	StateMachine(Sequencer* seq) : sequencer(seq), currentState(-1), transTime(0.0f) {}
 
-	int getStateIndex(std::string state) {
-		for (int i = 0; i < sequencer->items.size(); i++) {
-			if (sequencer->items[i].animationName == state) {
-				return i;
-			}
-		}
-		return -1;
+	// state handle for a clip name, -1 if the sequencer has no such clip; for init, not per frame
+	int findState(const std::string& state) const {
+		return sequencer->findItem(state);
+	}
+
+	int stateCount() const {
+		return (int)sequencer->items.size();
+	}
+
+	void setTransitionTime(int from, int to, float time) {
+		int states = stateCount();
+		if (from < 0 || to < 0 || from >= states || to >= states) return;
+		if ((int)transitionTable.size() != states * states)
+			transitionTable.assign(states * states, defaultTransitionTime);
+		transitionTable[from * states + to] = time;
+	}
+
+	// the same blend time into `to` from every state
+	void setTransitionTime(int to, float time) {
+		for (int from = 0; from < stateCount(); from++)
+			setTransitionTime(from, to, time);
+	}
+
+	float transitionTime(int from, int to) const {
+		int states = stateCount();
+		if (from < 0 || to < 0 || (int)transitionTable.size() != states * states)
+			return defaultTransitionTime;
+		return transitionTable[from * states + to];
+	}
+
+	// queue a transition with the table's blend time from the last queued (or current) state
+	void transitionTo(int state) {
+		int from = stateList.size() > 0 ? stateList.back() : currentState;
+		transitionTo(state, transitionTime(from, state));
 	}
 
 	// add a state transition to the queue
-	void transitionTo(std::string state, float time) {
+	void transitionTo(int state, float time) {
 		// check if state exists in sequencer
-		int index = getStateIndex(state);
-		if (index == -1) return;
+		if (state < 0 || state >= stateCount()) return;
 		// if last state is same as new state, ignore
 		if (stateList.size() > 0 && stateList.back() == state || stateList.size() > 3) return;
 		if (currentState == state) return;
 		stateList.push_back(state);
 		transitionTimes.push_back(time);
+		sequencer->loadItem(state);
 	}
 
 	// set current state immediately, clearing any queued transitions
-	void setCurrentState(std::string state) {
+	void setCurrentState(int state) {
 		currentState = state;
 		stateList.clear();
-		int currentIndex = getStateIndex(currentState);
-		if (currentIndex != -1) {
+		transitionTimes.clear();
+		if (currentState >= 0 && currentState < stateCount()) {
+			sequencer->loadItem(currentState);
 			sequencer->clearWeights();
-			sequencer->setWeight(currentIndex, 1.0f);
+			sequencer->setWeight(currentState, 1.0f);
 		}
 	}
 
+	// Loads and marks every clip the next update can give weight to: the weighted ones and the queued
+	// states. ActorList calls it for every actor on one thread before updating poses in parallel, so
+	// actors sharing an Animation never load a clip or set its flags at the same time.
+	void useClips() {
+		sequencer->useClips();
+		for (int state : stateList)
+			sequencer->useItem(state);
+	}
+
 	void update(float dt) {
 		// No states to process
 		if (stateList.size() != 0) {
 			// First time setup
-			if (currentState == "") {
+			if (currentState < 0) {
 				currentState = stateList[0];
 				stateList.erase(stateList.begin());
 				transitionTimes.erase(transitionTimes.begin());
-				int currentIndex = getStateIndex(currentState);
-				if (currentIndex != -1) {
-					sequencer->clearWeights();
-					sequencer->setWeight(currentIndex, 1.0f);
-				}
+				sequencer->clearWeights();
+				sequencer->setWeight(currentState, 1.0f);
 			}
 			else {
 				// Process transition
-				std::string nextState = stateList[0];
+				int nextState = stateList[0];
 				// Initialize transition time
 				if (transTime <= 0.0f)
 					transTime = transitionTimes[0];
 				// Update transition time
 				transTime -= dt;
 				// Update weights
-				int currentIndex = getStateIndex(currentState);
-				int nextIndex = getStateIndex(nextState);
-				if (currentIndex != -1 && nextIndex != -1) {
-					float factor = remap(transTime, 0.0f, transitionTimes[0], 1.0f, 0.0f);
-					sequencer->setWeight(currentIndex, 1.0f - factor);
-					sequencer->setWeight(nextIndex, factor);
-				}
+				float factor = remap(transTime, 0.0f, transitionTimes[0], 1.0f, 0.0f);
+				sequencer->setWeight(currentState, 1.0f - factor);
+				sequencer->setWeight(nextState, factor);
 				// Check if transition complete
 				if (transTime <= 0.0f) {
 					currentState = nextState;
@@ -354,13 +1284,11 @@ public:
 		if (stateList.size() == 0) {
 			transTime = 0.0f;
 			sequencer->clearWeights();
-			int currentIndex = getStateIndex(currentState);
-			if (currentIndex != -1) {
-				sequencer->setWeight(currentIndex, 1.0f);
-			}
+			if (currentState >= 0)
+				sequencer->setWeight(currentState, 1.0f);
 		}
 
 		// Debug output
-		//DebugPrint("Current State: " + currentState + ", Next States: " + std::to_string(stateList.size()) + ", Transition Time: " + std::to_string(transTime));
+		//DebugPrint("Current State: " + sequencer->items[currentState].animationName + ", Next States: " + std::to_string(stateList.size()) + ", Transition Time: " + std::to_string(transTime));
 	}
 };
\ No newline at end of file
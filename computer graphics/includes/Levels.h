@@ -21,6 +21,22 @@
 
 #define SAVE_DIR "Levels/"
 
+// Model fix-up rotations, folded at compile time
+constexpr Quat PLAYER_MODEL_ROTATION = Quat::fromAxisAngle(Vec3(1.0f, 0.0f, 0.0f), 90.0f) * Quat::fromAxisAngle(Vec3(0.0f, 0.0f, 1.0f), 180.0f);
+constexpr Quat HEN_MODEL_ROTATION = Quat::fromAxisAngle(Vec3(0.0f, 1.0f, 0.0f), 180.0f);
+
+// Boundary walls and corner posts as { centre, half size }
+constexpr Vec3 BOUNDARY_WALLS[][2] = {
+	{ Vec3(60.0f, 0.0f, 0.0f), Vec3(2.0f, 5.0f, 60.0f) },
+	{ Vec3(-60.0f, 0.0f, 0.0f), Vec3(2.0f, 5.0f, 60.0f) },
+	{ Vec3(0.0f, 0.0f, 60.0f), Vec3(60.0f, 5.0f, 2.0f) },
+	{ Vec3(0.0f, 0.0f, -60.0f), Vec3(60.0f, 5.0f, 2.0f) },
+	{ Vec3(60.0f, 0.0f, 60.0f), Vec3(2.0f, 5.0f, 2.0f) },
+	{ Vec3(-60.0f, 0.0f, 60.0f), Vec3(2.0f, 5.0f, 2.0f) },
+	{ Vec3(60.0f, 0.0f, -60.0f), Vec3(2.0f, 5.0f, 2.0f) },
+	{ Vec3(-60.0f, 0.0f, -60.0f), Vec3(2.0f, 5.0f, 2.0f) },
+};
+
 
 
 class LevelManager {
@@ -151,6 +167,8 @@ class GameContext {
 	HitboxManager hitboxManager = HitboxManager(&eventBus);
 	UIManager uiManager = UIManager(&psos);
 	LevelManager levelManager = LevelManager();
+	JobSystem jobSystem = JobSystem();	// one thread per core, for ActorList's animation pass
+	ModelCache models;	// hens share one model per file, each Object only adds its transform and materials
 
 public:
 	// actors and objects
@@ -162,7 +180,7 @@ public:
 
 	// params
 	Mat4 VP = camera.getViewProjectionMatrix();
-	Mat4 W = Mat4()._Identity();
+	Mat4 W = Mat4::_Identity();
 	Vec3 playerPos = Vec3(0.0f, 0.0f, 0.0f);
 	Mat4 skyboxBuffer_W;
 	float animationTransition = 0.0f;
@@ -184,6 +202,8 @@ public:
 
 		// Create shaders
 		shaderManager.createShader(core, "animatedShader", "./hlsl/AnimatedVS.hlsl", "./hlsl/BasicPS.hlsl");
+		shaderManager.createShader(core, "animated3x4Shader", "./hlsl/AnimatedVS3x4.hlsl", "./hlsl/BasicPS.hlsl");
+		shaderManager.createShader(core, "animatedDualQuatShader", "./hlsl/AnimatedDualQuatVS.hlsl", "./hlsl/BasicPS.hlsl");
 		shaderManager.createShader(core, "basicShader", "./hlsl/BasicVS.hlsl", "./hlsl/BasicPS.hlsl");
 		shaderManager.createShader(core, "skyboxShader", "./hlsl/Skybox.hlsl", "./hlsl/Skybox.hlsl");
 		shaderManager.createShader(core, "instancedShader", "./hlsl/InstancedVS.hlsl", "./hlsl/BasicPS.hlsl");
@@ -192,6 +212,8 @@ public:
 
 		// Create PSO manager
 		psos.createPSO(core, "animatedPSO", "animatedShader", LayoutCache::getAnimatedLayout());
+		psos.createPSO(core, "animated3x4PSO", "animated3x4Shader", LayoutCache::getAnimatedLayout());
+		psos.createPSO(core, "animatedDualQuatPSO", "animatedDualQuatShader", LayoutCache::getAnimatedLayout());
 		psos.createPSO(core, "basicPSO", "basicShader", LayoutCache::getStaticLayout());
 		psos.createPSO(core, "skyboxPSO", "skyboxShader", LayoutCache::getStaticLayout());
 		psos.createPSO(core, "instancedPSO", "instancedShader", LayoutCache::getInstancedLayout());
@@ -227,55 +249,51 @@ public:
 
 
 		// add boundary
-		hitboxManager.addHitbox(nullptr, Vec3(60.0f, 0.0f, 0.0f), Vec3(2.0f, 5.0f, 60.0f));
-		hitboxManager.addHitbox(nullptr, Vec3(-60.0f, 0.0f, 0.0f), Vec3(2.0f, 5.0f, 60.0f));
-		hitboxManager.addHitbox(nullptr, Vec3(0.0f, 0.0f, 60.0f), Vec3(60.0f, 5.0f, 2.0f));
-		hitboxManager.addHitbox(nullptr, Vec3(0.0f, 0.0f, -60.0f), Vec3(60.0f, 5.0f, 2.0f));
-		hitboxManager.addHitbox(nullptr, Vec3(60.0f, 0.0f, 60.0f), Vec3(2.0f, 5.0f, 2.0f));
-		hitboxManager.addHitbox(nullptr, Vec3(-60.0f, 0.0f, 60.0f), Vec3(2.0f, 5.0f, 2.0f));
-		hitboxManager.addHitbox(nullptr, Vec3(60.0f, 0.0f, -60.0f), Vec3(2.0f, 5.0f, 2.0f));
-		hitboxManager.addHitbox(nullptr, Vec3(-60.0f, 0.0f, -60.0f), Vec3(2.0f, 5.0f, 2.0f));
+		for (const auto& wall : BOUNDARY_WALLS)
+			hitboxManager.addHitbox(nullptr, wall[0], wall[1]);
 
 		// Load Player
 		Object* player = new Object(&psos);
 		player->loadGEM(core, "Models/AnimatedLowPolyAnimals/Farmer-male.gem", "animatedPSO");
 		player->setDiffuseTexture(imageLoader.getImage("AnimalsColorMap"));
 		player->setNormalTexture(imageLoader.getImage("AnimalsNormalMap"));
-		player->rotateBy(90.0f, X_AXIS);
-		player->rotateBy(180.0f, Z_AXIS);
+		player->rotateBy(PLAYER_MODEL_ROTATION);
 		player->scale = Vec3(0.05f, 0.05f, 0.05f);
 		this->player = new Player(win);
 		this->player->init(player);
+		this->player->setPaletteFormat(PALETTE_MAT3X4);
 		this->player->bindCamera(&camera);
 		hitboxManager.addHitbox(this->player, Vec3(0.0f, 0.0f, 0.0f), Vec3(0.7f, 1.0f, 0.7f));
 		this->player->subscribeEvent(&eventBus);
 
 		// Hens
 		this->actors = new ActorList();
+		this->actors->jobs = &jobSystem;
 		for (int i = 0; i < scoreToWin; i++) {
 			Object* hen = new Object(&psos);
 			// randomly select hen model
 			int r = rand() % 4;
 			switch (r) {
 			case 0:
-				hen->loadGEM(core, HEN_BROWN, "animatedPSO");
+				hen->loadGEM(core, models, HEN_BROWN, "animatedPSO");
 				break;
 			case 1:
-				hen->loadGEM(core, HEN_WHITE, "animatedPSO");
+				hen->loadGEM(core, models, HEN_WHITE, "animatedPSO");
 				break;
 			case 2:
-				hen->loadGEM(core, ROOSTER_DARK, "animatedPSO");
+				hen->loadGEM(core, models, ROOSTER_DARK, "animatedPSO");
 				break;
 			case 3:
-				hen->loadGEM(core, ROOSTER_BROWN, "animatedPSO");
+				hen->loadGEM(core, models, ROOSTER_BROWN, "animatedPSO");
 				break;
 			}
 			hen->setDiffuseTexture(imageLoader.getImage("AnimalsColorMap"));
 			hen->setNormalTexture(imageLoader.getImage("AnimalsNormalMap"));
-			hen->rotateBy(180.0f, Y_AXIS);
+			hen->rotateBy(HEN_MODEL_ROTATION);
 			hen->scale = Vec3(0.05f, 0.05f, 0.05f);
 			Hen* henActor = new Hen();
 			henActor->init(hen);
+			henActor->setPaletteFormat(PALETTE_MAT3X4);
 			henActor->setPlayer(this->player);
 			henActor->type = r;	// save hen type
 			henActor->position = Vec3(((float)(rand() % 1000) / 1000.0f - 0.5) * 100.0f, 0.0f, ((float)(rand() % 1000) / 1000.0f - 0.5) * 100.0f);
@@ -323,7 +341,7 @@ public:
 		for (int i = -5; i < 5; i++) {
 			for (int j = -5; j < 5; j++) {
 				InstanceData inst;
-				inst.World = Mat4().Translate(i * 40.0f, 0.0f, j * 40.0f);
+				inst.World = Mat4::Translate(i * 40.0f, 0.0f, j * 40.0f);
 				inst.World = inst.World.Transpose();
 				groundInstanceData.push_back(inst);
 			}
@@ -347,7 +365,7 @@ public:
 			float randZ = ((float)(rand() % 1000) / 1000.0f - 0.5f) * 120.0f;
 			float randRotation = ((float)(rand() % 1000) / 1000.0f) * 360.0f;
 			float randScale = ((float)(rand() % 1000) / 1000.0f) * 0.01f + 0.005f;
-			inst.World = Mat4().Translate(randX, 0, randZ) * Mat4().RotateY(randRotation) * Mat4().Scale(randScale, randScale, randScale);
+			inst.World = Mat4::Translate(randX, 0, randZ) * Mat4::RotateY(randRotation) * Mat4::Scale(randScale, randScale, randScale);
 			inst.World = inst.World.Transpose();
 			instanceDatas.push_back(inst);
 		}
@@ -370,7 +388,7 @@ public:
 			float randZ = ((float)(rand() % 1000) / 1000.0f - 0.5f) * 120.0f;
 			float randRotation = ((float)(rand() % 1000) / 1000.0f) * 360.0f;
 			float randScale = ((float)(rand() % 1000) / 1000.0f) * 0.01f + 0.005f;
-			inst.World = Mat4().Translate(randX, 0, randZ) * Mat4().RotateY(randRotation) * Mat4().Scale(randScale, randScale, randScale);
+			inst.World = Mat4::Translate(randX, 0, randZ) * Mat4::RotateY(randRotation) * Mat4::Scale(randScale, randScale, randScale);
 			inst.World = inst.World.Transpose();
 			instanceDatas2.push_back(inst);
 		}
@@ -393,7 +411,7 @@ public:
 			float randZ = ((float)(rand() % 1000) / 1000.0f - 0.5f) * 120.0f;
 			float randRotation = ((float)(rand() % 1000) / 1000.0f) * 360.0f;
 			float randScale = ((float)(rand() % 1000) / 1000.0f) * 0.01f + 0.005f;
-			inst.World = Mat4().Translate(randX, 0, randZ) * Mat4().RotateY(randRotation) * Mat4().Scale(randScale, randScale, randScale);
+			inst.World = Mat4::Translate(randX, 0, randZ) * Mat4::RotateY(randRotation) * Mat4::Scale(randScale, randScale, randScale);
 			inst.World = inst.World.Transpose();
 			instanceDatas3.push_back(inst);
 		}
@@ -417,7 +435,7 @@ public:
 			InstanceData inst;
 			float randRotation = ((float)(rand() % 1000) / 1000.0f) * 360.0f;
 			float randScale = ((float)(rand() % 1000) / 1000.0f) * 0.05f + 0.02f;
-			inst.World = Mat4().Translate(61, 0, 3 * i - 60) * Mat4().RotateY(randRotation) * Mat4().Scale(randScale, randScale, randScale);
+			inst.World = Mat4::Translate(61, 0, 3 * i - 60) * Mat4::RotateY(randRotation) * Mat4::Scale(randScale, randScale, randScale);
 			inst.World = inst.World.Transpose();
 			bambooInstanceDatas.push_back(inst);
 		}
@@ -425,7 +443,7 @@ public:
 			InstanceData inst;
 			float randRotation = ((float)(rand() % 1000) / 1000.0f) * 360.0f;
 			float randScale = ((float)(rand() % 1000) / 1000.0f) * 0.05f + 0.02f;
-			inst.World = Mat4().Translate(-61, 0, 3 * i - 60) * Mat4().RotateY(randRotation) * Mat4().Scale(randScale, randScale, randScale);
+			inst.World = Mat4::Translate(-61, 0, 3 * i - 60) * Mat4::RotateY(randRotation) * Mat4::Scale(randScale, randScale, randScale);
 			inst.World = inst.World.Transpose();
 			bambooInstanceDatas.push_back(inst);
 		}
@@ -433,7 +451,7 @@ public:
 			InstanceData inst;
 			float randRotation = ((float)(rand() % 1000) / 1000.0f) * 360.0f;
 			float randScale = ((float)(rand() % 1000) / 1000.0f) * 0.05f + 0.02f;
-			inst.World = Mat4().Translate(3 * i - 60, 0, 61) * Mat4().RotateY(randRotation) * Mat4().Scale(randScale, randScale, randScale);
+			inst.World = Mat4::Translate(3 * i - 60, 0, 61) * Mat4::RotateY(randRotation) * Mat4::Scale(randScale, randScale, randScale);
 			inst.World = inst.World.Transpose();
 			bambooInstanceDatas.push_back(inst);
 		}
@@ -441,7 +459,7 @@ public:
 			InstanceData inst;
 			float randRotation = ((float)(rand() % 1000) / 1000.0f) * 360.0f;
 			float randScale = ((float)(rand() % 1000) / 1000.0f) * 0.05f + 0.02f;
-			inst.World = Mat4().Translate(3 * i - 60, 0, -61) * Mat4().RotateY(randRotation) * Mat4().Scale(randScale, randScale, randScale);
+			inst.World = Mat4::Translate(3 * i - 60, 0, -61) * Mat4::RotateY(randRotation) * Mat4::Scale(randScale, randScale, randScale);
 			inst.World = inst.World.Transpose();
 			bambooInstanceDatas.push_back(inst);
 		}
@@ -466,7 +484,11 @@ public:
 		
 
 		// set constant buffer pointers
-		shaderManager.setConstantBufferValuePointer("animatedShader", "animatedMeshBuffer", "VP", &VP, VERTEX_SHADER);
+		// every bone palette format's shader, actors draw with whichever matches their palette
+		for (const char* animated : { "animatedShader", "animated3x4Shader", "animatedDualQuatShader" }) {
+			shaderManager.setConstantBufferValuePointer(animated, "animatedMeshBuffer", "VP", &VP, VERTEX_SHADER);
+			shaderManager.setConstantBufferValuePointer(animated, "basicPSBuffer", "lightDirection", &lightDirection, PIXEL_SHADER);
+		}
 		shaderManager.setConstantBufferValuePointer("basicShader", "staticMeshBuffer", "W", &W, VERTEX_SHADER);
 		shaderManager.setConstantBufferValuePointer("basicShader", "staticMeshBuffer", "VP", &VP, VERTEX_SHADER);
 		shaderManager.setConstantBufferValuePointer("skyboxShader", "skyboxBuffer", "W", &skyboxBuffer_W, VERTEX_SHADER);
@@ -478,7 +500,6 @@ public:
 		shaderManager.setConstantBufferValuePointer("instancedStaticShader", "staticMeshBuffer", "W", &W, VERTEX_SHADER);
 		shaderManager.setConstantBufferValuePointer("instancedStaticShader", "staticMeshBuffer", "VP", &VP, VERTEX_SHADER);
 
-		shaderManager.setConstantBufferValuePointer("animatedShader", "basicPSBuffer", "lightDirection", &lightDirection, PIXEL_SHADER);
 		shaderManager.setConstantBufferValuePointer("basicShader", "basicPSBuffer", "lightDirection", &lightDirection, PIXEL_SHADER);
 		shaderManager.setConstantBufferValuePointer("instancedShader", "basicPSBuffer", "lightDirection", &lightDirection, PIXEL_SHADER);
 		shaderManager.setConstantBufferValuePointer("instancedStaticShader", "basicPSBuffer", "lightDirection", &lightDirection, PIXEL_SHADER);
@@ -540,9 +561,10 @@ public:
 
 			// update parameters
 			player->update(dt);
+			actors->updateAnimationLOD(camera);
 			actors->update(dt);
 			VP = camera.getViewProjectionMatrix();
-			skyboxBuffer_W = Mat4().Translate(camera.position.v[0], camera.position.v[1], camera.position.v[2]) * Mat4().Scale(camera.clipFar - 1, camera.clipFar - 1, camera.clipFar - 1);
+			skyboxBuffer_W = Mat4::Translate(camera.position.v[0], camera.position.v[1], camera.position.v[2]) * Mat4::Scale(camera.clipFar - 1, camera.clipFar - 1, camera.clipFar - 1);
 			playerPos = player->position;
 			std::vector<InstanceData> grass003_update = RotateInstanceObjectByPlayer("grass003");
 			std::vector<InstanceData> grass007_update = RotateInstanceObjectByPlayer("grass007");
@@ -615,16 +637,27 @@ public:
 		Vec3 playerPos = this->player->position;
 		auto it = instanceDataMap.find(objectName);
 		if (it != instanceDataMap.end()) {
-			for (size_t i = 0; i < it->second.size(); i++) {
-				// calculate rotation based on distance to player
-				Mat4 instanceWorld = it->second[i].World.Transpose();	
+			int count = (int)it->second.size();
+			// bend angle falls off with squared distance to the player, exp and sincos run over all instances at once
+			std::vector<float> angles(count), sines(count), cosines(count);
+			for (int i = 0; i < count; i++) {
+				const Mat4& world = it->second[i].World;
+				Vec3 dir = playerPos - Vec3(world.m[3][0], world.m[3][1], world.m[3][2]);
+				float length = dir.getLength() + 0.3;
+				angles[i] = -length * length / 5.0f;
+			}
+			FastMath::exp(angles.data(), angles.data(), count);
+			for (int i = 0; i < count; i++)
+				angles[i] *= 30.0f * FastMath::degToRad;
+			FastMath::sincos(angles.data(), sines.data(), cosines.data(), count);
+			updatedInstanceData.reserve(count);
+			for (int i = 0; i < count; i++) {
+				Mat4 instanceWorld = it->second[i].World.Transpose();
 				Vec3 instancePos = Vec3(instanceWorld.m[0][3], instanceWorld.m[1][3], instanceWorld.m[2][3]);
 				Vec3 dir = playerPos - instancePos;
-				float length = dir.getLength() + 0.3;
-				length *= length;
 				Vec3 axis = Vec3(0.0f, 1.0f, 0.0f).cross(dir).normalize();
-				Mat4 rotationMat = Mat4().Rotate(30.0f * expf(-length / 5.0f), axis);
-				Mat4 newWorld = Mat4().Translate(instancePos.v[0], instancePos.v[1], instancePos.v[2]) * rotationMat * Mat4().Scale(instanceWorld.m[0][0], instanceWorld.m[1][1], instanceWorld.m[2][2]);
+				Mat4 rotationMat = Mat4::RotateSinCos(sines[i], cosines[i], axis);
+				Mat4 newWorld = Mat4::Translate(instancePos.v[0], instancePos.v[1], instancePos.v[2]) * rotationMat * Mat4::Scale(instanceWorld.m[0][0], instanceWorld.m[1][1], instanceWorld.m[2][2]);
 				InstanceData newInst;
 				newInst.World = newWorld.Transpose();
 				updatedInstanceData.push_back(newInst);
@@ -675,24 +708,25 @@ public:
 			int r = henActor->type;
 			switch (r) {
 			case 0:
-				hen->loadGEM(core, HEN_BROWN, "animatedPSO");
+				hen->loadGEM(core, models, HEN_BROWN, "animatedPSO");
 				break;
 			case 1:
-				hen->loadGEM(core, HEN_WHITE, "animatedPSO");
+				hen->loadGEM(core, models, HEN_WHITE, "animatedPSO");
 				break;
 			case 2:
-				hen->loadGEM(core, ROOSTER_DARK, "animatedPSO");
+				hen->loadGEM(core, models, ROOSTER_DARK, "animatedPSO");
 				break;
 			case 3:
-				hen->loadGEM(core, ROOSTER_BROWN, "animatedPSO");
+				hen->loadGEM(core, models, ROOSTER_BROWN, "animatedPSO");
 				break;
 			}
 			hen->setDiffuseTexture(imageLoader.getImage("AnimalsColorMap"));
 			hen->setNormalTexture(imageLoader.getImage("AnimalsNormalMap"));
-			hen->rotateBy(180.0f, Y_AXIS);
+			hen->rotateBy(HEN_MODEL_ROTATION);
 			hen->scale = Vec3(0.05f, 0.05f, 0.05f);
 			// init hen actor
 			henActor->init(hen);
+			henActor->setPaletteFormat(PALETTE_MAT3X4);
 			henActor->setPlayer(this->player);
 			henActor->type = r;	// save hen type
 			henActor->position = henActors[i]->position;
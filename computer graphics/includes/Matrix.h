@@ -4,27 +4,68 @@
 #include <algorithm>
 #include <iostream>
 #include <math.h>
+#include <type_traits>
+#include <cstring>
+
+#include "SIMD.h"
+#include "FastMath.h"
 
 class Vec3;
 class Vec4;
 
+
+
+// Trig usable in constant expressions, so transforms with literal angles fold at compile time.
+// At runtime these forward to FastMath.
+namespace ConstMath {
+	constexpr double pi = 3.14159265358979323846;
+
+	// Taylor series after reducing x to [-pi, pi], accurate to double precision
+	constexpr double sinSeries(double x)
+	{
+		double k = (double)(long long)(x / (2.0 * pi));
+		x -= k * 2.0 * pi;
+		if (x > pi) x -= 2.0 * pi;
+		if (x < -pi) x += 2.0 * pi;
+		double term = x;
+		double sum = x;
+		for (int n = 1; n < 16; n++) {
+			term *= -x * x / ((2.0 * n) * (2.0 * n + 1.0));
+			sum += term;
+		}
+		return sum;
+	}
+
+	constexpr void sincosDeg(float angle, float& s, float& c)
+	{
+		if (std::is_constant_evaluated()) {
+			s = (float)sinSeries(angle * pi / 180.0);
+			c = (float)sinSeries(angle * pi / 180.0 + pi / 2.0);
+			return;
+		}
+		FastMath::sincosDeg(angle, s, c);
+	}
+}
+
 class Mat4 {
 public:
 	float m[4][4];
-	Mat4()
-	{
-		for (int i = 0; i < 4; i++)
-			m[i][i] = 1.0f;
-		for (int i = 0; i < 4; i++)
-			for (int j = 0; j < 4; j++)
-				if (i != j)
-					m[i][j] = 0.0f;
-	}
+	constexpr Mat4() : m{ { 1.0f, 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 0.0f, 1.0f } } {}
+
+	// Elements in row order
+	constexpr Mat4(float m00, float m01, float m02, float m03,
+		float m10, float m11, float m12, float m13,
+		float m20, float m21, float m22, float m23,
+		float m30, float m31, float m32, float m33)
+		: m{ { m00, m01, m02, m03 }, { m10, m11, m12, m13 }, { m20, m21, m22, m23 }, { m30, m31, m32, m33 } } {}
 
-	Mat4 _Identity()
+	// Tag to skip the identity fill when every element is written straight after
+	struct Uninitialised {};
+	constexpr Mat4(Uninitialised) {}
+
+	static constexpr Mat4 _Identity()
 	{
-		Mat4 mat;
-		return mat;
+		return Mat4();
 	}
 
 	float& operator[](int index)
@@ -38,20 +79,130 @@ public:
 		return m[row][col];
 	}
 
-	Mat4 operator*(const Mat4& mat) const
+	// out = a * b, out may alias either input
+	static void multiply(const Mat4& a, const Mat4& b, Mat4& out)
 	{
-		Mat4 result;
+#ifdef MATH_SIMD_SSE
+		__m128 b0 = _mm_loadu_ps(b.m[0]);
+		__m128 b1 = _mm_loadu_ps(b.m[1]);
+		__m128 b2 = _mm_loadu_ps(b.m[2]);
+		__m128 b3 = _mm_loadu_ps(b.m[3]);
+		for (int i = 0; i < 4; i++) {
+			// each result row is a linear combination of the rows of b
+			__m128 row = _mm_mul_ps(_mm_set1_ps(a.m[i][0]), b0);
+			row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(a.m[i][1]), b1));
+			row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(a.m[i][2]), b2));
+			row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(a.m[i][3]), b3));
+			_mm_storeu_ps(out.m[i], row);
+		}
+#else
+		Mat4 result = Mat4(Uninitialised());
 		for (int i = 0; i < 4; i++) {
 			for (int j = 0; j < 4; j++) {
-				result.m[i][j] = m[i][0] * mat.m[0][j] +
-					m[i][1] * mat.m[1][j] +
-					m[i][2] * mat.m[2][j] +
-					m[i][3] * mat.m[3][j];
+				result.m[i][j] = a.m[i][0] * b.m[0][j] +
+					a.m[i][1] * b.m[1][j] +
+					a.m[i][2] * b.m[2][j] +
+					a.m[i][3] * b.m[3][j];
+			}
+		}
+		out = result;
+#endif
+	}
+
+	// out[i] = a[i] * b[i] for count matrices
+	static void multiplyBatch(const Mat4* a, const Mat4* b, Mat4* out, int count)
+	{
+#ifdef MATH_SIMD_AVX
+		for (int n = 0; n < count; n++) {
+			// two result rows per iteration, b rows duplicated in both lanes
+			__m256 b0 = _mm256_broadcast_ps((const __m128*)b[n].m[0]);
+			__m256 b1 = _mm256_broadcast_ps((const __m128*)b[n].m[1]);
+			__m256 b2 = _mm256_broadcast_ps((const __m128*)b[n].m[2]);
+			__m256 b3 = _mm256_broadcast_ps((const __m128*)b[n].m[3]);
+			for (int i = 0; i < 4; i += 2) {
+				__m256 rows = _mm256_loadu_ps(a[n].m[i]);
+				__m256 r = _mm256_mul_ps(_mm256_permute_ps(rows, 0x00), b0);
+				r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_permute_ps(rows, 0x55), b1));
+				r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_permute_ps(rows, 0xAA), b2));
+				r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_permute_ps(rows, 0xFF), b3));
+				_mm256_storeu_ps(out[n].m[i], r);
 			}
 		}
+#else
+		for (int n = 0; n < count; n++)
+			multiply(a[n], b[n], out[n]);
+#endif
+	}
+
+	// out[i] = a * b[i], e.g. one parent transform applied to many children
+	static void multiplyBatch(const Mat4& a, const Mat4* b, Mat4* out, int count)
+	{
+#ifdef MATH_SIMD_SSE
+		// broadcast the rows of a once for the whole batch
+		__m128 a00 = _mm_set1_ps(a.m[0][0]), a01 = _mm_set1_ps(a.m[0][1]), a02 = _mm_set1_ps(a.m[0][2]), a03 = _mm_set1_ps(a.m[0][3]);
+		__m128 a10 = _mm_set1_ps(a.m[1][0]), a11 = _mm_set1_ps(a.m[1][1]), a12 = _mm_set1_ps(a.m[1][2]), a13 = _mm_set1_ps(a.m[1][3]);
+		__m128 a20 = _mm_set1_ps(a.m[2][0]), a21 = _mm_set1_ps(a.m[2][1]), a22 = _mm_set1_ps(a.m[2][2]), a23 = _mm_set1_ps(a.m[2][3]);
+		__m128 a30 = _mm_set1_ps(a.m[3][0]), a31 = _mm_set1_ps(a.m[3][1]), a32 = _mm_set1_ps(a.m[3][2]), a33 = _mm_set1_ps(a.m[3][3]);
+		for (int n = 0; n < count; n++) {
+			__m128 b0 = _mm_loadu_ps(b[n].m[0]);
+			__m128 b1 = _mm_loadu_ps(b[n].m[1]);
+			__m128 b2 = _mm_loadu_ps(b[n].m[2]);
+			__m128 b3 = _mm_loadu_ps(b[n].m[3]);
+			_mm_storeu_ps(out[n].m[0], _mm_add_ps(_mm_add_ps(_mm_mul_ps(a00, b0), _mm_mul_ps(a01, b1)), _mm_add_ps(_mm_mul_ps(a02, b2), _mm_mul_ps(a03, b3))));
+			_mm_storeu_ps(out[n].m[1], _mm_add_ps(_mm_add_ps(_mm_mul_ps(a10, b0), _mm_mul_ps(a11, b1)), _mm_add_ps(_mm_mul_ps(a12, b2), _mm_mul_ps(a13, b3))));
+			_mm_storeu_ps(out[n].m[2], _mm_add_ps(_mm_add_ps(_mm_mul_ps(a20, b0), _mm_mul_ps(a21, b1)), _mm_add_ps(_mm_mul_ps(a22, b2), _mm_mul_ps(a23, b3))));
+			_mm_storeu_ps(out[n].m[3], _mm_add_ps(_mm_add_ps(_mm_mul_ps(a30, b0), _mm_mul_ps(a31, b1)), _mm_add_ps(_mm_mul_ps(a32, b2), _mm_mul_ps(a33, b3))));
+		}
+#else
+		for (int n = 0; n < count; n++)
+			multiply(a, b[n], out[n]);
+#endif
+	}
+
+	// out = a * b where both have a last row of 0 0 0 1 (TRS and other affine transforms),
+	// 36 multiplies instead of 64, out may alias either input
+	static void multiplyAffine(const Mat4& a, const Mat4& b, Mat4& out)
+	{
+#ifdef MATH_SIMD_SSE
+		__m128 b0 = _mm_loadu_ps(b.m[0]);
+		__m128 b1 = _mm_loadu_ps(b.m[1]);
+		__m128 b2 = _mm_loadu_ps(b.m[2]);
+		__m128 lastRow = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+		__m128 rows[3];
+		for (int i = 0; i < 3; i++) {
+			__m128 row = _mm_mul_ps(_mm_set1_ps(a.m[i][0]), b0);
+			row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(a.m[i][1]), b1));
+			row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(a.m[i][2]), b2));
+			rows[i] = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(a.m[i][3]), lastRow));
+		}
+		_mm_storeu_ps(out.m[0], rows[0]);
+		_mm_storeu_ps(out.m[1], rows[1]);
+		_mm_storeu_ps(out.m[2], rows[2]);
+		_mm_storeu_ps(out.m[3], lastRow);
+#else
+		Mat4 result;
+		for (int i = 0; i < 3; i++) {
+			for (int j = 0; j < 4; j++)
+				result.m[i][j] = a.m[i][0] * b.m[0][j] + a.m[i][1] * b.m[1][j] + a.m[i][2] * b.m[2][j];
+			result.m[i][3] += a.m[i][3];
+		}
+		out = result;
+#endif
+	}
+
+	constexpr Mat4 operator*(const Mat4& mat) const
+	{
+		Mat4 result = Mat4(Uninitialised());
+		if (std::is_constant_evaluated()) {
+			for (int i = 0; i < 4; i++)
+				for (int j = 0; j < 4; j++)
+					result.m[i][j] = m[i][0] * mat.m[0][j] + m[i][1] * mat.m[1][j] + m[i][2] * mat.m[2][j] + m[i][3] * mat.m[3][j];
+			return result;
+		}
+		multiply(*this, mat, result);
 		return result;
 	}
-	Mat4 operator*(float val) const
+	constexpr Mat4 operator*(float val) const
 	{
 		Mat4 result;
 		for (int i = 0; i < 4; i++) {
@@ -66,7 +217,7 @@ public:
 		*this = *this * mat;
 		return *this;
 	}
-	Mat4 operator+(const Mat4& mat) const
+	constexpr Mat4 operator+(const Mat4& mat) const
 	{
 		Mat4 result;
 		for (int i = 0; i < 4; i++) {
@@ -85,7 +236,7 @@ public:
 		}
 		return *this;
 	}
-	Mat4 operator-(const Mat4& mat) const
+	constexpr Mat4 operator-(const Mat4& mat) const
 	{
 		Mat4 result;
 		for (int i = 0; i < 4; i++) {
@@ -95,7 +246,7 @@ public:
 		}
 		return result;
 	}
-	Mat4 operator-() const
+	constexpr Mat4 operator-() const
 	{
 		Mat4 result;
 		for (int i = 0; i < 4; i++) {
@@ -117,19 +268,10 @@ public:
 
 	Mat4 Dot(const Mat4& mat) const
 	{
-		Mat4 result;
-		for (int i = 0; i < 4; i++) {
-			for (int j = 0; j < 4; j++) {
-				result.m[i][j] = m[i][0] * mat.m[0][j] +
-					m[i][1] * mat.m[1][j] +
-					m[i][2] * mat.m[2][j] +
-					m[i][3] * mat.m[3][j];
-			}
-		}
-		return result;
+		return *this * mat;
 	}
 
-	Mat4 Transpose() const
+	constexpr Mat4 Transpose() const
 	{
 		Mat4 result;
 		for (int i = 0; i < 4; i++) {
@@ -140,43 +282,47 @@ public:
 		return result;
 	}
 
-	Mat4 RotateX(float angle)
+	// Transform factories, angles in degrees. Static, so no throwaway identity is needed to call
+	// them, and constexpr, so literal arguments fold at compile time.
+	static constexpr Mat4 RotateX(float angle)
 	{
-		Mat4 mat = _Identity();
-		float rad = angle * (float)M_PI / 180.0f;
-		float c = cosf(rad);
-		float s = sinf(rad);
+		Mat4 mat;
+		float s, c;
+		ConstMath::sincosDeg(angle, s, c);
 		mat.m[1][1] = c;  mat.m[1][2] = -s;
 		mat.m[2][1] = s;  mat.m[2][2] = c;
 		return mat;
 	}
-	Mat4 RotateY(float angle)
+	static constexpr Mat4 RotateY(float angle)
 	{
-		Mat4 mat = _Identity();
-		float rad = angle * (float)M_PI / 180.0f;
-		float c = cosf(rad);
-		float s = sinf(rad);
+		Mat4 mat;
+		float s, c;
+		ConstMath::sincosDeg(angle, s, c);
 		mat.m[0][0] = c;  mat.m[0][2] = s;
 		mat.m[2][0] = -s;  mat.m[2][2] = c;
 		return mat;
 	}
-	Mat4 RotateZ(float angle)
+	static constexpr Mat4 RotateZ(float angle)
 	{
-		Mat4 mat = _Identity();
-		float rad = angle * (float)M_PI / 180.0f;
-		float c = cosf(rad);
-		float s = sinf(rad);
+		Mat4 mat;
+		float s, c;
+		ConstMath::sincosDeg(angle, s, c);
 		mat.m[0][0] = c;  mat.m[0][1] = -s;
 		mat.m[1][0] = s;  mat.m[1][1] = c;
 		return mat;
 	}
 	template<typename T>
-	Mat4 Rotate(float angle, T axis)
+	static Mat4 Rotate(float angle, T axis)
+	{
+		float s, c;
+		FastMath::sincosDeg(angle, s, c);
+		return RotateSinCos(s, c, axis);
+	}
+	// Rotate with the sine and cosine of the angle already known, e.g. from FastMath::sincos over an array
+	template<typename T>
+	static Mat4 RotateSinCos(float s, float c, T axis)
 	{
-		Mat4 mat = _Identity();
-		float rad = angle * (float)M_PI / 180.0f;
-		float c = cosf(rad);
-		float s = sinf(rad);
+		Mat4 mat;
 		float t = 1.0f - c;
 		axis = axis.normalize();
 		mat.m[0][0] = c + axis.v[0] * axis.v[0] * t;
@@ -190,56 +336,185 @@ public:
 		mat.m[2][2] = c + axis.v[2] * axis.v[2] * t;
 		return mat;
 	}
-	Mat4 Translate(float x, float y, float z)
+	static constexpr Mat4 Translate(float x, float y, float z)
 	{
-		Mat4 mat = _Identity();
+		Mat4 mat;
 		mat.m[0][3] = x;
 		mat.m[1][3] = y;
 		mat.m[2][3] = z;
 		return mat;
 	}
-	Mat4 Scale(float x, float y, float z)
+	static constexpr Mat4 Scale(float x, float y, float z)
 	{
-		Mat4 mat = _Identity();
+		Mat4 mat;
 		mat.m[0][0] = x;
 		mat.m[1][1] = y;
 		mat.m[2][2] = z;
 		return mat;
 	}
 
-	Mat4 invert()
+	// General inverse, returns identity if the matrix is singular
+	Mat4 invert() const
 	{
-		Mat4 original = *this;
-		Mat4 inv;
-		float det = original[0] * original[0] + original[1] * original[4] + original[2] * original[8] + original[3] * original[12];
+#ifdef MATH_SIMD_SSE
+		return invertSIMD();
+#else
+		return invertScalar();
+#endif
+	}
+
+	// Cofactor expansion on the flat 16-float view
+	Mat4 invertScalar() const
+	{
+		const float* o = &m[0][0];
+		Mat4 inv = Mat4(Uninitialised());
+		float* r = &inv.m[0][0];
+		r[0] = o[5] * o[10] * o[15] - o[5] * o[11] * o[14] - o[9] * o[6] * o[15] + o[9] * o[7] * o[14] + o[13] * o[6] * o[11] - o[13] * o[7] * o[10];
+		r[4] = -o[4] * o[10] * o[15] + o[4] * o[11] * o[14] + o[8] * o[6] * o[15] - o[8] * o[7] * o[14] - o[12] * o[6] * o[11] + o[12] * o[7] * o[10];
+		r[8] = o[4] * o[9] * o[15] - o[4] * o[11] * o[13] - o[8] * o[5] * o[15] + o[8] * o[7] * o[13] + o[12] * o[5] * o[11] - o[12] * o[7] * o[9];
+		r[12] = -o[4] * o[9] * o[14] + o[4] * o[10] * o[13] + o[8] * o[5] * o[14] - o[8] * o[6] * o[13] - o[12] * o[5] * o[10] + o[12] * o[6] * o[9];
+		// determinant by expansion along the first row
+		float det = o[0] * r[0] + o[1] * r[4] + o[2] * r[8] + o[3] * r[12];
 		if (det == 0) {
 			std::cout << "Matrix inversion failed: determinant is zero." << std::endl;
-			return inv;
+			return Mat4();
 		}
+		r[1] = -o[1] * o[10] * o[15] + o[1] * o[11] * o[14] + o[9] * o[2] * o[15] - o[9] * o[3] * o[14] - o[13] * o[2] * o[11] + o[13] * o[3] * o[10];
+		r[5] = o[0] * o[10] * o[15] - o[0] * o[11] * o[14] - o[8] * o[2] * o[15] + o[8] * o[3] * o[14] + o[12] * o[2] * o[11] - o[12] * o[3] * o[10];
+		r[9] = -o[0] * o[9] * o[15] + o[0] * o[11] * o[13] + o[8] * o[1] * o[15] - o[8] * o[3] * o[13] - o[12] * o[1] * o[11] + o[12] * o[3] * o[9];
+		r[13] = o[0] * o[9] * o[14] - o[0] * o[10] * o[13] - o[8] * o[1] * o[14] + o[8] * o[2] * o[13] + o[12] * o[1] * o[10] - o[12] * o[2] * o[9];
+		r[2] = o[1] * o[6] * o[15] - o[1] * o[7] * o[14] - o[5] * o[2] * o[15] + o[5] * o[3] * o[14] + o[13] * o[2] * o[7] - o[13] * o[3] * o[6];
+		r[6] = -o[0] * o[6] * o[15] + o[0] * o[7] * o[14] + o[4] * o[2] * o[15] - o[4] * o[3] * o[14] - o[12] * o[2] * o[7] + o[12] * o[3] * o[6];
+		r[10] = o[0] * o[5] * o[15] - o[0] * o[7] * o[13] - o[4] * o[1] * o[15] + o[4] * o[3] * o[13] + o[12] * o[1] * o[7] - o[12] * o[3] * o[5];
+		r[14] = -o[0] * o[5] * o[14] + o[0] * o[6] * o[13] + o[4] * o[1] * o[14] - o[4] * o[2] * o[13] - o[12] * o[1] * o[6] + o[12] * o[2] * o[5];
+		r[3] = -o[1] * o[6] * o[11] + o[1] * o[7] * o[10] + o[5] * o[2] * o[11] - o[5] * o[3] * o[10] - o[9] * o[2] * o[7] + o[9] * o[3] * o[6];
+		r[7] = o[0] * o[6] * o[11] - o[0] * o[7] * o[10] - o[4] * o[2] * o[11] + o[4] * o[3] * o[10] + o[8] * o[2] * o[7] - o[8] * o[3] * o[6];
+		r[11] = -o[0] * o[5] * o[11] + o[0] * o[7] * o[9] + o[4] * o[1] * o[11] - o[4] * o[3] * o[9] - o[8] * o[1] * o[7] + o[8] * o[3] * o[5];
+		r[15] = o[0] * o[5] * o[10] - o[0] * o[6] * o[9] - o[4] * o[1] * o[10] + o[4] * o[2] * o[9] + o[8] * o[1] * o[6] - o[8] * o[2] * o[5];
 		det = 1.0f / det;
-		inv[0] = original[5] * original[10] * original[15] - original[5] * original[11] * original[14] - original[9] * original[6] * original[15] + original[9] * original[7] * original[14] + original[13] * original[6] * original[11] - original[13] * original[7] * original[10];
-		inv[4] = -original[4] * original[10] * original[15] + original[4] * original[11] * original[14] + original[8] * original[6] * original[15] - original[8] * original[7] * original[14] - original[12] * original[6] * original[11] + original[12] * original[7] * original[10];
-		inv[8] = original[4] * original[9] * original[15] - original[4] * original[11] * original[13] - original[8] * original[5] * original[15] + original[8] * original[7] * original[13] + original[12] * original[5] * original[11] - original[12] * original[7] * original[9];
-		inv[12] = -original[4] * original[9] * original[14] + original[4] * original[10] * original[13] + original[8] * original[5] * original[14] - original[8] * original[6] * original[13] - original[12] * original[5] * original[10] + original[12] * original[6] * original[9];
-		inv[1] = -original[1] * original[10] * original[15] + original[1] * original[11] * original[14] + original[9] * original[2] * original[15] - original[9] * original[3] * original[14] - original[13] * original[2] * original[11] + original[13] * original[3] * original[10];
-		inv[5] = original[0] * original[10] * original[15] - original[0] * original[11] * original[14] - original[8] * original[2] * original[15] + original[8] * original[3] * original[14] + original[12] * original[2] * original[11] - original[12] * original[3] * original[10];
-		inv[9] = -original[0] * original[9] * original[15] + original[0] * original[11] * original[13] + original[8] * original[1] * original[15] - original[8] * original[3] * original[13] - original[12] * original[1] * original[11] + original[12] * original[3] * original[9];
-		inv[13] = original[0] * original[9] * original[14] - original[0] * original[10] * original[13] - original[8] * original[1] * original[14] + original[8] * original[2] * original[13] + original[12] * original[1] * original[10] - original[12] * original[2] * original[9];
-		inv[2] = original[1] * original[6] * original[15] - original[1] * original[7] * original[14] - original[5] * original[2] * original[15] + original[5] * original[3] * original[14] + original[13] * original[2] * original[7] - original[13] * original[3] * original[6];
-		inv[6] = -original[0] * original[6] * original[15] + original[0] * original[7] * original[14] + original[4] * original[2] * original[15] - original[4] * original[3] * original[14] - original[12] * original[2] * original[7] + original[12] * original[3] * original[6];
-		inv[10] = original[0] * original[5] * original[15] - original[0] * original[7] * original[13] - original[4] * original[1] * original[15] + original[4] * original[3] * original[13] + original[12] * original[1] * original[7] - original[12] * original[3] * original[5];
-		inv[14] = -original[0] * original[5] * original[14] + original[0] * original[6] * original[13] + original[4] * original[1] * original[14] - original[4] * original[2] * original[13] - original[12] * original[1] * original[6] + original[12] * original[2] * original[5];
-		inv[3] = -original[1] * original[6] * original[11] + original[1] * original[7] * original[10] + original[5] * original[2] * original[11] - original[5] * original[3] * original[10] - original[9] * original[2] * original[7] + original[9] * original[3] * original[6];
-		inv[7] = original[0] * original[6] * original[11] - original[0] * original[7] * original[10] - original[4] * original[2] * original[11] + original[4] * original[3] * original[10] + original[8] * original[2] * original[7] - original[8] * original[3] * original[6];
-		inv[11] = -original[0] * original[5] * original[11] + original[0] * original[7] * original[9] + original[4] * original[1] * original[11] - original[4] * original[3] * original[9] - original[8] * original[1] * original[7] + original[8] * original[3] * original[5];
-		inv[15] = original[0] * original[5] * original[10] - original[0] * original[6] * original[9] - original[4] * original[1] * original[10] + original[4] * original[2] * original[9] + original[8] * original[1] * original[6] - original[8] * original[2] * original[5];
 		for (int i = 0; i < 16; i++) {
-			inv[i] = inv[i] * det;
+			r[i] = r[i] * det;
 		}
 		return inv;
 	}
 
-	Mat4 rotationQuaternion(float x, float y, float z, float w)
+#ifdef MATH_SIMD_SSE
+	// Blockwise inverse on 2x2 sub-matrices, each sub-matrix held row-major in one register
+	Mat4 invertSIMD() const
+	{
+		__m128 r0 = _mm_loadu_ps(m[0]);
+		__m128 r1 = _mm_loadu_ps(m[1]);
+		__m128 r2 = _mm_loadu_ps(m[2]);
+		__m128 r3 = _mm_loadu_ps(m[3]);
+		// M = | A B |
+		//     | C D |
+		__m128 A = _mm_movelh_ps(r0, r1);
+		__m128 B = _mm_movehl_ps(r1, r0);
+		__m128 C = _mm_movelh_ps(r2, r3);
+		__m128 D = _mm_movehl_ps(r3, r2);
+		// (|A|, |B|, |C|, |D|)
+		__m128 detSub = _mm_sub_ps(
+			_mm_mul_ps(_mm_shuffle_ps(r0, r2, _MM_SHUFFLE(2, 0, 2, 0)), _mm_shuffle_ps(r1, r3, _MM_SHUFFLE(3, 1, 3, 1))),
+			_mm_mul_ps(_mm_shuffle_ps(r0, r2, _MM_SHUFFLE(3, 1, 3, 1)), _mm_shuffle_ps(r1, r3, _MM_SHUFFLE(2, 0, 2, 0))));
+		__m128 detA = _mm_shuffle_ps(detSub, detSub, _MM_SHUFFLE(0, 0, 0, 0));
+		__m128 detB = _mm_shuffle_ps(detSub, detSub, _MM_SHUFFLE(1, 1, 1, 1));
+		__m128 detC = _mm_shuffle_ps(detSub, detSub, _MM_SHUFFLE(2, 2, 2, 2));
+		__m128 detD = _mm_shuffle_ps(detSub, detSub, _MM_SHUFFLE(3, 3, 3, 3));
+		__m128 D_C = mat2AdjMul(D, C);
+		__m128 A_B = mat2AdjMul(A, B);
+		// X# = |D|A - B(D#C), W# = |A|D - C(A#B)
+		__m128 X_ = _mm_sub_ps(_mm_mul_ps(detD, A), mat2Mul(B, D_C));
+		__m128 W_ = _mm_sub_ps(_mm_mul_ps(detA, D), mat2Mul(C, A_B));
+		// Y# = |B|C - D(A#B)#, Z# = |C|B - A(D#C)#
+		__m128 Y_ = _mm_sub_ps(_mm_mul_ps(detB, C), mat2MulAdj(D, A_B));
+		__m128 Z_ = _mm_sub_ps(_mm_mul_ps(detC, B), mat2MulAdj(A, D_C));
+		// |M| = |A||D| + |B||C| - tr((A#B)(D#C))
+		__m128 tr = _mm_mul_ps(A_B, _mm_shuffle_ps(D_C, D_C, _MM_SHUFFLE(3, 1, 2, 0)));
+		tr = _mm_add_ps(tr, _mm_shuffle_ps(tr, tr, _MM_SHUFFLE(2, 3, 0, 1)));
+		tr = _mm_add_ps(tr, _mm_shuffle_ps(tr, tr, _MM_SHUFFLE(1, 0, 3, 2)));
+		__m128 detM = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(detA, detD), _mm_mul_ps(detB, detC)), tr);
+		if (_mm_cvtss_f32(detM) == 0) {
+			std::cout << "Matrix inversion failed: determinant is zero." << std::endl;
+			return Mat4();
+		}
+		// (1/|M|, -1/|M|, -1/|M|, 1/|M|) applies the adjugate signs
+		__m128 rDetM = _mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), detM);
+		X_ = _mm_mul_ps(X_, rDetM);
+		Y_ = _mm_mul_ps(Y_, rDetM);
+		Z_ = _mm_mul_ps(Z_, rDetM);
+		W_ = _mm_mul_ps(W_, rDetM);
+		// adjugate transpose folded into the store shuffle
+		Mat4 inv = Mat4(Uninitialised());
+		_mm_storeu_ps(inv.m[0], _mm_shuffle_ps(X_, Y_, _MM_SHUFFLE(1, 3, 1, 3)));
+		_mm_storeu_ps(inv.m[1], _mm_shuffle_ps(X_, Y_, _MM_SHUFFLE(0, 2, 0, 2)));
+		_mm_storeu_ps(inv.m[2], _mm_shuffle_ps(Z_, W_, _MM_SHUFFLE(1, 3, 1, 3)));
+		_mm_storeu_ps(inv.m[3], _mm_shuffle_ps(Z_, W_, _MM_SHUFFLE(0, 2, 0, 2)));
+		return inv;
+	}
+
+	// 2x2 helpers for invertSIMD: A * B, A# * B and A * B#, where # is the adjugate
+	static __m128 mat2Mul(__m128 a, __m128 b)
+	{
+		return _mm_add_ps(_mm_mul_ps(a, _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 3, 0))),
+			_mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)), _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 2, 1, 2))));
+	}
+	static __m128 mat2AdjMul(__m128 a, __m128 b)
+	{
+		return _mm_sub_ps(_mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(0, 0, 3, 3)), b),
+			_mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 2, 1, 1)), _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 0, 3, 2))));
+	}
+	static __m128 mat2MulAdj(__m128 a, __m128 b)
+	{
+		return _mm_sub_ps(_mm_mul_ps(a, _mm_shuffle_ps(b, b, _MM_SHUFFLE(0, 3, 0, 3))),
+			_mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)), _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 2, 1, 2))));
+	}
+#endif
+
+	// Inverse of an affine matrix (bottom row 0 0 0 1), e.g. a TRS world matrix
+	Mat4 invertAffine() const
+	{
+		// adjugate of the upper 3x3
+		float c00 = m[1][1] * m[2][2] - m[1][2] * m[2][1];
+		float c01 = m[0][2] * m[2][1] - m[0][1] * m[2][2];
+		float c02 = m[0][1] * m[1][2] - m[0][2] * m[1][1];
+		float c10 = m[1][2] * m[2][0] - m[1][0] * m[2][2];
+		float c11 = m[0][0] * m[2][2] - m[0][2] * m[2][0];
+		float c12 = m[0][2] * m[1][0] - m[0][0] * m[1][2];
+		float c20 = m[1][0] * m[2][1] - m[1][1] * m[2][0];
+		float c21 = m[0][1] * m[2][0] - m[0][0] * m[2][1];
+		float c22 = m[0][0] * m[1][1] - m[0][1] * m[1][0];
+		float det = m[0][0] * c00 + m[0][1] * c10 + m[0][2] * c20;
+		if (det == 0) {
+			std::cout << "Matrix inversion failed: determinant is zero." << std::endl;
+			return Mat4();
+		}
+		det = 1.0f / det;
+		Mat4 inv;
+		inv.m[0][0] = c00 * det; inv.m[0][1] = c01 * det; inv.m[0][2] = c02 * det;
+		inv.m[1][0] = c10 * det; inv.m[1][1] = c11 * det; inv.m[1][2] = c12 * det;
+		inv.m[2][0] = c20 * det; inv.m[2][1] = c21 * det; inv.m[2][2] = c22 * det;
+		// translation = -A^-1 * t
+		inv.m[0][3] = -(inv.m[0][0] * m[0][3] + inv.m[0][1] * m[1][3] + inv.m[0][2] * m[2][3]);
+		inv.m[1][3] = -(inv.m[1][0] * m[0][3] + inv.m[1][1] * m[1][3] + inv.m[1][2] * m[2][3]);
+		inv.m[2][3] = -(inv.m[2][0] * m[0][3] + inv.m[2][1] * m[1][3] + inv.m[2][2] * m[2][3]);
+		return inv;
+	}
+
+	// Inverse of a rotation + translation matrix (orthonormal upper 3x3), e.g. getLookatMatrix
+	Mat4 invertRigid() const
+	{
+		Mat4 inv;
+		for (int i = 0; i < 3; i++)
+			for (int j = 0; j < 3; j++)
+				inv.m[i][j] = m[j][i];
+		// translation = -R^T * t
+		inv.m[0][3] = -(m[0][0] * m[0][3] + m[1][0] * m[1][3] + m[2][0] * m[2][3]);
+		inv.m[1][3] = -(m[0][1] * m[0][3] + m[1][1] * m[1][3] + m[2][1] * m[2][3]);
+		inv.m[2][3] = -(m[0][2] * m[0][3] + m[1][2] * m[1][3] + m[2][2] * m[2][3]);
+		return inv;
+	}
+
+	static constexpr Mat4 rotationQuaternion(float x, float y, float z, float w)
 	{
 		Mat4 rotation;
 		rotation.m[0][0] = 1 - 2 * y * y - 2 * z * z;
@@ -255,3 +530,43 @@ public:
 	}
 
 };
+
+
+
+// Top three rows of an affine Mat4 (the last row is always 0 0 0 1), the compact form for bone
+// palettes: 48 bytes instead of 64, each row a float4 as the shaders read them
+class Mat3x4 {
+public:
+	float m[3][4];
+
+	static Mat3x4 fromMat4(const Mat4& mat)
+	{
+		Mat3x4 result;
+		memcpy(result.m, mat.m, sizeof(result.m));
+		return result;
+	}
+
+	Mat4 toMat4() const
+	{
+		Mat4 result;
+		memcpy(result.m, m, sizeof(m));
+		return result;
+	}
+
+	// a * (1 - t) + b * t, row by row
+	static Mat3x4 lerp(const Mat3x4& a, const Mat3x4& b, float t)
+	{
+		Mat3x4 result;
+#ifdef MATH_SIMD_SSE
+		__m128 vd = _mm_set1_ps(1.0f - t);
+		__m128 vt = _mm_set1_ps(t);
+		for (int i = 0; i < 3; i++)
+			_mm_storeu_ps(result.m[i], _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(a.m[i]), vd), _mm_mul_ps(_mm_loadu_ps(b.m[i]), vt)));
+#else
+		for (int i = 0; i < 3; i++)
+			for (int j = 0; j < 4; j++)
+				result.m[i][j] = a.m[i][j] * (1.0f - t) + b.m[i][j] * t;
+#endif
+		return result;
+	}
+};
@@ -2,82 +2,17 @@
 
 #include "Vector.h"
 #include "Operators.h"
+#include "Transform.h"
+#include "Vertex.h"
 #include "Core.h"
 #include "GEMLoader.h"
 #include "Shader.h"
 #include "Animation.h"
+#include "AnimatedBounds.h"
+#include "CookedModel.h"
 #include "Image.h"
-
-
-
-class Colour
-{
-public:
-	float r;
-	float g;
-	float b;
-	Colour() : r(0), g(0), b(0) {}
-	Colour(float red, float green, float blue) : r(red), g(green), b(blue) {}
-	Colour operator*(const Colour& col) const
-	{
-		return Colour(r * col.r, g * col.g, b * col.b);
-	}
-	Colour operator*(const float val) const
-	{
-		return Colour(r * val, g * val, b * val);
-	}
-	Colour operator/(const float val) const
-	{
-		return Colour(r / val, g / val, b / val);
-	}
-};
-
-struct PRIM_VERTEX
-{
-	Vec3 position;
-	Colour colour;
-};
-
-struct STATIC_VERTEX
-{
-	Vec3 pos;
-	Vec3 normal;
-	Vec3 tangent;
-	float uv[2];
-};
-
-struct ANIMATED_VERTEX
-{
-	Vec3 pos;
-	Vec3 normal;
-	Vec3 tangent;
-	float uv[2];
-	unsigned int bonesIDs[4];
-	float boneWeights[4];
-};
-
-struct UI_VERTEX
-{
-	float pos[2];
-	float uv[2];
-};
-
-STATIC_VERTEX addVertex(Vec3 p, Vec3 n, float tu, float tv)
-{
-	STATIC_VERTEX v;
-	v.pos = p;
-	v.normal = n;
-	v.tangent = anyOrthogonal(n).normalize();
-	v.uv[0] = tu;
-	v.uv[1] = tv;
-	return v;
-}
-
-struct InstanceData {
-	Mat4 World;
-	Vec4 Color;
-};
-
+#include <memory>
+#include <unordered_map>
 
 
 
@@ -154,6 +89,16 @@ public:
 	}
 };
 
+// What an Object draws one of its meshes with, when the mesh is shared with other objects and
+// can't carry its own (see ModelCache)
+struct MeshMaterial {
+	std::string psoName;
+	Image* diffuseTexture = nullptr;
+	Image* normalTexture = nullptr;
+};
+
+
+
 class Mesh {
 public:
 	// Vertex buffer
@@ -173,7 +118,7 @@ public:
 	Image* normalTexture = nullptr;
 	bool useNormalTexture = false;
 
-	virtual void init(Core* core, void* vertices, int vertexSizeInBytes, int numVertices, unsigned int* indices, int numIndices)
+	virtual void init(Core* core, const void* vertices, int vertexSizeInBytes, int numVertices, const unsigned int* indices, int numIndices)
 	{
 		// Create an upload heap to upload the vertex buffer data
 		D3D12_HEAP_PROPERTIES heapprops = {};
@@ -225,19 +170,34 @@ public:
 
 	}
 
-	virtual void init(Core* core, std::vector<STATIC_VERTEX> vertices, std::vector<unsigned int> indices)
+	virtual void init(Core* core, const std::vector<STATIC_VERTEX>& vertices, const std::vector<unsigned int>& indices)
 	{
 		init(core, &vertices[0], sizeof(STATIC_VERTEX), vertices.size(), &indices[0], indices.size());
 		inputLayoutDesc = LayoutCache::getStaticLayout();
 	}
 
-	virtual void init(Core* core, std::vector<ANIMATED_VERTEX> vertices, std::vector<unsigned int> indices)
+	virtual void init(Core* core, const std::vector<ANIMATED_VERTEX>& vertices, const std::vector<unsigned int>& indices)
 	{
 		init(core, &vertices[0], sizeof(ANIMATED_VERTEX), vertices.size(), &indices[0], indices.size());
 		inputLayoutDesc = LayoutCache::getAnimatedLayout();
 	}
 
-	virtual void init(Core* core, std::vector<UI_VERTEX> vertices, std::vector<unsigned int> indices)
+	// Straight from a mapped GEM file, whose vertex records have the same layout as ours
+	void init(Core* core, const GEMLoader::GEMSpan<GEMLoader::GEMStaticVertex>& vertices, const GEMLoader::GEMSpan<unsigned int>& indices)
+	{
+		static_assert(sizeof(GEMLoader::GEMStaticVertex) == sizeof(STATIC_VERTEX), "GEM static vertex layout");
+		init(core, vertices.data(), sizeof(STATIC_VERTEX), vertices.size(), (const unsigned int*)indices.data(), indices.size());
+		inputLayoutDesc = LayoutCache::getStaticLayout();
+	}
+
+	void init(Core* core, const GEMLoader::GEMSpan<GEMLoader::GEMAnimatedVertex>& vertices, const GEMLoader::GEMSpan<unsigned int>& indices)
+	{
+		static_assert(sizeof(GEMLoader::GEMAnimatedVertex) == sizeof(ANIMATED_VERTEX), "GEM animated vertex layout");
+		init(core, vertices.data(), sizeof(ANIMATED_VERTEX), vertices.size(), (const unsigned int*)indices.data(), indices.size());
+		inputLayoutDesc = LayoutCache::getAnimatedLayout();
+	}
+
+	virtual void init(Core* core, const std::vector<UI_VERTEX>& vertices, const std::vector<unsigned int>& indices)
 	{
 		init(core, &vertices[0], sizeof(UI_VERTEX), vertices.size(), &indices[0], indices.size());
 		inputLayoutDesc = LayoutCache::getUILayout();
@@ -246,6 +206,18 @@ public:
 	virtual void draw(Core* core, Shader* shader)
 	{
 		applyTexture(core, shader);
+		drawIndexed(core);
+	}
+
+	// with an object's textures instead of the mesh's own
+	void draw(Core* core, Shader* shader, const MeshMaterial& material)
+	{
+		applyTexture(core, shader, material.diffuseTexture, material.diffuseTexture != nullptr, material.normalTexture, material.normalTexture != nullptr);
+		drawIndexed(core);
+	}
+
+	void drawIndexed(Core* core)
+	{
 		core->getCommandList()->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 		core->getCommandList()->IASetVertexBuffers(0, 1, &vbView);
 		core->getCommandList()->IASetIndexBuffer(&ibView);
@@ -266,24 +238,21 @@ public:
 
 	void applyTexture(Core* core, Shader* shader)
 	{
-		if (diffuseTexture != nullptr)
-		{
-			diffuseTexture->apply(core, DIFFUSE_TEXTURE_SLOT);
-		}
-		else
-		{
-			bool useTex = false;
-		}
-		if (normalTexture != nullptr)
+		applyTexture(core, shader, diffuseTexture, useDiffuseTexture, normalTexture, useNormalTexture);
+	}
+
+	void applyTexture(Core* core, Shader* shader, Image* diffuse, bool useDiffuse, Image* normal, bool useNormal)
+	{
+		if (diffuse != nullptr)
 		{
-			normalTexture->apply(core, NORMAL_TEXTURE_SLOT);
+			diffuse->apply(core, DIFFUSE_TEXTURE_SLOT);
 		}
-		else
+		if (normal != nullptr)
 		{
-			bool useNormalMap = false;
+			normal->apply(core, NORMAL_TEXTURE_SLOT);
 		}
-		shader->updateConstantBuffer("basicPSBuffer", "useTexture", &useDiffuseTexture, PIXEL_SHADER);
-		shader->updateConstantBuffer("basicPSBuffer", "useNormalMap", &useNormalTexture, PIXEL_SHADER);
+		shader->updateConstantBuffer("basicPSBuffer", "useTexture", &useDiffuse, PIXEL_SHADER);
+		shader->updateConstantBuffer("basicPSBuffer", "useNormalMap", &useNormal, PIXEL_SHADER);
 	}
 };
 
@@ -413,16 +382,19 @@ public:
 		rings = pRings;
 		segments = pSegments;
 		radius = pRadius;
+		// sines and cosines of every ring and segment angle in two batched calls
+		std::vector<float> theta(rings + 1), sinTheta(rings + 1), cosTheta(rings + 1);
+		std::vector<float> phi(segments + 1), sinPhi(segments + 1), cosPhi(segments + 1);
+		for (int lat = 0; lat <= rings; lat++)
+			theta[lat] = lat * M_PI / rings;
+		for (int lon = 0; lon <= segments; lon++)
+			phi[lon] = lon * 2.0f * M_PI / segments;
+		FastMath::sincos(theta.data(), sinTheta.data(), cosTheta.data(), rings + 1);
+		FastMath::sincos(phi.data(), sinPhi.data(), cosPhi.data(), segments + 1);
 		for (int lat = 0; lat <= rings; lat++) {
-			float theta = lat * M_PI / rings;
-			float sinTheta = sinf(theta);
-			float cosTheta = cosf(theta);
 			for (int lon = 0; lon <= segments; lon++) {
-				float phi = lon * 2.0f * M_PI / segments;
-				float sinPhi = sinf(phi);
-				float cosPhi = cosf(phi);
-				Vec3 position(radius * sinTheta * cosPhi, radius * cosTheta,
-					radius * sinTheta * sinPhi);
+				Vec3 position(radius * sinTheta[lat] * cosPhi[lon], radius * cosTheta[lat],
+					radius * sinTheta[lat] * sinPhi[lon]);
 				Vec3 normal = position.normalize();
 				float tu = (float)lon / segments;
 				float tv = (float)lat / rings;
@@ -451,46 +423,43 @@ public:
 
 enum axis { X_AXIS, Y_AXIS, Z_AXIS };
 
-class Object{
+// What every object loaded from one model file has in common: the meshes' GPU buffers, the skeleton
+// and clips, and the bounds. Objects keep their own transforms and materials; see ModelCache for
+// sharing one between them.
+class Model {
 public:
+	std::string filename;
 	std::vector<Mesh*> meshes;
 	Animation animation;
-
-	PSOManager* psoManager;
-	
-	Vec3 position = Vec3(0, 0, 0);
-	Vec4 rotation = Vec4(0, 0, 0, 1); // Quaternion
-	Vec3 scale = Vec3(1, 1, 1);
-	Mat4 worldMatrix;
-
-	Object() : psoManager(nullptr) {}
-
-	Object(PSOManager* psoMgr) : psoManager(psoMgr) {}
-
-	void loadGEM(Core* core, const char* filename, std::vector<std::string> psonames) {
-		// Load GEM file
-		int numPSOs = psonames.size();
-		GEMLoader::GEMModelLoader loader;
-		std::vector<GEMLoader::GEMMesh> gemmeshes;
-		GEMLoader::GEMAnimation gemanimation;
-		loader.load(filename, gemmeshes, gemanimation);
+	AnimatedBounds bounds;	// model space, per clip segment for animated meshes
+
+	Model() {}
+	// the clip loaders and pooled poses point into the animation
+	Model(const Model&) = delete;
+	Model& operator=(const Model&) = delete;
+
+	void load(Core* core, const char* filename) {
+		this->filename = filename;
+		// a .gemc cooked from this file and still current is loaded instead
+		std::shared_ptr<CookedModel> cooked = std::make_shared<CookedModel>();
+		if (cooked->open(std::string(filename) + "c", filename)) {
+			loadCooked(core, cooked);
+			animation.prepareForSharing();
+			return;
+		}
+		// Map the GEM file; vertices and indices are uploaded straight from the mapping
+		std::shared_ptr<GEMLoader::GEMMappedModel> model = std::make_shared<GEMLoader::GEMMappedModel>();
+		if (!model->open(filename)) {
+			std::cout << model->error << std::endl;
+			exit(0);
+		}
+		const GEMLoader::GEMAnimation& gemanimation = model->animation;
 		// check if have animation
 		if (gemanimation.bones.size() > 0) {
 			// Load Meshes
-			for (int i = 0; i < gemmeshes.size(); i++) {
+			for (int i = 0; i < model->meshes.size(); i++) {
 				Mesh* mesh = new Mesh();
-				std::vector<ANIMATED_VERTEX> vertices;
-				for (int j = 0; j < gemmeshes[i].verticesAnimated.size(); j++) {
-					ANIMATED_VERTEX v;
-					memcpy(&v, &gemmeshes[i].verticesAnimated[j], sizeof(ANIMATED_VERTEX));
-					vertices.push_back(v);
-				}
-				mesh->init(core, vertices, gemmeshes[i].indices);
-				// Assign PSO name based on mesh index
-				if (i < numPSOs)
-					mesh->psoNames = psonames[i];
-				else
-					mesh->psoNames = psonames[numPSOs - 1];
+				mesh->init(core, model->meshes[i].verticesAnimated, model->meshes[i].indices);
 				meshes.push_back(mesh);
 			}
 			// Load Bones for Animation
@@ -502,52 +471,158 @@ public:
 				bone.parentIndex = gemanimation.bones[i].parentIndex;
 				animation.skeleton.bones.push_back(bone);
 			}
-			// Load Animations and copy data
-			for (int i = 0; i < gemanimation.animations.size(); i++)
+			memcpy(&animation.skeleton.globalInverse, &gemanimation.globalInverse, 16 * sizeof(float));
+			animation.skeleton.prepare();
+			// bone space boxes of the vertices each bone moves, for the per clip bounds
+			for (int i = 0; i < model->meshes.size(); i++) {
+				const GEMLoader::GEMSpan<GEMLoader::GEMAnimatedVertex>& vertices = model->meshes[i].verticesAnimated;
+				for (int j = 0; j < vertices.size(); j++) {
+					GEMLoader::GEMAnimatedVertex v = vertices[j];
+					bounds.addVertex(animation.skeleton, Vec3(v.position.x, v.position.y, v.position.z), v.bonesIDs, v.boneWeights);
+				}
+			}
+			animation.sourceId = std::hash<std::string>()(filename);
+			// One empty sequence per indexed clip, so names, handles and durations are known up front
+			for (const GEMLoader::GEMClipIndexEntry& clip : model->clips.clips)
 			{
-				std::string name = gemanimation.animations[i].name;
 				AnimationSequence aseq;
-				aseq.ticksPerSecond = gemanimation.animations[i].ticksPerSecond;
-				for (int n = 0; n < gemanimation.animations[i].frames.size(); n++)
-				{
-					AnimationFrame frame;
-					for (int index = 0; index < gemanimation.animations[i].frames[n].positions.size(); index++)
-					{
-						Vec3 p;
-						Vec4 q;
-						Vec3 s;
-						memcpy(&p, &gemanimation.animations[i].frames[n].positions[index], sizeof(Vec3));
-						frame.positions.push_back(p);
-						memcpy(&q, &gemanimation.animations[i].frames[n].rotations[index], sizeof(Vec4));
-						frame.rotations.push_back(q);
-						memcpy(&s, &gemanimation.animations[i].frames[n].scales[index], sizeof(Vec3));
-						frame.scales.push_back(s);
-					}
-					aseq.frames.push_back(frame);
-				}
-				animation.animations.insert({ name, aseq });
+				aseq.ticksPerSecond = clip.ticksPerSecond;
+				aseq.indexedFrames = clip.frames;
+				animation.animations.insert({ clip.name, std::move(aseq) });
 			}
+			// GEM vectors and quaternions are plain floats with the same layout, so frames are copied straight
+			// into the keyframe buffer's tracks. The loader keeps the file mapped for as long as it exists.
+			animation.clipLoader = [model](const std::string& name, AnimationSequence& aseq) {
+				const GEMLoader::GEMClipIndexEntry* clip = model->clips.find(name);
+				if (clip == nullptr) return false;
+				aseq.keys.allocate(clip->frames, model->clips.bonesN);
+				return model->loadClip(*clip, (GEMLoader::GEMVec3*)aseq.keys.positions, (GEMLoader::GEMQuaternion*)aseq.keys.rotations, (GEMLoader::GEMVec3*)aseq.keys.scales);
+			};
 		}
 		// No animation
 		else {
 			// Load Meshes
-			for (int i = 0; i < gemmeshes.size(); i++) {
+			for (int i = 0; i < model->meshes.size(); i++) {
 				Mesh* mesh = new Mesh();
-				std::vector<STATIC_VERTEX> vertices;
-				for (int j = 0; j < gemmeshes[i].verticesStatic.size(); j++) {
-					STATIC_VERTEX v;
-					memcpy(&v, &gemmeshes[i].verticesStatic[j], sizeof(STATIC_VERTEX));
-					vertices.push_back(v);
+				const GEMLoader::GEMSpan<GEMLoader::GEMStaticVertex>& vertices = model->meshes[i].verticesStatic;
+				for (int j = 0; j < vertices.size(); j++) {
+					GEMLoader::GEMVec3 p = vertices[j].position;
+					bounds.addPoint(Vec3(p.x, p.y, p.z));
 				}
-				mesh->init(core, vertices, gemmeshes[i].indices);
-				// Assign PSO name based on mesh index
-				if (i < numPSOs)
-					mesh->psoNames = psonames[i];
-				else
-					mesh->psoNames = psonames[numPSOs - 1];
+				mesh->init(core, vertices, model->meshes[i].indices);
 				meshes.push_back(mesh);
 			}
 		}
+		bounds.finish();
+		animation.prepareForSharing();
+	}
+
+	// A cooked model: skeleton, bounds and clip table come with the header, each mesh is two reads and
+	// each clip one read the first time it plays
+	void loadCooked(Core* core, std::shared_ptr<CookedModel> cooked) {
+		std::vector<unsigned char> vertices;
+		std::vector<unsigned int> indices;
+		for (int i = 0; i < cooked->meshCount(); i++) {
+			int stride = 0;
+			if (!cooked->readMesh(i, vertices, stride, indices)) {
+				std::cout << cooked->filename << " is truncated" << std::endl;
+				exit(0);
+			}
+			Mesh* mesh = new Mesh();
+			mesh->init(core, vertices.data(), stride, vertices.size() / stride, indices.data(), indices.size());
+			mesh->inputLayoutDesc = cooked->animated() ? LayoutCache::getAnimatedLayout() : LayoutCache::getStaticLayout();
+			meshes.push_back(mesh);
+		}
+		cooked->fillBounds(bounds);
+		if (!cooked->animated())
+			return;
+		cooked->fillSkeleton(animation.skeleton);
+		animation.sourceId = std::hash<std::string>()(cooked->filename.substr(0, cooked->filename.size() - 1));
+		std::vector<CookedClip> clips = cooked->clipList();
+		for (const CookedClip& clip : clips)
+		{
+			AnimationSequence aseq;
+			aseq.ticksPerSecond = clip.ticksPerSecond;
+			aseq.indexedFrames = clip.frames;
+			animation.animations.insert({ cooked->name(clip.name), std::move(aseq) });
+		}
+		animation.clipLoader = [cooked, clips](const std::string& name, AnimationSequence& aseq) {
+			for (const CookedClip& clip : clips)
+				if (cooked->name(clip.name) == name)
+					return cooked->readClip(clip, aseq.keys);
+			return false;
+		};
+	}
+};
+
+
+
+// Models by path, each file loaded once however many objects use it. Clips load, compress and evict
+// once for everyone playing them, and the pose cache sees one model where each object used to bring
+// its own copy.
+class ModelCache {
+public:
+	std::shared_ptr<Model> get(Core* core, const std::string& filename) {
+		auto it = models.find(filename);
+		if (it != models.end())
+			return it->second;
+		std::shared_ptr<Model> model = std::make_shared<Model>();
+		model->load(core, filename.c_str());
+		models.insert({ filename, model });
+		return model;
+	}
+
+	int size() const {
+		return (int)models.size();
+	}
+
+	// objects still using a model keep it alive
+	void clear() {
+		models.clear();
+	}
+
+private:
+	std::unordered_map<std::string, std::shared_ptr<Model>> models;
+};
+
+
+
+class Object{
+public:
+	std::vector<Mesh*> meshes;
+	std::shared_ptr<Model> model;	// nullptr for objects built from meshes by hand
+	// Per mesh when the meshes belong to a shared model, empty when they belong to this object alone
+	// and carry their own PSO name and textures
+	std::vector<MeshMaterial> materials;
+
+	PSOManager* psoManager;
+	
+	Vec3 position = Vec3(0, 0, 0);
+	Quat rotation;
+	Vec3 scale = Vec3(1, 1, 1);
+	Mat4 worldMatrix;
+
+	Object() : psoManager(nullptr) {}
+
+	Object(PSOManager* psoMgr) : psoManager(psoMgr) {}
+
+	// a model of its own, whose meshes can be given textures directly
+	void loadGEM(Core* core, const char* filename, std::vector<std::string> psonames) {
+		model = std::make_shared<Model>();
+		model->load(core, filename);
+		meshes = model->meshes;
+		materials.clear();
+		for (int i = 0; i < meshes.size(); i++)
+			meshes[i]->psoNames = psoName(psonames, i);
+	}
+
+	// the cache's model for this file, shared with every other object loaded through it
+	void loadGEM(Core* core, ModelCache& cache, const char* filename, std::vector<std::string> psonames) {
+		model = cache.get(core, filename);
+		meshes = model->meshes;
+		materials.assign(meshes.size(), MeshMaterial());
+		for (int i = 0; i < meshes.size(); i++)
+			materials[i].psoName = psoName(psonames, i);
 	}
 
 	void loadGEM(Core* core, const char* filename, std::string psoname) {
@@ -556,40 +631,77 @@ public:
 		loadGEM(core, filename, names);
 	}
 
+	void loadGEM(Core* core, ModelCache& cache, const char* filename, std::string psoname) {
+		std::vector<std::string> names;
+		names.push_back(psoname);
+		loadGEM(core, cache, filename, names);
+	}
+
+	// Assign PSO name based on mesh index, the last one for any meshes past the end
+	static std::string psoName(const std::vector<std::string>& psonames, int i) {
+		int numPSOs = psonames.size();
+		return i < numPSOs ? psonames[i] : psonames[numPSOs - 1];
+	}
+
+	const std::string& psoName(int i) const {
+		return materials.empty() ? meshes[i]->psoNames : materials[i].psoName;
+	}
+
+	void setPSOName(const std::string& name) {
+		for (int i = 0; i < meshes.size(); i++) {
+			if (materials.empty())
+				meshes[i]->psoNames = name;
+			else
+				materials[i].psoName = name;
+		}
+	}
+
 	void draw(Core* core) {
+		updateWorldMatrix();
 		for (int i = 0; i < meshes.size(); i++) {
-			updateWorldMatrix();
-			psoManager->getShader(meshes[i]->psoNames)->updateAllConstantBuffers();
-			psoManager->getShader(meshes[i]->psoNames)->updateConstantBuffer("staticMeshBuffer", "W", &worldMatrix, VERTEX_SHADER);
-			psoManager->set(core, meshes[i]->psoNames);
-			meshes[i]->draw(core, psoManager->getShader(meshes[i]->psoNames));
-			psoManager->advance(meshes[i]->psoNames);
+			const std::string& pso = psoName(i);
+			psoManager->getShader(pso)->updateAllConstantBuffers();
+			psoManager->getShader(pso)->updateConstantBuffer("staticMeshBuffer", "W", &worldMatrix, VERTEX_SHADER);
+			psoManager->set(core, pso);
+			if (materials.empty())
+				meshes[i]->draw(core, psoManager->getShader(pso));
+			else
+				meshes[i]->draw(core, psoManager->getShader(pso), materials[i]);
+			psoManager->advance(pso);
 		}
 	}
 
 	void setDiffuseTexture(Image* texture) {
 		for (int i = 0; i < meshes.size(); i++) {
-			meshes[i]->setDiffuseTexture(texture);
+			if (materials.empty())
+				meshes[i]->setDiffuseTexture(texture);
+			else
+				materials[i].diffuseTexture = texture;
 		}
 	}
 
 	void setNormalTexture(Image* texture) {
 		for (int i = 0; i < meshes.size(); i++) {
-			meshes[i]->setNormalTexture(texture);
+			if (materials.empty())
+				meshes[i]->setNormalTexture(texture);
+			else
+				materials[i].normalTexture = texture;
 		}
 	}
 
 	void updateWorldMatrix() {
-		Mat4 t = Mat4().Translate(position.v[0], position.v[1], position.v[2]);
-		Mat4 r = Mat4().rotationQuaternion(rotation.v[0], rotation.v[1], rotation.v[2], rotation.v[3]);
-		Mat4 s = Mat4().Scale(scale.v[0], scale.v[1], scale.v[2]);
-		worldMatrix = t * r * s;
+		worldMatrix = composeTRS(position, rotation, scale);
 	}
 
 	Mat4* getWorldMatrix() {
 		return &worldMatrix;
 	}
 
+	// the mesh as loaded, placed by the last world matrix; empty for objects without a model
+	Bounds worldBounds() const {
+		return model ? model->bounds.bindBounds.transformed(worldMatrix) : Bounds();
+	}
+
 	void move(Vec3 delta) {
 		position = position + delta;
 	}
@@ -602,16 +714,18 @@ public:
 	}
 
 	void rotateBy(float angleInDegrees, axis rotAxis) {
-		float halfAngleRad = (angleInDegrees * M_PI / 180.0f) / 2.0f;
-		float sinHalfAngle = sinf(halfAngleRad);
-		Vec4 q;
+		Vec3 axisVec;
 		if (rotAxis == X_AXIS)
-			q = Vec4(sinHalfAngle, 0, 0, cosf(halfAngleRad));
+			axisVec = Vec3(1, 0, 0);
 		else if (rotAxis == Y_AXIS)
-			q = Vec4(0, sinHalfAngle, 0, cosf(halfAngleRad));
+			axisVec = Vec3(0, 1, 0);
 		else // Z_AXIS
-			q = Vec4(0, 0, sinHalfAngle, cosf(halfAngleRad));
-		rotation = rotation.quatMultiply(q);
+			axisVec = Vec3(0, 0, 1);
+		rotateBy(Quat::fromAxisAngle(axisVec, angleInDegrees));
+	}
+
+	void rotateBy(const Quat& q) {
+		rotation = rotation * q;
 		rotation = rotation.normalize();
 	}
 
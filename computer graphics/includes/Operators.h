@@ -3,13 +3,14 @@
 #include <cmath>
 #include <algorithm>
 #include <iostream>
+#include "Quat.h"
 
-void DebugPrint(const std::string& message) {
+inline void DebugPrint(const std::string& message) {
 	OutputDebugStringA((message + "\n").c_str());
 }
 
 
-float clamp(float val, float minVal, float maxVal)
+inline float clamp(float val, float minVal, float maxVal)
 {
 	using namespace std;
 	return max(minVal, min(maxVal, val));
@@ -27,31 +28,10 @@ t remap_clamp(t val, t inMin, t inMax, t outMin, t outMax)
 	return clamp(remap(val, inMin, inMax, outMin, outMax), outMin, outMax);
 }
 
-Vec4 slerp(Vec4 v0, Vec4 v1, float t)
+inline Vec4 slerp(Vec4 v0, Vec4 v1, float t)
 {
-	// normalize input vectors
-	Vec4 nv0 = v0.normalize();
-	Vec4 nv1 = v1.normalize();
-	// compute the cosine of the angle between the two vectors
-	float dot = v0.Dot(v1);
-	if (dot < 0.0f) {
-		nv1 = -nv1;
-		dot = -dot;
-	}
-	// if the dot product is very close to 1, use linear interpolation
-	if (dot > 0.9995f)
-		return (nv0 + (nv1 - nv0) * t).normalize();
-	// compute the angle between the two vectors
-	float theta_0 = acosf(dot);
-	float theta = acosf(dot) * t;
-	// compute the sin of the angles
-	float sin_theta = sinf(theta);
-	float sin_theta_0 = sinf(theta_0);
-	// compute the coefficients
-	float s0 = cosf(theta) - dot * sin_theta / sin_theta_0;
-	float s1 = sin_theta / sin_theta_0;
-	// compute the interpolated vector
-	return (nv0 * s0 + nv1 * s1).normalize();
+	// inputs are not required to be unit length here, unlike Quat::slerp
+	return Quat::slerp(Quat(v0.normalize()), Quat(v1.normalize()), t).normalize().toVec4();
 }
 
 template<typename t>
@@ -66,7 +46,7 @@ t perspectiveCorrectInterpolateAttribute(t a0, t a1, t a2, float v0_w, float v1_
 }
 
 
-Vec3 anyOrthogonal(Vec3 vec) {
+inline Vec3 anyOrthogonal(Vec3 vec) {
 	if (abs(vec.v[0]) > abs(vec.v[2]))
 		return Vec3(-vec.v[1], vec.v[0], 0.0);
 	else
@@ -75,7 +55,7 @@ Vec3 anyOrthogonal(Vec3 vec) {
 
 
 
-Vec4 quatFromTo(Vec3 a, Vec3 b) {
+inline Vec4 quatFromTo(Vec3 a, Vec3 b) {
 	Vec3 u = a.normalize();
 	Vec3 v = b.normalize();
 	float c = u.Dot(v);
@@ -97,7 +77,7 @@ Vec4 quatFromTo(Vec3 a, Vec3 b) {
 
 
 //pseudo-random hash function to generate random value based on position and seed, make sure the same position with same seed always generate the same value
-int generateRandomValue(int x, int y, int seed)
+inline int generateRandomValue(int x, int y, int seed)
 {
 	unsigned int h = seed;
 	h ^= 0x9e3779b9 + (x << 6) + (x >> 2); // mix x into h
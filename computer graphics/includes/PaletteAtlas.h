@@ -0,0 +1,148 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cmath>
+#include "Matrix.h"
+#include "Animation.h"
+
+
+
+// Every clip of an Animation sampled at a fixed rate into one contiguous block of 3x4 skinning
+// palettes, laid out clip by clip, frame by frame, bone by bone. At runtime an actor only needs a
+// (clip, frame, blend) triple; the palette rows can be uploaded once and indexed per instance.
+class PaletteAtlas {
+public:
+	struct Clip {
+		std::string name;
+		int firstFrame;		// index of the clip's first frame in the atlas
+		int frameCount;		// baked frames, the last one sits at the clip duration
+		float duration;
+	};
+
+	// what an actor hands to the renderer: blend between frame and frame + 1 of clip
+	struct Sample {
+		int clip;
+		int frame;
+		float blend;
+	};
+
+	// per-instance form of a Sample, offsets in palette entries from the start of the atlas
+	struct InstanceIndex {
+		unsigned int palette0;
+		unsigned int palette1;
+		float blend;
+	};
+
+	float sampleRate = 30.0f;
+	int boneCount = 0;
+	std::vector<Clip> clips;
+	std::vector<Mat3x4> palettes;
+
+	// Clips come out in the animation's map order, so atlas clip i is the animation's clip handle i
+	void bake(Animation& animation, float rate = 30.0f)
+	{
+		sampleRate = rate;
+		boneCount = animation.bonesSize();
+		clips.clear();
+		int total = 0;
+		for (auto& pair : animation.animations) {
+			Clip clip;
+			clip.name = pair.first;
+			clip.duration = pair.second.duration();
+			clip.firstFrame = total;
+			clip.frameCount = (int)ceilf(clip.duration * sampleRate) + 1;
+			clips.push_back(clip);
+			total += clip.frameCount;
+		}
+		palettes.resize((size_t)total * boneCount);
+		// the same evaluation AnimationInstance::update runs
+		LocalPose pose;
+		std::vector<Mat4> matrices(boneCount);
+		for (int c = 0; c < (int)clips.size(); c++) {
+			const Clip& clip = clips[c];
+			for (int f = 0; f < clip.frameCount; f++) {
+				animation.evaluatePose(c, frameTime(clip, f), pose, matrices.data());
+				Mat3x4* out = palette(clip.firstFrame + f);
+				for (int b = 0; b < boneCount; b++)
+					out[b] = Mat3x4::fromMat4(matrices[b]);
+			}
+		}
+	}
+
+	int findClip(const std::string& name) const
+	{
+		for (int i = 0; i < (int)clips.size(); i++)
+			if (clips[i].name == name)
+				return i;
+		return -1;
+	}
+
+	// clip time of a baked frame, clamped so the last frame lands on the duration
+	float frameTime(const Clip& clip, int frame) const
+	{
+		float t = (float)frame / sampleRate;
+		return t < clip.duration ? t : clip.duration;
+	}
+
+	// The blend is measured between the two frames' actual times, so the last segment, shortened
+	// when the duration isn't a whole number of sample periods, still ends exactly on the last frame
+	Sample lookup(int clip, float t) const
+	{
+		const Clip& baked = clips[clip];
+		Sample sample;
+		sample.clip = clip;
+		sample.frame = (int)floorf(t * sampleRate);
+		sample.blend = 0.0f;
+		int last = baked.frameCount - 1;
+		if (sample.frame < 0) {
+			sample.frame = 0;
+			return sample;
+		}
+		if (sample.frame >= last) {
+			sample.frame = last;
+			return sample;
+		}
+		float t0 = frameTime(baked, sample.frame);
+		float t1 = frameTime(baked, sample.frame + 1);
+		if (t1 > t0)
+			sample.blend = (t - t0) / (t1 - t0);
+		sample.blend = sample.blend < 0.0f ? 0.0f : (sample.blend > 1.0f ? 1.0f : sample.blend);
+		return sample;
+	}
+
+	InstanceIndex instanceIndex(const Sample& sample) const
+	{
+		const Clip& clip = clips[sample.clip];
+		int next = sample.frame + 1 < clip.frameCount ? sample.frame + 1 : sample.frame;
+		InstanceIndex index;
+		index.palette0 = (unsigned int)((clip.firstFrame + sample.frame) * boneCount);
+		index.palette1 = (unsigned int)((clip.firstFrame + next) * boneCount);
+		index.blend = sample.blend;
+		return index;
+	}
+
+	Mat3x4* palette(int atlasFrame)
+	{
+		return palettes.data() + (size_t)atlasFrame * boneCount;
+	}
+
+	const Mat3x4* palette(int atlasFrame) const
+	{
+		return palettes.data() + (size_t)atlasFrame * boneCount;
+	}
+
+	// CPU reference of what an instanced shader does with an InstanceIndex
+	void evaluate(const Sample& sample, Mat4* out) const
+	{
+		InstanceIndex index = instanceIndex(sample);
+		const Mat3x4* a = palettes.data() + index.palette0;
+		const Mat3x4* b = palettes.data() + index.palette1;
+		for (int i = 0; i < boneCount; i++)
+			out[i] = Mat3x4::lerp(a[i], b[i], index.blend).toMat4();
+	}
+
+	size_t sizeInBytes() const
+	{
+		return palettes.size() * sizeof(Mat3x4);
+	}
+};
@@ -0,0 +1,238 @@
+#pragma once
+#include "SIMD.h"
+#include "Matrix.h"
+#include "Vector.h"
+
+
+
+// Rotation quaternion stored as (x, y, z, w), the same layout as Vec4 and the GEM files
+class Quat {
+public:
+	float v[4];
+	constexpr Quat() : v{ 0.0f, 0.0f, 0.0f, 1.0f } {}
+	constexpr Quat(float x, float y, float z, float w) : v{ x, y, z, w } {}
+	// implicit so existing Vec4 quaternions (quatFromTo, file data) can be passed straight in
+	constexpr Quat(const Vec4& q) : v{ q.v[0], q.v[1], q.v[2], q.v[3] } {}
+
+	constexpr Vec4 toVec4() const
+	{
+		return Vec4(v[0], v[1], v[2], v[3]);
+	}
+
+	// constexpr so fixed model fix-up rotations are built at compile time
+	static constexpr Quat fromAxisAngle(const Vec3& axis, float angleInDegrees)
+	{
+		float s, c;
+		ConstMath::sincosDeg(angleInDegrees * 0.5f, s, c);
+		return Quat(axis.v[0] * s, axis.v[1] * s, axis.v[2] * s, c);
+	}
+
+	// Hamilton product, same convention as Vec4::quatMultiply
+	constexpr Quat operator*(const Quat& q) const
+	{
+		Quat result;
+		if (std::is_constant_evaluated())
+			return Quat(toVec4().quatMultiply(q.toVec4()));
+#ifdef MATH_SIMD_SSE
+		__m128 a = _mm_loadu_ps(v);
+		__m128 b = _mm_loadu_ps(q.v);
+		// only the w lane of the second and third terms is negated
+		const __m128 signW = _mm_setr_ps(0.0f, 0.0f, 0.0f, -0.0f);
+		__m128 r = _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 3, 3, 3)), b);
+		r = _mm_add_ps(r, _mm_xor_ps(signW, _mm_mul_ps(
+			_mm_shuffle_ps(a, a, _MM_SHUFFLE(0, 2, 1, 0)), _mm_shuffle_ps(b, b, _MM_SHUFFLE(0, 3, 3, 3)))));
+		r = _mm_add_ps(r, _mm_xor_ps(signW, _mm_mul_ps(
+			_mm_shuffle_ps(a, a, _MM_SHUFFLE(1, 0, 2, 1)), _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 1, 0, 2)))));
+		r = _mm_sub_ps(r, _mm_mul_ps(
+			_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 1, 0, 2)), _mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 0, 2, 1))));
+		_mm_storeu_ps(result.v, r);
+#else
+		result.v[0] = v[3] * q.v[0] + v[0] * q.v[3] + v[1] * q.v[2] - v[2] * q.v[1];
+		result.v[1] = v[3] * q.v[1] - v[0] * q.v[2] + v[1] * q.v[3] + v[2] * q.v[0];
+		result.v[2] = v[3] * q.v[2] + v[0] * q.v[1] - v[1] * q.v[0] + v[2] * q.v[3];
+		result.v[3] = v[3] * q.v[3] - v[0] * q.v[0] - v[1] * q.v[1] - v[2] * q.v[2];
+#endif
+		return result;
+	}
+
+	constexpr Quat operator-() const
+	{
+		return Quat(-v[0], -v[1], -v[2], -v[3]);
+	}
+
+	constexpr Quat conjugate() const
+	{
+		return Quat(-v[0], -v[1], -v[2], v[3]);
+	}
+
+	constexpr float Dot(const Quat& q) const
+	{
+		return v[0] * q.v[0] + v[1] * q.v[1] + v[2] * q.v[2] + v[3] * q.v[3];
+	}
+
+	Quat normalize() const
+	{
+		float len2 = Dot(*this);
+		if (len2 == 0.0f) return Quat();
+		float len = 1.0f / sqrtf(len2);
+		return Quat(v[0] * len, v[1] * len, v[2] * len, v[3] * len);
+	}
+
+	// Rotation matrix written directly, same layout as Mat4::rotationQuaternion
+	constexpr Mat4 toMat4() const
+	{
+		float x = v[0], y = v[1], z = v[2], w = v[3];
+		float x2 = x + x, y2 = y + y, z2 = z + z;
+		float xx = x * x2, yy = y * y2, zz = z * z2;
+		float xy = x * y2, xz = x * z2, yz = y * z2;
+		float wx = w * x2, wy = w * y2, wz = w * z2;
+		Mat4 mat = Mat4(Mat4::Uninitialised());
+		mat.m[0][0] = 1.0f - yy - zz; mat.m[0][1] = xy - wz; mat.m[0][2] = xz + wy; mat.m[0][3] = 0.0f;
+		mat.m[1][0] = xy + wz; mat.m[1][1] = 1.0f - xx - zz; mat.m[1][2] = yz - wx; mat.m[1][3] = 0.0f;
+		mat.m[2][0] = xz - wy; mat.m[2][1] = yz + wx; mat.m[2][2] = 1.0f - xx - yy; mat.m[2][3] = 0.0f;
+		mat.m[3][0] = 0.0f; mat.m[3][1] = 0.0f; mat.m[3][2] = 0.0f; mat.m[3][3] = 1.0f;
+		return mat;
+	}
+
+	// Inverse of toMat4 for the upper 3x3 of a rotation (scale-free) matrix, branching on the
+	// largest diagonal term so the square root never sees a value near 0 (Shepperd)
+	static Quat fromRotation(const Mat4& mat)
+	{
+		float trace = mat.m[0][0] + mat.m[1][1] + mat.m[2][2];
+		Quat q;
+		if (trace > 0.0f) {
+			float s = 0.5f / sqrtf(trace + 1.0f);
+			q = Quat((mat.m[2][1] - mat.m[1][2]) * s, (mat.m[0][2] - mat.m[2][0]) * s, (mat.m[1][0] - mat.m[0][1]) * s, 0.25f / s);
+		}
+		else if (mat.m[0][0] > mat.m[1][1] && mat.m[0][0] > mat.m[2][2]) {
+			float s = 2.0f * sqrtf(1.0f + mat.m[0][0] - mat.m[1][1] - mat.m[2][2]);
+			q = Quat(0.25f * s, (mat.m[0][1] + mat.m[1][0]) / s, (mat.m[0][2] + mat.m[2][0]) / s, (mat.m[2][1] - mat.m[1][2]) / s);
+		}
+		else if (mat.m[1][1] > mat.m[2][2]) {
+			float s = 2.0f * sqrtf(1.0f + mat.m[1][1] - mat.m[0][0] - mat.m[2][2]);
+			q = Quat((mat.m[0][1] + mat.m[1][0]) / s, 0.25f * s, (mat.m[1][2] + mat.m[2][1]) / s, (mat.m[0][2] - mat.m[2][0]) / s);
+		}
+		else {
+			float s = 2.0f * sqrtf(1.0f + mat.m[2][2] - mat.m[0][0] - mat.m[1][1]);
+			q = Quat((mat.m[0][2] + mat.m[2][0]) / s, (mat.m[1][2] + mat.m[2][1]) / s, 0.25f * s, (mat.m[1][0] - mat.m[0][1]) / s);
+		}
+		return q.normalize();
+	}
+
+	// Normalized lerp along the shortest arc, cheapest option for small steps
+	static Quat nlerp(const Quat& a, const Quat& b, float t)
+	{
+		float s = a.Dot(b) < 0.0f ? -t : t;
+		float d = 1.0f - t;
+		return Quat(a.v[0] * d + b.v[0] * s, a.v[1] * d + b.v[1] * s,
+			a.v[2] * d + b.v[2] * s, a.v[3] * d + b.v[3] * s).normalize();
+	}
+
+	// Slerp along the shortest arc for unit inputs and t in [0, 1], using the polynomial fit of
+	// sin(t * theta) / sin(theta) in cos(theta) (Eberly, "A Fast and Accurate Algorithm for
+	// Computing SLERP"), so no acos/sin calls and no branch near theta = 0. Error is below 1e-7
+	// for rotations under 90 degrees apart (neighbouring keyframes) and ~2e-5 at 180 degrees.
+	static Quat slerp(const Quat& a, const Quat& b, float t)
+	{
+		t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+		float x = a.Dot(b);
+		float sign = 1.0f;
+		if (x < 0.0f) {
+			x = -x;
+			sign = -1.0f;
+		}
+		float cA, cB;
+		slerpCoefficients(x, t, cA, cB);
+		cB *= sign;
+		return Quat(a.v[0] * cA + b.v[0] * cB, a.v[1] * cA + b.v[1] * cB,
+			a.v[2] * cA + b.v[2] * cB, a.v[3] * cA + b.v[3] * cB);
+	}
+
+	// out[i] = slerp(a[i], b[i], t), the common case of one interpolation factor for a whole pose
+	static void slerpBatch(const Quat* a, const Quat* b, float t, Quat* out, int count)
+	{
+		t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+		int i = 0;
+#ifdef MATH_SIMD_SSE
+		// four quaternions per iteration, transposed so each lane holds one quaternion
+		__m128 vt = _mm_set1_ps(t);
+		__m128 vd = _mm_set1_ps(1.0f - t);
+		__m128 sqrT = _mm_mul_ps(vt, vt);
+		__m128 sqrD = _mm_mul_ps(vd, vd);
+		__m128 one = _mm_set1_ps(1.0f);
+		__m128 signBit = _mm_set1_ps(-0.0f);
+		for (; i + 4 <= count; i += 4) {
+			__m128 ax = _mm_loadu_ps(a[i].v), ay = _mm_loadu_ps(a[i + 1].v), az = _mm_loadu_ps(a[i + 2].v), aw = _mm_loadu_ps(a[i + 3].v);
+			__m128 bx = _mm_loadu_ps(b[i].v), by = _mm_loadu_ps(b[i + 1].v), bz = _mm_loadu_ps(b[i + 2].v), bw = _mm_loadu_ps(b[i + 3].v);
+			_MM_TRANSPOSE4_PS(ax, ay, az, aw);
+			_MM_TRANSPOSE4_PS(bx, by, bz, bw);
+			__m128 x = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)),
+				_mm_add_ps(_mm_mul_ps(az, bz), _mm_mul_ps(aw, bw)));
+			// shortest arc: fold the sign of the dot product into the b coefficient
+			__m128 sign = _mm_and_ps(x, signBit);
+			x = _mm_andnot_ps(signBit, x);
+			__m128 xm1 = _mm_sub_ps(x, one);
+			__m128 cA = one, cB = one;
+			for (int k = 7; k >= 0; k--) {
+				__m128 u = _mm_set1_ps(slerpU[k]);
+				__m128 w = _mm_set1_ps(slerpV[k]);
+				cA = _mm_add_ps(one, _mm_mul_ps(_mm_mul_ps(_mm_sub_ps(_mm_mul_ps(u, sqrD), w), xm1), cA));
+				cB = _mm_add_ps(one, _mm_mul_ps(_mm_mul_ps(_mm_sub_ps(_mm_mul_ps(u, sqrT), w), xm1), cB));
+			}
+			cA = _mm_mul_ps(cA, vd);
+			cB = _mm_xor_ps(_mm_mul_ps(cB, vt), sign);
+			__m128 rx = _mm_add_ps(_mm_mul_ps(ax, cA), _mm_mul_ps(bx, cB));
+			__m128 ry = _mm_add_ps(_mm_mul_ps(ay, cA), _mm_mul_ps(by, cB));
+			__m128 rz = _mm_add_ps(_mm_mul_ps(az, cA), _mm_mul_ps(bz, cB));
+			__m128 rw = _mm_add_ps(_mm_mul_ps(aw, cA), _mm_mul_ps(bw, cB));
+			_MM_TRANSPOSE4_PS(rx, ry, rz, rw);
+			_mm_storeu_ps(out[i].v, rx);
+			_mm_storeu_ps(out[i + 1].v, ry);
+			_mm_storeu_ps(out[i + 2].v, rz);
+			_mm_storeu_ps(out[i + 3].v, rw);
+		}
+#endif
+		for (; i < count; i++)
+			out[i] = slerp(a[i], b[i], t);
+	}
+
+	// out[i] = slerp(a[i], b[i], t[i]), e.g. per-actor rotation smoothing
+	static void slerpBatch(const Quat* a, const Quat* b, const float* t, Quat* out, int count)
+	{
+		for (int i = 0; i < count; i++)
+			out[i] = slerp(a[i], b[i], t[i]);
+	}
+
+	// out[i] = nlerp(a[i], b[i], t)
+	static void nlerpBatch(const Quat* a, const Quat* b, float t, Quat* out, int count)
+	{
+		for (int i = 0; i < count; i++)
+			out[i] = nlerp(a[i], b[i], t);
+	}
+
+private:
+	// u[i] = 1 / ((i + 1)(2i + 3)), v[i] = (i + 1) / (2i + 3), last term scaled by 1 + mu to
+	// absorb the truncation error of the series
+	static constexpr float slerpMu = 1.85298109240830f;
+	static constexpr float slerpU[8] = { 1.0f / (1 * 3), 1.0f / (2 * 5), 1.0f / (3 * 7), 1.0f / (4 * 9),
+		1.0f / (5 * 11), 1.0f / (6 * 13), 1.0f / (7 * 15), slerpMu / (8 * 17) };
+	static constexpr float slerpV[8] = { 1.0f / 3, 2.0f / 5, 3.0f / 7, 4.0f / 9,
+		5.0f / 11, 6.0f / 13, 7.0f / 15, slerpMu * 8 / 17 };
+
+	// coefficients so that slerp = a * cA + b * cB, x = cos(theta) >= 0
+	static void slerpCoefficients(float x, float t, float& cA, float& cB)
+	{
+		float d = 1.0f - t;
+		float sqrT = t * t;
+		float sqrD = d * d;
+		float xm1 = x - 1.0f;
+		cA = 1.0f;
+		cB = 1.0f;
+		for (int k = 7; k >= 0; k--) {
+			cA = 1.0f + (slerpU[k] * sqrD - slerpV[k]) * xm1 * cA;
+			cB = 1.0f + (slerpU[k] * sqrT - slerpV[k]) * xm1 * cB;
+		}
+		cA *= d;
+		cB *= t;
+	}
+};
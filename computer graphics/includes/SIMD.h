@@ -0,0 +1,125 @@
+#pragma once
+#include <cmath>
+#include <new>
+
+// SSE is always available on x64; AVX paths are only compiled in with /arch:AVX (or -mavx)
+// Define MATH_NO_SIMD to force the scalar fallback
+#if !defined(MATH_NO_SIMD) && (defined(_M_X64) || defined(_M_AMD64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define MATH_SIMD_SSE
+#include <immintrin.h>
+#if defined(__AVX__)
+#define MATH_SIMD_AVX
+#endif
+#endif
+
+
+
+// Thin wrapper over the widest float register the build supports, so array kernels
+// are written once and compile to AVX, SSE or plain scalar code
+// vmin/vmax avoid the min/max macros from Windows.h
+namespace SIMD {
+	// alignment of every stream allocation, enough for a full AVX register
+	const int alignment = 32;
+
+	inline void* alignedAlloc(size_t bytes)
+	{
+		return ::operator new(bytes, std::align_val_t(alignment));
+	}
+
+	inline void alignedFree(void* p)
+	{
+		::operator delete(p, std::align_val_t(alignment));
+	}
+
+#if defined(MATH_SIMD_AVX)
+	typedef __m256 vfloat;
+	typedef __m256 vmask;
+	const int width = 8;
+	inline vfloat load(const float* p) { return _mm256_load_ps(p); }
+	inline vfloat loadu(const float* p) { return _mm256_loadu_ps(p); }
+	inline void store(float* p, vfloat v) { _mm256_store_ps(p, v); }
+	inline void storeu(float* p, vfloat v) { _mm256_storeu_ps(p, v); }
+	inline vfloat set1(float f) { return _mm256_set1_ps(f); }
+	inline vfloat add(vfloat a, vfloat b) { return _mm256_add_ps(a, b); }
+	inline vfloat sub(vfloat a, vfloat b) { return _mm256_sub_ps(a, b); }
+	inline vfloat mul(vfloat a, vfloat b) { return _mm256_mul_ps(a, b); }
+	inline vfloat div(vfloat a, vfloat b) { return _mm256_div_ps(a, b); }
+	inline vfloat vmin(vfloat a, vfloat b) { return _mm256_min_ps(a, b); }
+	inline vfloat vmax(vfloat a, vfloat b) { return _mm256_max_ps(a, b); }
+	inline vfloat sqrt(vfloat a) { return _mm256_sqrt_ps(a); }
+	inline vfloat rsqrtEstimate(vfloat a) { return _mm256_rsqrt_ps(a); }
+	inline vmask greater(vfloat a, vfloat b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+	inline vmask less(vfloat a, vfloat b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+	// and/andnot/or rather than blendv: GCC lowers blendv to per-lane code on AVX1 (no 256-bit integer compares)
+	inline vfloat select(vmask m, vfloat a, vfloat b) { return _mm256_or_ps(_mm256_and_ps(m, a), _mm256_andnot_ps(m, b)); }
+	inline vmask maskAnd(vmask a, vmask b) { return _mm256_and_ps(a, b); }
+	inline vfloat roundNearest(vfloat a) { return _mm256_round_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+	// 2^n for integral n in [-126, 127]; AVX has no 256-bit integer shifts, so each half goes through SSE2
+	inline vfloat pow2(vfloat n)
+	{
+		__m256i e = _mm256_cvtps_epi32(n);
+		__m128i lo = _mm_slli_epi32(_mm_add_epi32(_mm256_castsi256_si128(e), _mm_set1_epi32(127)), 23);
+		__m128i hi = _mm_slli_epi32(_mm_add_epi32(_mm256_extractf128_si256(e, 1), _mm_set1_epi32(127)), 23);
+		return _mm256_castsi256_ps(_mm256_insertf128_si256(_mm256_castsi128_si256(lo), hi, 1));
+	}
+#elif defined(MATH_SIMD_SSE)
+	typedef __m128 vfloat;
+	typedef __m128 vmask;
+	const int width = 4;
+	inline vfloat load(const float* p) { return _mm_load_ps(p); }
+	inline vfloat loadu(const float* p) { return _mm_loadu_ps(p); }
+	inline void store(float* p, vfloat v) { _mm_store_ps(p, v); }
+	inline void storeu(float* p, vfloat v) { _mm_storeu_ps(p, v); }
+	inline vfloat set1(float f) { return _mm_set1_ps(f); }
+	inline vfloat add(vfloat a, vfloat b) { return _mm_add_ps(a, b); }
+	inline vfloat sub(vfloat a, vfloat b) { return _mm_sub_ps(a, b); }
+	inline vfloat mul(vfloat a, vfloat b) { return _mm_mul_ps(a, b); }
+	inline vfloat div(vfloat a, vfloat b) { return _mm_div_ps(a, b); }
+	inline vfloat vmin(vfloat a, vfloat b) { return _mm_min_ps(a, b); }
+	inline vfloat vmax(vfloat a, vfloat b) { return _mm_max_ps(a, b); }
+	inline vfloat sqrt(vfloat a) { return _mm_sqrt_ps(a); }
+	inline vfloat rsqrtEstimate(vfloat a) { return _mm_rsqrt_ps(a); }
+	inline vmask greater(vfloat a, vfloat b) { return _mm_cmpgt_ps(a, b); }
+	inline vmask less(vfloat a, vfloat b) { return _mm_cmplt_ps(a, b); }
+	inline vfloat select(vmask m, vfloat a, vfloat b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+	inline vmask maskAnd(vmask a, vmask b) { return _mm_and_ps(a, b); }
+	inline vfloat roundNearest(vfloat a) { return _mm_cvtepi32_ps(_mm_cvtps_epi32(a)); }
+	// 2^n for integral n in [-126, 127], built straight into the exponent bits
+	inline vfloat pow2(vfloat n) { return _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(_mm_cvtps_epi32(n), _mm_set1_epi32(127)), 23)); }
+#else
+	typedef float vfloat;
+	typedef bool vmask;
+	const int width = 1;
+	inline vfloat load(const float* p) { return *p; }
+	inline vfloat loadu(const float* p) { return *p; }
+	inline void store(float* p, vfloat v) { *p = v; }
+	inline void storeu(float* p, vfloat v) { *p = v; }
+	inline vfloat set1(float f) { return f; }
+	inline vfloat add(vfloat a, vfloat b) { return a + b; }
+	inline vfloat sub(vfloat a, vfloat b) { return a - b; }
+	inline vfloat mul(vfloat a, vfloat b) { return a * b; }
+	inline vfloat div(vfloat a, vfloat b) { return a / b; }
+	inline vfloat vmin(vfloat a, vfloat b) { return a < b ? a : b; }
+	inline vfloat vmax(vfloat a, vfloat b) { return a > b ? a : b; }
+	inline vfloat sqrt(vfloat a) { return sqrtf(a); }
+	inline vfloat rsqrtEstimate(vfloat a) { return 1.0f / sqrtf(a); }
+	inline vmask greater(vfloat a, vfloat b) { return a > b; }
+	inline vmask less(vfloat a, vfloat b) { return a < b; }
+	inline vfloat select(vmask m, vfloat a, vfloat b) { return m ? a : b; }
+	inline vmask maskAnd(vmask a, vmask b) { return a && b; }
+	inline vfloat roundNearest(vfloat a) { return nearbyintf(a); }
+	inline vfloat pow2(vfloat n) { return ldexpf(1.0f, (int)n); }
+#endif
+
+	inline vfloat madd(vfloat a, vfloat b, vfloat c) { return add(mul(a, b), c); }
+
+	// 1/sqrt(a), the hardware estimate refined by one Newton-Raphson step (~22 bits)
+	inline vfloat rsqrt(vfloat a)
+	{
+		vfloat y = rsqrtEstimate(a);
+#if defined(MATH_SIMD_SSE)
+		y = mul(y, sub(set1(1.5f), mul(mul(set1(0.5f), a), mul(y, y))));
+#endif
+		return y;
+	}
+}
@@ -127,6 +127,16 @@ public:
 		}
 	}
 
+	void updateConstantBuffer(const std::string& cbName, std::string varName, const void* data, unsigned int size, enum ShaderType type) {
+		std::vector<ConstantBuffer>& buffers = (type == VERTEX_SHADER) ? vsConstantBuffers : psConstantBuffers;
+		for (auto& cb : buffers) {
+			if (cb.name == cbName) {
+				cb.update(varName, data, size);
+				return;
+			}
+		}
+	}
+
 	void updateAllConstantBuffers() {
 		for (auto& cb : vsConstantBuffers) {
 			cb.updateAll();
@@ -0,0 +1,219 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <cmath>
+#include "SIMD.h"
+#include "Matrix.h"
+#include "Vector.h"
+#include "Vertex.h"
+
+
+
+// Bone matrices in the layout the skinning kernels blend: each Mat4 is stored transposed, so its
+// rows are the bone's columns and a vertex is c0 * x + c1 * y + c2 * z + c3 once the four bones are
+// weighted together. Bones are assumed affine, as every GEM skeleton is.
+class SkinPalette {
+public:
+	std::vector<Mat4> columns;
+
+	// model space output, what the vertex shader sees before W
+	void set(const Mat4* bones, int count)
+	{
+		columns.resize(count);
+		for (int i = 0; i < count; i++)
+			transposeInto(bones[i], columns[i]);
+	}
+
+	// world * bone, so bounds and picking get world space vertices straight out of the kernel
+	void set(const Mat4* bones, int count, const Mat4& world)
+	{
+		columns.resize(count);
+		Mat4 bone;
+		for (int i = 0; i < count; i++) {
+			Mat4::multiplyAffine(world, bones[i], bone);
+			transposeInto(bone, columns[i]);
+		}
+	}
+
+	int size() const
+	{
+		return (int)columns.size();
+	}
+
+private:
+	static void transposeInto(const Mat4& mat, Mat4& out)
+	{
+		for (int i = 0; i < 4; i++)
+			for (int j = 0; j < 4; j++)
+				out.m[j][i] = mat.m[i][j];
+	}
+};
+
+
+
+// CPU version of the blend in hlsl/AnimatedVS.hlsl: positions move by the weighted sum of the
+// vertex's four bone matrices, normals and tangents by its upper 3x3 and are renormalised. Used for
+// skinned bounds, picking and headless checks; STATIC_VERTEX output can also be drawn with the static
+// pipeline as a software fallback. Bone ids are trusted to be inside the palette, like the shader does.
+namespace Skinning {
+	// below this many vertices per thread the thread start costs more than the skinning
+	const int minVerticesPerThread = 4096;
+
+#ifdef MATH_SIMD_SSE
+	// the four blended bone columns of one vertex
+	inline void blendColumns(const Mat4* palette, const ANIMATED_VERTEX& v, __m128& c0, __m128& c1, __m128& c2, __m128& c3)
+	{
+		const Mat4& b = palette[v.bonesIDs[0]];
+		__m128 w = _mm_set1_ps(v.boneWeights[0]);
+		c0 = _mm_mul_ps(_mm_loadu_ps(b.m[0]), w);
+		c1 = _mm_mul_ps(_mm_loadu_ps(b.m[1]), w);
+		c2 = _mm_mul_ps(_mm_loadu_ps(b.m[2]), w);
+		c3 = _mm_mul_ps(_mm_loadu_ps(b.m[3]), w);
+		for (int k = 1; k < 4; k++) {
+			const Mat4& bk = palette[v.bonesIDs[k]];
+			w = _mm_set1_ps(v.boneWeights[k]);
+			c0 = _mm_add_ps(c0, _mm_mul_ps(_mm_loadu_ps(bk.m[0]), w));
+			c1 = _mm_add_ps(c1, _mm_mul_ps(_mm_loadu_ps(bk.m[1]), w));
+			c2 = _mm_add_ps(c2, _mm_mul_ps(_mm_loadu_ps(bk.m[2]), w));
+			c3 = _mm_add_ps(c3, _mm_mul_ps(_mm_loadu_ps(bk.m[3]), w));
+		}
+	}
+
+	inline __m128 transformDirection(const Vec3& d, __m128 c0, __m128 c1, __m128 c2)
+	{
+		__m128 r = _mm_mul_ps(c0, _mm_set1_ps(d.v[0]));
+		r = _mm_add_ps(r, _mm_mul_ps(c1, _mm_set1_ps(d.v[1])));
+		return _mm_add_ps(r, _mm_mul_ps(c2, _mm_set1_ps(d.v[2])));
+	}
+
+	// the w lane is 0 for directions of affine bones, so it drops out of the length
+	inline __m128 normalize3(__m128 d)
+	{
+		__m128 sq = _mm_mul_ps(d, d);
+		__m128 sum = _mm_add_ps(sq, _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(2, 3, 0, 1)));
+		sum = _mm_add_ps(sum, _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(1, 0, 3, 2)));
+		return _mm_div_ps(d, _mm_sqrt_ps(sum));
+	}
+
+	// 12 bytes, so the store never runs past the end of a Vec3 array
+	inline void store3(Vec3& out, __m128 v)
+	{
+		_mm_storel_pi((__m64*)out.v, v);
+		_mm_store_ss(&out.v[2], _mm_movehl_ps(v, v));
+	}
+#else
+	// scalar fallback, the blended bone rows of one vertex
+	inline void blendRows(const Mat4* palette, const ANIMATED_VERTEX& v, float rows[4][3])
+	{
+		const Mat4& b = palette[v.bonesIDs[0]];
+		float w = v.boneWeights[0];
+		for (int c = 0; c < 4; c++) {
+			rows[c][0] = b.m[c][0] * w;
+			rows[c][1] = b.m[c][1] * w;
+			rows[c][2] = b.m[c][2] * w;
+		}
+		for (int k = 1; k < 4; k++) {
+			const Mat4& bk = palette[v.bonesIDs[k]];
+			w = v.boneWeights[k];
+			for (int c = 0; c < 4; c++) {
+				rows[c][0] += bk.m[c][0] * w;
+				rows[c][1] += bk.m[c][1] * w;
+				rows[c][2] += bk.m[c][2] * w;
+			}
+		}
+	}
+
+	inline Vec3 transformDirection(const Vec3& d, const float rows[4][3])
+	{
+		return Vec3(rows[0][0] * d.v[0] + rows[1][0] * d.v[1] + rows[2][0] * d.v[2],
+			rows[0][1] * d.v[0] + rows[1][1] * d.v[1] + rows[2][1] * d.v[2],
+			rows[0][2] * d.v[0] + rows[1][2] * d.v[1] + rows[2][2] * d.v[2]);
+	}
+
+	inline Vec3 normalize3(const Vec3& d)
+	{
+		float inv = 1.0f / sqrtf(d.v[0] * d.v[0] + d.v[1] * d.v[1] + d.v[2] * d.v[2]);
+		return Vec3(d.v[0] * inv, d.v[1] * inv, d.v[2] * inv);
+	}
+#endif
+
+	// out[i] = skinned in[i] for i in [begin, end), uvs copied through
+	inline void skin(const SkinPalette& palette, const ANIMATED_VERTEX* in, STATIC_VERTEX* out, int begin, int end)
+	{
+		const Mat4* bones = palette.columns.data();
+		for (int i = begin; i < end; i++) {
+			const ANIMATED_VERTEX& v = in[i];
+#ifdef MATH_SIMD_SSE
+			__m128 c0, c1, c2, c3;
+			blendColumns(bones, v, c0, c1, c2, c3);
+			__m128 p = _mm_add_ps(transformDirection(v.pos, c0, c1, c2), c3);
+			store3(out[i].pos, p);
+			store3(out[i].normal, normalize3(transformDirection(v.normal, c0, c1, c2)));
+			store3(out[i].tangent, normalize3(transformDirection(v.tangent, c0, c1, c2)));
+#else
+			float rows[4][3];
+			blendRows(bones, v, rows);
+			Vec3 p = transformDirection(v.pos, rows);
+			out[i].pos = Vec3(p.v[0] + rows[3][0], p.v[1] + rows[3][1], p.v[2] + rows[3][2]);
+			out[i].normal = normalize3(transformDirection(v.normal, rows));
+			out[i].tangent = normalize3(transformDirection(v.tangent, rows));
+#endif
+			out[i].uv[0] = v.uv[0];
+			out[i].uv[1] = v.uv[1];
+		}
+	}
+
+	// positions only, all bounds and ray tests need
+	inline void skinPositions(const SkinPalette& palette, const ANIMATED_VERTEX* in, Vec3* out, int begin, int end)
+	{
+		const Mat4* bones = palette.columns.data();
+		for (int i = begin; i < end; i++) {
+			const ANIMATED_VERTEX& v = in[i];
+#ifdef MATH_SIMD_SSE
+			__m128 c0, c1, c2, c3;
+			blendColumns(bones, v, c0, c1, c2, c3);
+			store3(out[i], _mm_add_ps(transformDirection(v.pos, c0, c1, c2), c3));
+#else
+			float rows[4][3];
+			blendRows(bones, v, rows);
+			Vec3 p = transformDirection(v.pos, rows);
+			out[i] = Vec3(p.v[0] + rows[3][0], p.v[1] + rows[3][1], p.v[2] + rows[3][2]);
+#endif
+		}
+	}
+
+	// Splits [0, count) into contiguous ranges, one per thread, and runs work(begin, end) on each.
+	// The calling thread takes the first range; 0 threads means one per hardware thread.
+	template<typename Work>
+	void parallelRanges(int count, int threads, Work work)
+	{
+		if (threads <= 0)
+			threads = (int)std::thread::hardware_concurrency();
+		int most = count / minVerticesPerThread;
+		threads = threads < most ? threads : most;
+		if (threads <= 1) {
+			work(0, count);
+			return;
+		}
+		std::vector<std::thread> workers;
+		workers.reserve(threads - 1);
+		int chunk = (count + threads - 1) / threads;
+		for (int begin = chunk; begin < count; begin += chunk) {
+			int end = begin + chunk < count ? begin + chunk : count;
+			workers.emplace_back(work, begin, end);
+		}
+		work(0, chunk);
+		for (std::thread& worker : workers)
+			worker.join();
+	}
+
+	inline void skinParallel(const SkinPalette& palette, const ANIMATED_VERTEX* in, STATIC_VERTEX* out, int count, int threads = 0)
+	{
+		parallelRanges(count, threads, [&](int begin, int end) { skin(palette, in, out, begin, end); });
+	}
+
+	inline void skinPositionsParallel(const SkinPalette& palette, const ANIMATED_VERTEX* in, Vec3* out, int count, int threads = 0)
+	{
+		parallelRanges(count, threads, [&](int begin, int end) { skinPositions(palette, in, out, begin, end); });
+	}
+}
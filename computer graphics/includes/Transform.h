@@ -0,0 +1,132 @@
+#pragma once
+#include <vector>
+#include "SIMD.h"
+#include "Matrix.h"
+#include "Vector.h"
+#include "Quat.h"
+
+
+
+// T * R * S written straight into the matrix: the rotation columns scaled by s, translation in the
+// last column. Same result as Translate * toMat4 * Scale with no matrix products.
+inline Mat4 composeTRS(const Vec3& position, const Quat& rotation, const Vec3& scale)
+{
+	float x = rotation.v[0], y = rotation.v[1], z = rotation.v[2], w = rotation.v[3];
+	float x2 = x + x, y2 = y + y, z2 = z + z;
+	float xx = x * x2, yy = y * y2, zz = z * z2;
+	float xy = x * y2, xz = x * z2, yz = y * z2;
+	float wx = w * x2, wy = w * y2, wz = w * z2;
+	float sx = scale.v[0], sy = scale.v[1], sz = scale.v[2];
+	Mat4 mat = Mat4(Mat4::Uninitialised());
+	mat.m[0][0] = (1.0f - yy - zz) * sx; mat.m[0][1] = (xy - wz) * sy; mat.m[0][2] = (xz + wy) * sz; mat.m[0][3] = position.v[0];
+	mat.m[1][0] = (xy + wz) * sx; mat.m[1][1] = (1.0f - xx - zz) * sy; mat.m[1][2] = (yz - wx) * sz; mat.m[1][3] = position.v[1];
+	mat.m[2][0] = (xz - wy) * sx; mat.m[2][1] = (yz + wx) * sy; mat.m[2][2] = (1.0f - xx - yy) * sz; mat.m[2][3] = position.v[2];
+	mat.m[3][0] = 0.0f; mat.m[3][1] = 0.0f; mat.m[3][2] = 0.0f; mat.m[3][3] = 1.0f;
+	return mat;
+}
+
+// out[i] = composeTRS(positions[i], rotations[i], scales[i])
+inline void composeTRSBatch(const Vec3* positions, const Quat* rotations, const Vec3* scales, Mat4* out, int count)
+{
+	int i = 0;
+#ifdef MATH_SIMD_SSE
+	// four transforms per iteration, each lane holds one transform
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 lastRow = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+	for (; i + 4 <= count; i += 4) {
+		__m128 x = _mm_loadu_ps(rotations[i].v);
+		__m128 y = _mm_loadu_ps(rotations[i + 1].v);
+		__m128 z = _mm_loadu_ps(rotations[i + 2].v);
+		__m128 w = _mm_loadu_ps(rotations[i + 3].v);
+		_MM_TRANSPOSE4_PS(x, y, z, w);
+		const Vec3* p = positions + i;
+		const Vec3* s = scales + i;
+		__m128 tx = _mm_setr_ps(p[0].v[0], p[1].v[0], p[2].v[0], p[3].v[0]);
+		__m128 ty = _mm_setr_ps(p[0].v[1], p[1].v[1], p[2].v[1], p[3].v[1]);
+		__m128 tz = _mm_setr_ps(p[0].v[2], p[1].v[2], p[2].v[2], p[3].v[2]);
+		__m128 sx = _mm_setr_ps(s[0].v[0], s[1].v[0], s[2].v[0], s[3].v[0]);
+		__m128 sy = _mm_setr_ps(s[0].v[1], s[1].v[1], s[2].v[1], s[3].v[1]);
+		__m128 sz = _mm_setr_ps(s[0].v[2], s[1].v[2], s[2].v[2], s[3].v[2]);
+		__m128 x2 = _mm_add_ps(x, x), y2 = _mm_add_ps(y, y), z2 = _mm_add_ps(z, z);
+		__m128 xx = _mm_mul_ps(x, x2), yy = _mm_mul_ps(y, y2), zz = _mm_mul_ps(z, z2);
+		__m128 xy = _mm_mul_ps(x, y2), xz = _mm_mul_ps(x, z2), yz = _mm_mul_ps(y, z2);
+		__m128 wx = _mm_mul_ps(w, x2), wy = _mm_mul_ps(w, y2), wz = _mm_mul_ps(w, z2);
+		__m128 r0 = _mm_mul_ps(_mm_sub_ps(_mm_sub_ps(one, yy), zz), sx);
+		__m128 r1 = _mm_mul_ps(_mm_sub_ps(xy, wz), sy);
+		__m128 r2 = _mm_mul_ps(_mm_add_ps(xz, wy), sz);
+		__m128 r3 = tx;
+		// lanes back to rows: after the transpose r0..r3 hold row 0 of transforms i..i+3
+		_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+		_mm_storeu_ps(out[i].m[0], r0);
+		_mm_storeu_ps(out[i + 1].m[0], r1);
+		_mm_storeu_ps(out[i + 2].m[0], r2);
+		_mm_storeu_ps(out[i + 3].m[0], r3);
+		r0 = _mm_mul_ps(_mm_add_ps(xy, wz), sx);
+		r1 = _mm_mul_ps(_mm_sub_ps(_mm_sub_ps(one, xx), zz), sy);
+		r2 = _mm_mul_ps(_mm_sub_ps(yz, wx), sz);
+		r3 = ty;
+		_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+		_mm_storeu_ps(out[i].m[1], r0);
+		_mm_storeu_ps(out[i + 1].m[1], r1);
+		_mm_storeu_ps(out[i + 2].m[1], r2);
+		_mm_storeu_ps(out[i + 3].m[1], r3);
+		r0 = _mm_mul_ps(_mm_sub_ps(xz, wy), sx);
+		r1 = _mm_mul_ps(_mm_add_ps(yz, wx), sy);
+		r2 = _mm_mul_ps(_mm_sub_ps(_mm_sub_ps(one, xx), yy), sz);
+		r3 = tz;
+		_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+		_mm_storeu_ps(out[i].m[2], r0);
+		_mm_storeu_ps(out[i + 1].m[2], r1);
+		_mm_storeu_ps(out[i + 2].m[2], r2);
+		_mm_storeu_ps(out[i + 3].m[2], r3);
+		for (int k = 0; k < 4; k++)
+			_mm_storeu_ps(out[i + k].m[3], lastRow);
+	}
+#endif
+	for (; i < count; i++)
+		out[i] = composeTRS(positions[i], rotations[i], scales[i]);
+}
+
+
+
+// Contiguous TRS arrays, filled once per frame and turned into matrices by a single composeTRSBatch
+class TransformBatch {
+public:
+	std::vector<Vec3> positions;
+	std::vector<Quat> rotations;
+	std::vector<Vec3> scales;
+	std::vector<Mat4> matrices;
+
+	void clear()
+	{
+		positions.clear();
+		rotations.clear();
+		scales.clear();
+	}
+
+	// returns the index of the matrix built for this transform
+	int add(const Vec3& position, const Quat& rotation, const Vec3& scale)
+	{
+		positions.push_back(position);
+		rotations.push_back(rotation);
+		scales.push_back(scale);
+		return (int)positions.size() - 1;
+	}
+
+	int size() const
+	{
+		return (int)positions.size();
+	}
+
+	void build()
+	{
+		matrices.resize(positions.size());
+		build(0, size());
+	}
+
+	// matrices [begin, end) only, for splitting the build over threads; matrices must be sized already
+	void build(int begin, int end)
+	{
+		composeTRSBatch(positions.data() + begin, rotations.data() + begin, scales.data() + begin, matrices.data() + begin, end - begin);
+	}
+};
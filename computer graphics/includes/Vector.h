@@ -7,44 +7,44 @@ using namespace std;
 class Vec3 {
 public:
 	float v[3];
-	Vec3() : v{ 0.0f, 0.0f, 0.0f } {}
-	Vec3(float x, float y, float z) : v{ x, y, z } {}
+	constexpr Vec3() : v{ 0.0f, 0.0f, 0.0f } {}
+	constexpr Vec3(float x, float y, float z) : v{ x, y, z } {}
 
-	Vec3 operator+(const Vec3& pVec) const
+	constexpr Vec3 operator+(const Vec3& pVec) const
 	{
 		return Vec3(v[0] + pVec.v[0], v[1] + pVec.v[1], v[2] + pVec.v[2]);
 	}
-	Vec3& operator+=(const Vec3& pVec)
+	constexpr Vec3& operator+=(const Vec3& pVec)
 	{
 		v[0] += pVec.v[0];
 		v[1] += pVec.v[1];
 		v[2] += pVec.v[2];
 		return *this;
 	}
-	Vec3& operator-=(const Vec3& pVec)
+	constexpr Vec3& operator-=(const Vec3& pVec)
 	{
 		v[0] -= pVec.v[0];
 		v[1] -= pVec.v[1];
 		v[2] -= pVec.v[2];
 		return *this;
 	}
-	Vec3 operator*(const Vec3& pVec) const
+	constexpr Vec3 operator*(const Vec3& pVec) const
 	{
 		return Vec3(v[0] * pVec.v[0], v[1] * pVec.v[1], v[2] * pVec.v[2]);
 	}
-	Vec3 operator*(const float val) const
+	constexpr Vec3 operator*(const float val) const
 	{
 		return Vec3(v[0] * val, v[1] * val, v[2] * val);
 	}
-	Vec3 operator/(const float val) const
+	constexpr Vec3 operator/(const float val) const
 	{
 		return Vec3(v[0] / val, v[1] / val, v[2] / val);
 	}
-	Vec3 operator-() const
+	constexpr Vec3 operator-() const
 	{
 		return Vec3(-v[0], -v[1], -v[2]);
 	}
-	Vec3 operator-(const Vec3& pVec) const
+	constexpr Vec3 operator-(const Vec3& pVec) const
 	{
 		return Vec3(v[0] - pVec.v[0], v[1] - pVec.v[1], v[2] - pVec.v[2]);
 	}
@@ -69,12 +69,12 @@ public:
 		return sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
 	}
 
-	float Dot(const Vec3& pVec) const
+	constexpr float Dot(const Vec3& pVec) const
 	{
 		return v[0] * pVec.v[0] + v[1] * pVec.v[1] + v[2] * pVec.v[2];
 	}
 
-	Vec3 cross(const Vec3& v1) const
+	constexpr Vec3 cross(const Vec3& v1) const
 	{
 		return Vec3(v1.v[1] * v[2] - v1.v[2] * v[1],
 			v1.v[2] * v[0] - v1.v[0] * v[2],
@@ -82,12 +82,12 @@ public:
 	}
 };
 
-float Dot(const Vec3& v1, const Vec3& v2)
+constexpr float Dot(const Vec3& v1, const Vec3& v2)
 {
 	return v1.v[0] * v2.v[0] + v1.v[1] * v2.v[1] + v1.v[2] * v2.v[2];
 }
 
-Vec3 Max(const Vec3& v1, const Vec3& v2)
+inline Vec3 Max(const Vec3& v1, const Vec3& v2)
 {
 	return Vec3(max(v1.v[0], v2.v[0]),
 		max(v1.v[1], v2.v[1]),
@@ -99,18 +99,18 @@ Vec3 Max(const Vec3& v1, const Vec3& v2)
 class Vec4 {
 public:
 	float v[4];
-	Vec4() : v{ 0.0f, 0.0f, 0.0f, 0.0f } {}
-	Vec4(float x, float y, float z, float w) : v{ x, y, z, w } {}
+	constexpr Vec4() : v{ 0.0f, 0.0f, 0.0f, 0.0f } {}
+	constexpr Vec4(float x, float y, float z, float w) : v{ x, y, z, w } {}
 
-	Vec4 operator+(const Vec4& pVec) const
+	constexpr Vec4 operator+(const Vec4& pVec) const
 	{
 		return Vec4(v[0] + pVec.v[0], v[1] + pVec.v[1], v[2] + pVec.v[2], v[3] + pVec.v[3]);
 	}
-	Vec4 operator-(const Vec4& pVec) const
+	constexpr Vec4 operator-(const Vec4& pVec) const
 	{
 		return Vec4(v[0] - pVec.v[0], v[1] - pVec.v[1], v[2] - pVec.v[2], v[3] - pVec.v[3]);
 	}
-	Vec4& operator+=(const Vec4& pVec)
+	constexpr Vec4& operator+=(const Vec4& pVec)
 	{
 		v[0] += pVec.v[0];
 		v[1] += pVec.v[1];
@@ -118,7 +118,7 @@ public:
 		v[3] += pVec.v[3];
 		return *this;
 	}
-	Vec4& operator-=(const Vec4& pVec)
+	constexpr Vec4& operator-=(const Vec4& pVec)
 	{
 		v[0] -= pVec.v[0];
 		v[1] -= pVec.v[1];
@@ -126,23 +126,23 @@ public:
 		v[3] -= pVec.v[3];
 		return *this;
 	}
-	Vec4 operator*(const Vec4& pVec) const
+	constexpr Vec4 operator*(const Vec4& pVec) const
 	{
 		return Vec4(v[0] * pVec.v[0], v[1] * pVec.v[1], v[2] * pVec.v[2], v[3] * pVec.v[3]);
 	}
-	Vec4 operator*(const float val) const
+	constexpr Vec4 operator*(const float val) const
 	{
 		return Vec4(v[0] * val, v[1] * val, v[2] * val, v[3] * val);
 	}
-	Vec4 operator/(const float val) const
+	constexpr Vec4 operator/(const float val) const
 	{
 		return Vec4(v[0] / val, v[1] / val, v[2] / val, v[3] / val);
 	}
-	Vec4 operator-() const
+	constexpr Vec4 operator-() const
 	{
 		return Vec4(-v[0], -v[1], -v[2], -v[3]);
 	}
-	bool operator==(const Vec4& pVec) const
+	constexpr bool operator==(const Vec4& pVec) const
 	{
 		return (v[0] == pVec.v[0] && v[1] == pVec.v[1] && v[2] == pVec.v[2] && v[3] == pVec.v[3]);
 	}
@@ -155,12 +155,12 @@ public:
 		return Vec4(v[0] * len, v[1] * len, v[2] * len, v[3] * len);
 	}
 
-	float Dot(const Vec4& pVec) const
+	constexpr float Dot(const Vec4& pVec) const
 	{
 		return v[0] * pVec.v[0] + v[1] * pVec.v[1] + v[2] * pVec.v[2] + v[3] * pVec.v[3];
 	}
 
-	Vec4 cross(const Vec4& v1) const
+	constexpr Vec4 cross(const Vec4& v1) const
 	{
 		return Vec4(v1.v[1] * v[2] - v1.v[2] * v[1],
 			v1.v[2] * v[0] - v1.v[0] * v[2],
@@ -173,17 +173,31 @@ public:
 		return sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2] + v[3] * v[3]);
 	}
 
-	Vec4 transform(const Mat4& mat)
+	Vec4 transform(const Mat4& mat) const
 	{
 		Vec4 result;
+#ifdef MATH_SIMD_SSE
+		// column-major combination: M * v = c0 * x + c1 * y + c2 * z + c3 * w
+		__m128 c0 = _mm_loadu_ps(mat.m[0]);
+		__m128 c1 = _mm_loadu_ps(mat.m[1]);
+		__m128 c2 = _mm_loadu_ps(mat.m[2]);
+		__m128 c3 = _mm_loadu_ps(mat.m[3]);
+		_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+		__m128 r = _mm_mul_ps(c0, _mm_set1_ps(v[0]));
+		r = _mm_add_ps(r, _mm_mul_ps(c1, _mm_set1_ps(v[1])));
+		r = _mm_add_ps(r, _mm_mul_ps(c2, _mm_set1_ps(v[2])));
+		r = _mm_add_ps(r, _mm_mul_ps(c3, _mm_set1_ps(v[3])));
+		_mm_storeu_ps(result.v, r);
+#else
 		result.v[0] = mat.m[0][0] * v[0] + mat.m[0][1] * v[1] + mat.m[0][2] * v[2] + mat.m[0][3] * v[3];
 		result.v[1] = mat.m[1][0] * v[0] + mat.m[1][1] * v[1] + mat.m[1][2] * v[2] + mat.m[1][3] * v[3];
 		result.v[2] = mat.m[2][0] * v[0] + mat.m[2][1] * v[1] + mat.m[2][2] * v[2] + mat.m[2][3] * v[3];
 		result.v[3] = mat.m[3][0] * v[0] + mat.m[3][1] * v[1] + mat.m[3][2] * v[2] + mat.m[3][3] * v[3];
+#endif
 		return result;
 	}
 
-	Vec4 quatMultiply(const Vec4& q) const
+	constexpr Vec4 quatMultiply(const Vec4& q) const
 	{
 		return Vec4(
 			v[3] * q.v[0] + v[0] * q.v[3] + v[1] * q.v[2] - v[2] * q.v[1],
@@ -196,9 +210,79 @@ public:
 	Vec4 toQuaternion(Vec3 vec) const
 	{
 		Vec3 norm = vec.normalize();
-		float angle = acosf(norm.v[2]);
-		float s = sinf(angle / 2.0f);
-		return Vec4(norm.v[1] * s, -norm.v[0] * s, 0.0f, cosf(angle / 2.0f));
+		float angle = FastMath::acos(norm.v[2]);
+		float s, c;
+		FastMath::sincos(angle / 2.0f, s, c);
+		return Vec4(norm.v[1] * s, -norm.v[0] * s, 0.0f, c);
 	}
 
-};
\ No newline at end of file
+};
+
+
+
+// out[i] = mat * in[i] for count vectors, in and out may be the same array
+inline void transformBatch(const Mat4& mat, const Vec4* in, Vec4* out, int count)
+{
+	int i = 0;
+#ifdef MATH_SIMD_SSE
+	// transpose once so every vector is a sum of the matrix columns
+	__m128 c0 = _mm_loadu_ps(mat.m[0]);
+	__m128 c1 = _mm_loadu_ps(mat.m[1]);
+	__m128 c2 = _mm_loadu_ps(mat.m[2]);
+	__m128 c3 = _mm_loadu_ps(mat.m[3]);
+	_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+#ifdef MATH_SIMD_AVX
+	// two vectors per iteration, columns duplicated in both lanes
+	__m256 d0 = _mm256_set_m128(c0, c0);
+	__m256 d1 = _mm256_set_m128(c1, c1);
+	__m256 d2 = _mm256_set_m128(c2, c2);
+	__m256 d3 = _mm256_set_m128(c3, c3);
+	for (; i + 2 <= count; i += 2) {
+		__m256 p = _mm256_loadu_ps(in[i].v);
+		__m256 r = _mm256_mul_ps(d0, _mm256_permute_ps(p, 0x00));
+		r = _mm256_add_ps(r, _mm256_mul_ps(d1, _mm256_permute_ps(p, 0x55)));
+		r = _mm256_add_ps(r, _mm256_mul_ps(d2, _mm256_permute_ps(p, 0xAA)));
+		r = _mm256_add_ps(r, _mm256_mul_ps(d3, _mm256_permute_ps(p, 0xFF)));
+		_mm256_storeu_ps(out[i].v, r);
+	}
+#endif
+	for (; i < count; i++) {
+		__m128 p = _mm_loadu_ps(in[i].v);
+		__m128 r = _mm_mul_ps(c0, _mm_shuffle_ps(p, p, 0x00));
+		r = _mm_add_ps(r, _mm_mul_ps(c1, _mm_shuffle_ps(p, p, 0x55)));
+		r = _mm_add_ps(r, _mm_mul_ps(c2, _mm_shuffle_ps(p, p, 0xAA)));
+		r = _mm_add_ps(r, _mm_mul_ps(c3, _mm_shuffle_ps(p, p, 0xFF)));
+		_mm_storeu_ps(out[i].v, r);
+	}
+#else
+	for (; i < count; i++)
+		out[i] = in[i].transform(mat);
+#endif
+}
+
+// Transforms count points (w = 1) by mat, the projective row is ignored
+inline void transformPoints(const Mat4& mat, const Vec3* in, Vec3* out, int count)
+{
+#ifdef MATH_SIMD_SSE
+	__m128 c0 = _mm_loadu_ps(mat.m[0]);
+	__m128 c1 = _mm_loadu_ps(mat.m[1]);
+	__m128 c2 = _mm_loadu_ps(mat.m[2]);
+	__m128 c3 = _mm_loadu_ps(mat.m[3]);
+	_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+	alignas(16) float r[4];
+	for (int i = 0; i < count; i++) {
+		__m128 p = _mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(in[i].v[0])), c3);
+		p = _mm_add_ps(p, _mm_mul_ps(c1, _mm_set1_ps(in[i].v[1])));
+		p = _mm_add_ps(p, _mm_mul_ps(c2, _mm_set1_ps(in[i].v[2])));
+		_mm_store_ps(r, p);
+		out[i] = Vec3(r[0], r[1], r[2]);
+	}
+#else
+	for (int i = 0; i < count; i++) {
+		float x = in[i].v[0], y = in[i].v[1], z = in[i].v[2];
+		out[i] = Vec3(mat.m[0][0] * x + mat.m[0][1] * y + mat.m[0][2] * z + mat.m[0][3],
+			mat.m[1][0] * x + mat.m[1][1] * y + mat.m[1][2] * z + mat.m[1][3],
+			mat.m[2][0] * x + mat.m[2][1] * y + mat.m[2][2] * z + mat.m[2][3]);
+	}
+#endif
+}
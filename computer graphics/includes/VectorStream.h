@@ -0,0 +1,340 @@
+#pragma once
+#include <vector>
+#include <cstring>
+#include <cassert>
+#include <type_traits>
+#include "SIMD.h"
+#include "Vector.h"
+
+
+
+// Structure-of-arrays storage for N-component vectors, every component in its own aligned array.
+// Capacity is padded to a multiple of the SIMD width and the padding is kept zeroed, so the bulk
+// operations run whole registers without a scalar tail. Outputs may alias inputs, and both inputs
+// of a binary operation must hold the same number of elements.
+template<int N>
+class VecStream {
+public:
+	typedef typename std::conditional<N == 1, float,
+		typename std::conditional<N == 3, Vec3, Vec4>::type>::type VecType;
+
+	float* c[N];	// component arrays: c[0] = x, c[1] = y, ...
+	int count;
+	int capacity;
+
+	VecStream() : count(0), capacity(0), data(nullptr)
+	{
+		for (int k = 0; k < N; k++)
+			c[k] = nullptr;
+	}
+
+	VecStream(int n) : VecStream()
+	{
+		resize(n);
+	}
+
+	VecStream(const VecStream& other) : VecStream()
+	{
+		*this = other;
+	}
+
+	VecStream(VecStream&& other) noexcept : VecStream()
+	{
+		swap(other);
+	}
+
+	VecStream& operator=(const VecStream& other)
+	{
+		if (this == &other) return *this;
+		resize(other.count);
+		for (int k = 0; k < N; k++)
+			memcpy(c[k], other.c[k], other.padded() * sizeof(float));
+		return *this;
+	}
+
+	VecStream& operator=(VecStream&& other) noexcept
+	{
+		swap(other);
+		return *this;
+	}
+
+	~VecStream()
+	{
+		if (data != nullptr)
+			SIMD::alignedFree(data);
+	}
+
+	void swap(VecStream& other)
+	{
+		std::swap(data, other.data);
+		std::swap(count, other.count);
+		std::swap(capacity, other.capacity);
+		for (int k = 0; k < N; k++)
+			std::swap(c[k], other.c[k]);
+	}
+
+	// number of elements rounded up to whole SIMD registers
+	int padded() const
+	{
+		return (count + SIMD::width - 1) / SIMD::width * SIMD::width;
+	}
+
+	void reserve(int n)
+	{
+		if (n <= capacity) return;
+		// keep every component array aligned to a full register
+		int lanes = SIMD::alignment / sizeof(float);
+		int newCapacity = (n + lanes - 1) / lanes * lanes;
+		float* newData = (float*)SIMD::alignedAlloc((size_t)newCapacity * N * sizeof(float));
+		memset(newData, 0, (size_t)newCapacity * N * sizeof(float));
+		for (int k = 0; k < N; k++) {
+			if (count > 0)
+				memcpy(newData + k * newCapacity, c[k], count * sizeof(float));
+			c[k] = newData + k * newCapacity;
+		}
+		if (data != nullptr)
+			SIMD::alignedFree(data);
+		data = newData;
+		capacity = newCapacity;
+	}
+
+	void resize(int n)
+	{
+		reserve(n);
+		// zero anything dropped so the padding stays clean
+		for (int k = 0; k < N && n < count; k++)
+			memset(c[k] + n, 0, (count - n) * sizeof(float));
+		count = n;
+	}
+
+	void clear()
+	{
+		resize(0);
+	}
+
+	void set(int i, const VecType& v)
+	{
+		if constexpr (N == 1) {
+			c[0][i] = v;
+		}
+		else {
+			for (int k = 0; k < N; k++)
+				c[k][i] = v.v[k];
+		}
+	}
+
+	VecType get(int i) const
+	{
+		VecType v;
+		if constexpr (N == 1) {
+			v = c[0][i];
+		}
+		else {
+			for (int k = 0; k < N; k++)
+				v.v[k] = c[k][i];
+		}
+		return v;
+	}
+
+	void push_back(const VecType& v)
+	{
+		if (count == capacity)
+			reserve(capacity == 0 ? SIMD::alignment : capacity * 2);
+		count++;
+		set(count - 1, v);
+	}
+
+	// conversion from and to the array-of-structs types
+	void fromArray(const VecType* v, int n)
+	{
+		resize(n);
+		for (int i = 0; i < n; i++)
+			set(i, v[i]);
+	}
+
+	void fromVector(const std::vector<VecType>& v)
+	{
+		fromArray(v.data(), (int)v.size());
+	}
+
+	void toArray(VecType* v) const
+	{
+		for (int i = 0; i < count; i++)
+			v[i] = get(i);
+	}
+
+	std::vector<VecType> toVector() const
+	{
+		std::vector<VecType> v(count);
+		toArray(v.data());
+		return v;
+	}
+
+	// out = a + b
+	static void add(const VecStream& a, const VecStream& b, VecStream& out)
+	{
+		assert(a.count == b.count);
+		out.resize(a.count);
+		for (int k = 0; k < N; k++)
+			for (int i = 0; i < a.padded(); i += SIMD::width)
+				SIMD::store(out.c[k] + i, SIMD::add(SIMD::load(a.c[k] + i), SIMD::load(b.c[k] + i)));
+	}
+
+	// out = a - b
+	static void sub(const VecStream& a, const VecStream& b, VecStream& out)
+	{
+		assert(a.count == b.count);
+		out.resize(a.count);
+		for (int k = 0; k < N; k++)
+			for (int i = 0; i < a.padded(); i += SIMD::width)
+				SIMD::store(out.c[k] + i, SIMD::sub(SIMD::load(a.c[k] + i), SIMD::load(b.c[k] + i)));
+	}
+
+	// out = a * s
+	static void scale(const VecStream& a, float s, VecStream& out)
+	{
+		out.resize(a.count);
+		SIMD::vfloat vs = SIMD::set1(s);
+		for (int k = 0; k < N; k++)
+			for (int i = 0; i < a.padded(); i += SIMD::width)
+				SIMD::store(out.c[k] + i, SIMD::mul(SIMD::load(a.c[k] + i), vs));
+	}
+
+	// out = a + b * s, e.g. position += velocity * dt
+	static void madd(const VecStream& a, const VecStream& b, float s, VecStream& out)
+	{
+		assert(a.count == b.count);
+		out.resize(a.count);
+		SIMD::vfloat vs = SIMD::set1(s);
+		for (int k = 0; k < N; k++)
+			for (int i = 0; i < a.padded(); i += SIMD::width)
+				SIMD::store(out.c[k] + i, SIMD::madd(SIMD::load(b.c[k] + i), vs, SIMD::load(a.c[k] + i)));
+	}
+
+	// out[i] = dot(a[i], b[i])
+	static void dot(const VecStream& a, const VecStream& b, VecStream<1>& out)
+	{
+		assert(a.count == b.count);
+		out.resize(a.count);
+		for (int i = 0; i < a.padded(); i += SIMD::width) {
+			SIMD::vfloat d = SIMD::mul(SIMD::load(a.c[0] + i), SIMD::load(b.c[0] + i));
+			for (int k = 1; k < N; k++)
+				d = SIMD::madd(SIMD::load(a.c[k] + i), SIMD::load(b.c[k] + i), d);
+			SIMD::store(out.c[0] + i, d);
+		}
+	}
+
+	// out[i] = |a[i]|
+	static void length(const VecStream& a, VecStream<1>& out)
+	{
+		out.resize(a.count);
+		for (int i = 0; i < a.padded(); i += SIMD::width)
+			SIMD::store(out.c[0] + i, SIMD::sqrt(lengthSquared(a, i)));
+	}
+
+	// out[i] = a[i] / |a[i]|, zero-length vectors stay zero like Vec3::normalize
+	static void normalize(const VecStream& a, VecStream& out)
+	{
+		out.resize(a.count);
+		SIMD::vfloat zero = SIMD::set1(0.0f);
+		for (int i = 0; i < a.padded(); i += SIMD::width) {
+			SIMD::vfloat len2 = lengthSquared(a, i);
+			SIMD::vfloat inv = SIMD::select(SIMD::greater(len2, zero), SIMD::rsqrt(len2), zero);
+			for (int k = 0; k < N; k++)
+				SIMD::store(out.c[k] + i, SIMD::mul(SIMD::load(a.c[k] + i), inv));
+		}
+	}
+
+	// out[i] = cross(a[i], b[i]) with the same operand order as Vec3::cross
+	static void cross(const VecStream& a, const VecStream& b, VecStream& out)
+	{
+		static_assert(N == 3, "cross is only defined for Vec3Stream");
+		assert(a.count == b.count);
+		out.resize(a.count);
+		for (int i = 0; i < a.padded(); i += SIMD::width) {
+			SIMD::vfloat ax = SIMD::load(a.c[0] + i), ay = SIMD::load(a.c[1] + i), az = SIMD::load(a.c[2] + i);
+			SIMD::vfloat bx = SIMD::load(b.c[0] + i), by = SIMD::load(b.c[1] + i), bz = SIMD::load(b.c[2] + i);
+			SIMD::store(out.c[0] + i, SIMD::sub(SIMD::mul(by, az), SIMD::mul(bz, ay)));
+			SIMD::store(out.c[1] + i, SIMD::sub(SIMD::mul(bz, ax), SIMD::mul(bx, az)));
+			SIMD::store(out.c[2] + i, SIMD::sub(SIMD::mul(bx, ay), SIMD::mul(by, ax)));
+		}
+	}
+
+	// component-wise minimum and maximum of two streams
+	static void minimum(const VecStream& a, const VecStream& b, VecStream& out)
+	{
+		assert(a.count == b.count);
+		out.resize(a.count);
+		for (int k = 0; k < N; k++)
+			for (int i = 0; i < a.padded(); i += SIMD::width)
+				SIMD::store(out.c[k] + i, SIMD::vmin(SIMD::load(a.c[k] + i), SIMD::load(b.c[k] + i)));
+	}
+
+	static void maximum(const VecStream& a, const VecStream& b, VecStream& out)
+	{
+		assert(a.count == b.count);
+		out.resize(a.count);
+		for (int k = 0; k < N; k++)
+			for (int i = 0; i < a.padded(); i += SIMD::width)
+				SIMD::store(out.c[k] + i, SIMD::vmax(SIMD::load(a.c[k] + i), SIMD::load(b.c[k] + i)));
+	}
+
+	// component-wise bounds over the whole stream, e.g. an AABB around hitbox centres
+	void bounds(VecType& outMin, VecType& outMax) const
+	{
+		if (count == 0) return;
+		// padding lanes are zero and must not take part, so only full registers go through SIMD
+		int full = count / SIMD::width * SIMD::width;
+		for (int k = 0; k < N; k++) {
+			float lo = c[k][0];
+			float hi = c[k][0];
+			if (full > 0) {
+				SIMD::vfloat vlo = SIMD::load(c[k]);
+				SIMD::vfloat vhi = vlo;
+				for (int i = SIMD::width; i < full; i += SIMD::width) {
+					SIMD::vfloat v = SIMD::load(c[k] + i);
+					vlo = SIMD::vmin(vlo, v);
+					vhi = SIMD::vmax(vhi, v);
+				}
+				alignas(SIMD::alignment) float l[SIMD::width];
+				alignas(SIMD::alignment) float h[SIMD::width];
+				SIMD::store(l, vlo);
+				SIMD::store(h, vhi);
+				for (int j = 0; j < SIMD::width; j++) {
+					lo = l[j] < lo ? l[j] : lo;
+					hi = h[j] > hi ? h[j] : hi;
+				}
+			}
+			for (int i = full; i < count; i++) {
+				lo = c[k][i] < lo ? c[k][i] : lo;
+				hi = c[k][i] > hi ? c[k][i] : hi;
+			}
+			if constexpr (N == 1) {
+				outMin = lo;
+				outMax = hi;
+			}
+			else {
+				outMin.v[k] = lo;
+				outMax.v[k] = hi;
+			}
+		}
+	}
+
+private:
+	float* data;
+
+	static SIMD::vfloat lengthSquared(const VecStream& a, int i)
+	{
+		SIMD::vfloat x = SIMD::load(a.c[0] + i);
+		SIMD::vfloat len2 = SIMD::mul(x, x);
+		for (int k = 1; k < N; k++) {
+			SIMD::vfloat v = SIMD::load(a.c[k] + i);
+			len2 = SIMD::madd(v, v, len2);
+		}
+		return len2;
+	}
+};
+
+typedef VecStream<1> FloatStream;
+typedef VecStream<3> Vec3Stream;
+typedef VecStream<4> Vec4Stream;
@@ -0,0 +1,75 @@
+#pragma once
+#include "Vector.h"
+#include "Operators.h"
+
+
+
+// Vertex layouts shared by the GPU meshes and the CPU code that reads or writes them (skinning,
+// bounds), kept apart from Mesh.h so the CPU side builds without D3D12
+class Colour
+{
+public:
+	float r;
+	float g;
+	float b;
+	Colour() : r(0), g(0), b(0) {}
+	Colour(float red, float green, float blue) : r(red), g(green), b(blue) {}
+	Colour operator*(const Colour& col) const
+	{
+		return Colour(r * col.r, g * col.g, b * col.b);
+	}
+	Colour operator*(const float val) const
+	{
+		return Colour(r * val, g * val, b * val);
+	}
+	Colour operator/(const float val) const
+	{
+		return Colour(r / val, g / val, b / val);
+	}
+};
+
+struct PRIM_VERTEX
+{
+	Vec3 position;
+	Colour colour;
+};
+
+struct STATIC_VERTEX
+{
+	Vec3 pos;
+	Vec3 normal;
+	Vec3 tangent;
+	float uv[2];
+};
+
+struct ANIMATED_VERTEX
+{
+	Vec3 pos;
+	Vec3 normal;
+	Vec3 tangent;
+	float uv[2];
+	unsigned int bonesIDs[4];
+	float boneWeights[4];
+};
+
+struct UI_VERTEX
+{
+	float pos[2];
+	float uv[2];
+};
+
+inline STATIC_VERTEX addVertex(Vec3 p, Vec3 n, float tu, float tv)
+{
+	STATIC_VERTEX v;
+	v.pos = p;
+	v.normal = n;
+	v.tangent = anyOrthogonal(n).normalize();
+	v.uv[0] = tu;
+	v.uv[1] = tv;
+	return v;
+}
+
+struct InstanceData {
+	Mat4 World;
+	Vec4 Color;
+};
@@ -124,7 +124,7 @@
 		float randZ = ((float)(rand() % 1000) / 1000.0f - 0.5f) * 120.0f;
 		float randRotation = ((float)(rand() % 1000) / 1000.0f) * 360.0f;
 		float randScale = ((float)(rand() % 1000) / 1000.0f) * 0.01f + 0.005f;
-		inst.World = Mat4().Translate(randX, 0, randZ) * Mat4().RotateY(randRotation) * Mat4().Scale(randScale, randScale, randScale);
+		inst.World = Mat4::Translate(randX, 0, randZ) * Mat4::RotateY(randRotation) * Mat4::Scale(randScale, randScale, randScale);
 		inst.World = inst.World.Transpose();
 		instanceDatas.push_back(inst);
 	}
@@ -135,7 +135,7 @@
 	// params
 	float time = 0.0f;
 	Mat4 VP = camera.getViewProjectionMatrix();
-	Mat4 W = Mat4()._Identity();
+	Mat4 W = Mat4::_Identity();
 	Mat4 skyboxBuffer_W;
 	float animationTransition = 0.0f;
 	Vec4 lightDirection = Vec4(-1.0f, -1.0f, 0.0f, 0.0f).normalize();
@@ -169,7 +169,7 @@
 		playerActor.update(dt);
 		henList.update(dt);
 		VP = camera.getViewProjectionMatrix();
-		skyboxBuffer_W = Mat4().Translate(camera.position.v[0], camera.position.v[1], camera.position.v[2]) * Mat4().Scale(camera.clipFar - 1, camera.clipFar - 1, camera.clipFar - 1);
+		skyboxBuffer_W = Mat4::Translate(camera.position.v[0], camera.position.v[1], camera.position.v[2]) * Mat4::Scale(camera.clipFar - 1, camera.clipFar - 1, camera.clipFar - 1);
 
 		// update hitboxes
 		hitboxManager.update();
@@ -209,6 +209,10 @@
 
 
 int WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine, int nCmdShow) {
+	// -cook writes a .gemc next to every .gem under Models, which loadGEM then picks up instead
+	if (strstr(lpCmdLine, "-cook") != nullptr)
+		return cookModels("Models") < 0 ? 1 : 0;
+
 	// Create window and initialize core
 	Window win;
 	win.create(ScreenWidth, ScreenHeight, "My Window");
@@ -0,0 +1,59 @@
+#include <thread>
+#include "TestFramework.h"
+#include "HenCrowd.h"
+
+// ActorList::update on 1k, 5k and 10k hens, serial and then on a JobSystem of 2, 4, ... threads up to
+// the machine's core count: ms per frame, speedup over the serial update and the efficiency per
+// thread. Gameplay and event dispatch stay serial, so the curve flattens at their share of a frame.
+namespace {
+	volatile float actorListSink;
+
+	// ms per frame, speedup against serialMs, the serial update's time (0 for the serial run itself)
+	double benchCrowd(int hens, int threads, double serialMs)
+	{
+		JobSystem jobs(threads);
+		HenCrowd crowd;
+		if (!crowd.build(hens, threads > 1 ? &jobs : nullptr))
+			return 0.0;
+		// past the first transitions, with every clip the hens play loaded
+		for (int f = 0; f < 10; f++)
+			crowd.step();
+		int frames = Test::iterations(120);
+		double s = Test::seconds([&] { for (int f = 0; f < frames; f++) crowd.step(); });
+		double ms = s * 1000.0 / frames;
+		double speedup = serialMs > 0.0 ? serialMs / ms : 1.0;
+		double bones = (double)hens * crowd.boneCount(0) * frames / s / 1e6;
+		printf("  %6d hens %2d threads %8.2f ms/frame %6.2fx %5.0f%% per thread %8.1f M bones/s\n",
+			hens, threads, ms, speedup, 100.0 * speedup / threads, bones);
+		actorListSink = crowd.actors.actors[hens / 2]->getBoneMatrices()[1].m[0][3];
+		return ms;
+	}
+
+	void benchScaling(int hens)
+	{
+		int cores = (int)std::thread::hardware_concurrency();
+		cores = cores > 0 ? cores : 1;
+		double serialMs = benchCrowd(hens, 1, 0.0);
+		for (int threads = 2; threads <= cores; threads *= 2)
+			benchCrowd(hens, threads, serialMs);
+		if (cores > 1 && (cores & (cores - 1)) != 0)
+			benchCrowd(hens, cores, serialMs);
+	}
+}
+
+TEST_CASE(benchActorList1kHens)
+{
+	benchScaling(1000);
+}
+
+TEST_CASE(benchActorList5kHens)
+{
+	if (Test::quick) return;
+	benchScaling(5000);
+}
+
+TEST_CASE(benchActorList10kHens)
+{
+	if (Test::quick) return;
+	benchScaling(10000);
+}
@@ -0,0 +1,47 @@
+#include "TestFramework.h"
+#include "HenCrowd.h"
+
+// ActorList::update on a JobSystem against the same crowd updated without one: poses and world
+// matrices must come out bit identical for any thread count, the pose cache included. Thread counts
+// above the machine's core count still interleave the ranges differently, so they are run too.
+namespace {
+	// first actor whose bones or world matrix differ, -1 when every actor matches
+	int firstDifference(HenCrowd& a, HenCrowd& b)
+	{
+		for (int i = 0; i < (int)a.actors.actors.size(); i++) {
+			Actor* x = a.actors.actors[i];
+			Actor* y = b.actors.actors[i];
+			if (memcmp(x->getBoneMatrices(), y->getBoneMatrices(), a.boneCount(i) * sizeof(Mat4)) != 0 ||
+				memcmp(x->getWorldMatrix(), y->getWorldMatrix(), sizeof(Mat4)) != 0)
+				return i;
+		}
+		return -1;
+	}
+
+	void checkThreads(int hens, int threads, int frames)
+	{
+		HenCrowd serial, parallel;
+		JobSystem jobs(threads);
+		if (!serial.build(hens, nullptr) || !parallel.build(hens, &jobs))
+			return;
+		int mismatch = -1, mismatchFrame = -1;
+		for (int f = 0; f < frames && mismatch < 0; f++) {
+			serial.step();
+			parallel.step();
+			mismatch = firstDifference(serial, parallel);
+			mismatchFrame = f;
+		}
+		printf("  %d hens, %d threads, %d frames: %s, %d pose cache hits on the last frame\n", hens, threads, frames,
+			mismatch < 0 ? "identical" : "differ", parallel.actors.poseCache.hits);
+		if (mismatch >= 0)
+			printf("  first difference: actor %d on frame %d\n", mismatch, mismatchFrame);
+		CHECK(mismatch < 0);
+	}
+}
+
+TEST_CASE(actorListDeterminism)
+{
+	int frames = Test::quick ? 60 : 240;
+	for (int threads : { 2, 3, 4, 8 })
+		checkThreads(1000, threads, frames);
+}
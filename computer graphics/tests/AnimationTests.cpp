@@ -0,0 +1,142 @@
+#include "TestFramework.h"
+#include "EngineModels.h"
+#include "PaletteAtlas.h"
+
+// PaletteAtlas bake and lookup against the poses AnimationInstance::update produces for the same
+// clip times, on a synthetic clip with known motion and on the Hen's clips.
+namespace {
+	// instance posed at clip time t of clip
+	Mat4* poseAt(AnimationInstance& instance, int clip, float t)
+	{
+		if (instance.currentClip != clip)
+			instance.update(clip, 0.0f);
+		instance.t = t;
+		instance.update(clip, 0.0f);
+		return instance.getBoneMatrices();
+	}
+
+	// largest element difference, relative to the reference's largest translation
+	double paletteError(const Mat4* matrices, const Mat4* ref, int bones)
+	{
+		double error = 0.0, scale = 1.0;
+		for (int b = 0; b < bones; b++) {
+			for (int r = 0; r < 3; r++) {
+				for (int c = 0; c < 4; c++)
+					error = max(error, (double)fabsf(matrices[b].m[r][c] - ref[b].m[r][c]));
+				scale = max(scale, (double)fabsf(ref[b].m[r][3]));
+			}
+		}
+		return error / scale;
+	}
+
+	// Three bones in a chain, 10100 keys at 10000 per second so the clip is 1.01 s long, which a 30 Hz
+	// bake can't divide evenly. The root translates at constant speed and the middle bone turns at
+	// a constant rate, so a baked segment is close to linear and the blend factor decides the result;
+	// the keys are dense so the last key's hold barely bends the final segment.
+	void buildUnevenClip(Animation& animation)
+	{
+		const int bones = 3;
+		for (int i = 0; i < bones; i++) {
+			Bone bone;
+			bone.name = "bone" + std::to_string(i);
+			bone.parentIndex = i - 1;
+			animation.skeleton.bones.push_back(bone);
+		}
+		animation.skeleton.prepare();
+		AnimationSequence sequence;
+		sequence.ticksPerSecond = 10000.0f;
+		const int frames = 10100;
+		sequence.keys.allocate(frames, bones);
+		for (int f = 0; f < frames; f++) {
+			float t = (float)f / sequence.ticksPerSecond;
+			Vec3* positions = sequence.keys.framePositions(f);
+			Quat* rotations = sequence.keys.frameRotations(f);
+			Vec3* scales = sequence.keys.frameScales(f);
+			positions[0] = Vec3(100.0f * t, 50.0f * t, -20.0f * t);
+			positions[1] = Vec3(0.0f, 1.0f, 0.0f);
+			positions[2] = Vec3(0.0f, 1.0f, 0.0f);
+			rotations[0] = Quat();
+			rotations[1] = Quat::fromAxisAngle(Vec3(0.0f, 0.0f, 1.0f), 40.0f * t);
+			rotations[2] = Quat();
+			for (int b = 0; b < bones; b++)
+				scales[b] = Vec3(1.0f, 1.0f, 1.0f);
+		}
+		animation.animations.insert({ "uneven", std::move(sequence) });
+		animation.prepareForSharing();
+	}
+}
+
+TEST_CASE(paletteAtlasUnevenDuration)
+{
+	Animation animation;
+	buildUnevenClip(animation);
+	PaletteAtlas atlas;
+	atlas.bake(animation, 30.0f);
+	const PaletteAtlas::Clip& clip = atlas.clips[0];
+	CHECK(fabsf(clip.duration - 1.01f) < 1e-5f);
+	CHECK(clip.frameCount == 32);
+	CHECK(atlas.frameTime(clip, clip.frameCount - 1) == clip.duration);
+
+	int bones = animation.bonesSize();
+	AnimationInstance instance;
+	instance.animation = &animation;
+	std::vector<Mat4> evaluated(bones);
+
+	// every baked frame, including the last one clamped to the duration, is the update pose
+	double worstFrame = 0.0;
+	for (int f = 0; f < clip.frameCount; f++) {
+		float t = atlas.frameTime(clip, f);
+		atlas.evaluate(atlas.lookup(0, t), evaluated.data());
+		worstFrame = max(worstFrame, paletteError(evaluated.data(), poseAt(instance, 0, t), bones));
+	}
+	CHECK_BOUND("uneven clip, at baked frames", worstFrame, 1e-5);
+
+	// between frames, including the short last segment from 1.0 s to 1.01 s
+	double worst = 0.0, worstLast = 0.0;
+	for (int n = 0; n <= 10100; n++) {
+		float t = clip.duration * n / 10100.0f;
+		atlas.evaluate(atlas.lookup(0, t), evaluated.data());
+		double error = paletteError(evaluated.data(), poseAt(instance, 0, t), bones);
+		if (t > atlas.frameTime(clip, clip.frameCount - 2))
+			worstLast = max(worstLast, error);
+		else
+			worst = max(worst, error);
+	}
+	CHECK_BOUND("uneven clip, between frames", worst, 1e-4);
+	CHECK_BOUND("uneven clip, last segment", worstLast, 2e-4);
+
+	PaletteAtlas::Sample end = atlas.lookup(0, clip.duration);
+	CHECK(end.frame == clip.frameCount - 1 || (end.frame == clip.frameCount - 2 && end.blend == 1.0f));
+	PaletteAtlas::Sample middle = atlas.lookup(0, 1.005f);
+	CHECK(middle.frame == 30 && fabsf(middle.blend - 0.5f) < 1e-3f);
+}
+
+TEST_CASE(paletteAtlasHenClips)
+{
+	Animation animation;
+	if (!EngineModels::load("Hen-white", animation))
+		return;
+	PaletteAtlas atlas;
+	atlas.bake(animation, 30.0f);
+	int bones = animation.bonesSize();
+	AnimationInstance instance;
+	instance.animation = &animation;
+	std::vector<Mat4> evaluated(bones);
+	double worstFrame = 0.0, worstBetween = 0.0;
+	for (int c = 0; c < (int)atlas.clips.size(); c++) {
+		const PaletteAtlas::Clip& clip = atlas.clips[c];
+		for (int f = 0; f < clip.frameCount; f++) {
+			float t = atlas.frameTime(clip, f);
+			atlas.evaluate(atlas.lookup(c, t), evaluated.data());
+			worstFrame = max(worstFrame, paletteError(evaluated.data(), poseAt(instance, c, t), bones));
+			// halfway to the next frame only differs by how far the pose bends in one 30 Hz period
+			if (f + 1 < clip.frameCount) {
+				float half = 0.5f * (t + atlas.frameTime(clip, f + 1));
+				atlas.evaluate(atlas.lookup(c, half), evaluated.data());
+				worstBetween = max(worstBetween, paletteError(evaluated.data(), poseAt(instance, c, half), bones));
+			}
+		}
+	}
+	CHECK_BOUND("Hen clips, at baked frames", worstFrame, 1e-5);
+	CHECK_BOUND("Hen clips, halfway between frames", worstBetween, 0.15);
+}
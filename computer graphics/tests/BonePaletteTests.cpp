@@ -0,0 +1,151 @@
+#include "TestFramework.h"
+#include "EngineModels.h"
+#include "BonePalette.h"
+
+// BonePalette pack, unpack and skinPoint in every format against the float4x4 palette they are
+// packed from, on random rigid bones and on a posed Hen.
+namespace {
+	const PaletteFormat formats[] = { PALETTE_MAT4, PALETTE_MAT3X4, PALETTE_DUAL_QUAT };
+	const char* formatNames[] = { "PALETTE_MAT4", "PALETTE_MAT3X4", "PALETTE_DUAL_QUAT" };
+
+	struct Random {
+		unsigned int seed;
+		// uniform in [lo, hi)
+		float next(float lo, float hi)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			return lo + (hi - lo) * ((float)(seed >> 8) / 16777216.0f);
+		}
+	};
+
+	std::vector<Mat4> randomRigidBones(Random& random, int count)
+	{
+		std::vector<Mat4> bones(count);
+		for (int i = 0; i < count; i++) {
+			Vec3 axis(random.next(-1.0f, 1.0f), random.next(-1.0f, 1.0f), random.next(-1.0f, 1.0f) + 0.01f);
+			bones[i] = Mat4::Translate(random.next(-5.0f, 5.0f), random.next(-5.0f, 5.0f), random.next(-5.0f, 5.0f)) *
+				Mat4::Rotate(random.next(-180.0f, 180.0f), axis);
+		}
+		return bones;
+	}
+
+	// the float4x4 shader's blend in double
+	void referencePoint(const Mat4* bones, const unsigned int ids[4], const float weights[4], const Vec3& p, double out[3])
+	{
+		for (int r = 0; r < 3; r++) {
+			out[r] = 0.0;
+			for (int k = 0; k < 4; k++) {
+				const Mat4& b = bones[ids[k]];
+				out[r] += weights[k] * ((double)b.m[r][0] * p.v[0] + (double)b.m[r][1] * p.v[1] + (double)b.m[r][2] * p.v[2] + b.m[r][3]);
+			}
+		}
+	}
+
+	double pointError(const Vec3& p, const double ref[3])
+	{
+		return max(fabs(p.v[0] - ref[0]), max(fabs(p.v[1] - ref[1]), fabs(p.v[2] - ref[2])));
+	}
+
+	// pack and unpack in every format: sizes, exact round trips for the matrix formats, the rigid
+	// part for dual quaternions
+	void checkRoundTrip(const std::vector<Mat4>& bones, const char* what)
+	{
+		int count = (int)bones.size();
+		for (int f = 0; f < 3; f++) {
+			BonePalette palette;
+			palette.pack(bones.data(), count, formats[f]);
+			CHECK(palette.boneCount == count);
+			CHECK(palette.sizeInBytes() == (unsigned int)(count * BonePalette::floatsPerBone(formats[f]) * sizeof(float)));
+			double worst = 0.0;
+			for (int i = 0; i < count; i++) {
+				Mat4 unpacked = palette.unpack(i);
+				for (int r = 0; r < 4; r++)
+					for (int c = 0; c < 4; c++)
+						worst = max(worst, (double)fabsf(unpacked.m[r][c] - bones[i].m[r][c]));
+			}
+			std::string name = std::string(what) + ", " + formatNames[f] + " unpack";
+			CHECK_BOUND(name.c_str(), worst, formats[f] == PALETTE_DUAL_QUAT ? 1e-5 : 0.0);
+		}
+	}
+}
+
+TEST_CASE(bonePaletteRandomRigid)
+{
+	Random random{ 7u };
+	std::vector<Mat4> bones = randomRigidBones(random, 64);
+	CHECK(BonePalette::isRigid(bones.data(), (int)bones.size()));
+	checkRoundTrip(bones, "random rigid");
+
+	// single bone vertices: every format must reproduce the float4x4 result
+	double worst[3] = {};
+	for (int n = 0; n < 10000; n++) {
+		unsigned int ids[4] = { (unsigned int)(n % 64), 0, 0, 0 };
+		float weights[4] = { 1.0f, 0.0f, 0.0f, 0.0f };
+		Vec3 p(random.next(-2.0f, 2.0f), random.next(-2.0f, 2.0f), random.next(-2.0f, 2.0f));
+		double ref[3];
+		referencePoint(bones.data(), ids, weights, p, ref);
+		for (int f = 0; f < 3; f++) {
+			BonePalette palette;
+			palette.pack(bones.data(), (int)bones.size(), formats[f]);
+			worst[f] = max(worst[f], pointError(palette.skinPoint(ids, weights, p), ref));
+		}
+	}
+	CHECK_BOUND("single bone skinPoint, PALETTE_MAT4", worst[0], 1e-5);
+	CHECK_BOUND("single bone skinPoint, PALETTE_MAT3X4", worst[1], 1e-5);
+	CHECK_BOUND("single bone skinPoint, PALETTE_DUAL_QUAT", worst[2], 1e-4);
+
+	// four weights on copies of one bone blend to that bone as dual quaternions too, including the
+	// hemisphere flip when a copy is stored negated
+	BonePalette dual;
+	std::vector<Mat4> copies(4, bones[5]);
+	dual.pack(copies.data(), 4, PALETTE_DUAL_QUAT);
+	for (int c = 0; c < 8; c++) dual.data[8 + c] = -dual.data[8 + c];
+	unsigned int ids[4] = { 0, 1, 2, 3 };
+	float weights[4] = { 0.1f, 0.2f, 0.3f, 0.4f };
+	Vec3 p(0.5f, -1.0f, 2.0f);
+	double ref[3];
+	referencePoint(copies.data(), ids, weights, p, ref);
+	CHECK(pointError(dual.skinPoint(ids, weights, p), ref) < 1e-4);
+}
+
+TEST_CASE(bonePaletteHen)
+{
+	Animation animation;
+	std::vector<GEMLoader::GEMMesh> meshes;
+	if (!EngineModels::load("Hen-white", animation, &meshes))
+		return;
+	std::vector<ANIMATED_VERTEX> vertices = EngineModels::animatedVertices(meshes);
+	AnimationInstance instance;
+	instance.animation = &animation;
+	instance.update(EngineModels::longestClip(animation), 0.37f);
+	int count = animation.bonesSize();
+	std::vector<Mat4> bones(instance.getBoneMatrices(), instance.getBoneMatrices() + count);
+	bool rigid = BonePalette::isRigid(bones.data(), count);
+	printf("  Hen-white: %d bones, %s\n", count, rigid ? "rigid" : "scaled");
+	checkRoundTrip(bones, "Hen");
+
+	// matrix formats blend the same matrices as float4x4 for every vertex; dual quaternions only
+	// match on single bone vertices, and stay close elsewhere
+	double scale = 1.0, worstMatrix = 0.0, worstDualSingle = 0.0, worstDualBlend = 0.0;
+	BonePalette mat4, mat3x4, dual;
+	mat4.pack(bones.data(), count, PALETTE_MAT4);
+	mat3x4.pack(bones.data(), count, PALETTE_MAT3X4);
+	dual.pack(bones.data(), count, PALETTE_DUAL_QUAT);
+	for (const ANIMATED_VERTEX& v : vertices) {
+		double ref[3];
+		referencePoint(bones.data(), v.bonesIDs, v.boneWeights, v.pos, ref);
+		scale = max(scale, max(fabs(ref[0]), max(fabs(ref[1]), fabs(ref[2]))));
+		worstMatrix = max(worstMatrix, pointError(mat4.skinPoint(v.bonesIDs, v.boneWeights, v.pos), ref));
+		worstMatrix = max(worstMatrix, pointError(mat3x4.skinPoint(v.bonesIDs, v.boneWeights, v.pos), ref));
+		double dualError = pointError(dual.skinPoint(v.bonesIDs, v.boneWeights, v.pos), ref);
+		if (v.boneWeights[0] >= 1.0f - 1e-6f)
+			worstDualSingle = max(worstDualSingle, dualError);
+		else
+			worstDualBlend = max(worstDualBlend, dualError);
+	}
+	CHECK_BOUND("Hen skinPoint, matrix formats, relative", worstMatrix / scale, 1e-6);
+	if (rigid) {
+		CHECK_BOUND("Hen skinPoint, dual quaternion single bone, relative", worstDualSingle / scale, 1e-5);
+		CHECK_BOUND("Hen skinPoint, dual quaternion blended, relative", worstDualBlend / scale, 0.05);
+	}
+}
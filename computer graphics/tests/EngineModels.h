@@ -0,0 +1,78 @@
+#pragma once
+#include <fstream>
+#include "GEMLoader.h"
+#include "Animation.h"
+#include "Vertex.h"
+
+// The asset models for headless targets, without the D3D12 half of Model::load: the skeleton and
+// clips are set up the same way, but every clip's keys are read up front.
+namespace EngineModels {
+	inline std::string path(const std::string& name)
+	{
+		return std::string(ENGINE_MODELS) + "/AnimatedLowPolyAnimals/" + name + ".gem";
+	}
+
+	// false when the file is missing, so benchmarks can skip models the checkout doesn't have
+	inline bool load(const std::string& name, Animation& animation, std::vector<GEMLoader::GEMMesh>* meshes = nullptr, GEMLoader::GEMAnimation* source = nullptr)
+	{
+		std::string filename = path(name);
+		if (!std::ifstream(filename, std::ios::binary).good()) {
+			printf("  %s not found, skipped\n", filename.c_str());
+			return false;
+		}
+		GEMLoader::GEMModelLoader loader;
+		std::vector<GEMLoader::GEMMesh> loadedMeshes;
+		GEMLoader::GEMAnimation gemanimation;
+		loader.load(filename, meshes != nullptr ? *meshes : loadedMeshes, gemanimation);
+		for (const GEMLoader::GEMBone& gembone : gemanimation.bones) {
+			Bone bone;
+			bone.name = gembone.name;
+			memcpy(&bone.offset, &gembone.offset, 16 * sizeof(float));
+			bone.parentIndex = gembone.parentIndex;
+			animation.skeleton.bones.push_back(bone);
+		}
+		memcpy(&animation.skeleton.globalInverse, &gemanimation.globalInverse, 16 * sizeof(float));
+		animation.skeleton.prepare();
+		animation.sourceId = std::hash<std::string>()(filename);
+		int bones = (int)gemanimation.bones.size();
+		for (const GEMLoader::GEMAnimationSequence& clip : gemanimation.animations) {
+			AnimationSequence sequence;
+			sequence.ticksPerSecond = clip.ticksPerSecond;
+			sequence.keys.allocate((int)clip.frames.size(), bones);
+			for (int n = 0; n < (int)clip.frames.size(); n++) {
+				memcpy(sequence.keys.framePositions(n), clip.frames[n].positions.data(), bones * sizeof(Vec3));
+				memcpy(sequence.keys.frameRotations(n), clip.frames[n].rotations.data(), bones * sizeof(Quat));
+				memcpy(sequence.keys.frameScales(n), clip.frames[n].scales.data(), bones * sizeof(Vec3));
+			}
+			animation.animations.insert({ clip.name, std::move(sequence) });
+		}
+		animation.prepareForSharing();
+		if (source != nullptr)
+			*source = std::move(gemanimation);
+		return true;
+	}
+
+	// the clip with the most frames, the longest run of keys to sample
+	inline int longestClip(Animation& animation)
+	{
+		int longest = 0;
+		for (int i = 1; i < animation.clipCount(); i++)
+			if (animation.clip(i).frameCount() > animation.clip(longest).frameCount())
+				longest = i;
+		return longest;
+	}
+
+	// every mesh's skinned vertices in one array, GEM vertices share ANIMATED_VERTEX's layout
+	inline std::vector<ANIMATED_VERTEX> animatedVertices(const std::vector<GEMLoader::GEMMesh>& meshes)
+	{
+		static_assert(sizeof(GEMLoader::GEMAnimatedVertex) == sizeof(ANIMATED_VERTEX), "GEM animated vertex layout");
+		std::vector<ANIMATED_VERTEX> vertices;
+		for (const GEMLoader::GEMMesh& mesh : meshes) {
+			size_t first = vertices.size();
+			vertices.resize(first + mesh.verticesAnimated.size());
+			if (!mesh.verticesAnimated.empty())
+				memcpy(&vertices[first], mesh.verticesAnimated.data(), mesh.verticesAnimated.size() * sizeof(ANIMATED_VERTEX));
+		}
+		return vertices;
+	}
+}
@@ -0,0 +1,33 @@
+#include "TestFramework.h"
+#include "FastMath.h"
+
+// FastMath against the CRT, one value at a time and through the array kernels, in million values
+// per second
+static volatile float fastMathSink;
+
+template<typename Work>
+static void report(const char* name, int count, int repeats, Work work)
+{
+	double s = Test::seconds([&] { for (int r = 0; r < repeats; r++) work(); });
+	printf("  %-24s %8.1f M/s\n", name, (double)count * repeats / s / 1e6);
+}
+
+TEST_CASE(benchFastMath)
+{
+	const int count = 1 << 20;
+	int repeats = Test::iterations(20);
+	std::vector<float> x(count), s(count), c(count);
+	for (int i = 0; i < count; i++) x[i] = -100.0f + 200.0f * i / (count - 1);
+	report("sinf + cosf", count, repeats, [&] { for (int i = 0; i < count; i++) { s[i] = sinf(x[i]); c[i] = cosf(x[i]); } });
+	report("FastMath::sincos", count, repeats, [&] { for (int i = 0; i < count; i++) FastMath::sincos(x[i], s[i], c[i]); });
+	report("FastMath::sincos array", count, repeats, [&] { FastMath::sincos(x.data(), s.data(), c.data(), count); });
+	for (int i = 0; i < count; i++) x[i] = -1.0f + 2.0f * i / (count - 1);
+	report("acosf", count, repeats, [&] { for (int i = 0; i < count; i++) s[i] = acosf(x[i]); });
+	report("FastMath::acos", count, repeats, [&] { for (int i = 0; i < count; i++) s[i] = FastMath::acos(x[i]); });
+	report("FastMath::acos array", count, repeats, [&] { FastMath::acos(x.data(), s.data(), count); });
+	for (int i = 0; i < count; i++) x[i] = -20.0f + 40.0f * i / (count - 1);
+	report("expf", count, repeats, [&] { for (int i = 0; i < count; i++) s[i] = expf(x[i]); });
+	report("FastMath::exp", count, repeats, [&] { for (int i = 0; i < count; i++) s[i] = FastMath::exp(x[i]); });
+	report("FastMath::exp array", count, repeats, [&] { FastMath::exp(x.data(), s.data(), count); });
+	fastMathSink = s[count / 3] + c[count / 5];
+}
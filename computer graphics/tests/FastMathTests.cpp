@@ -0,0 +1,120 @@
+#include "TestFramework.h"
+#include "FastMath.h"
+
+// Sweeps every FastMath kernel over the range its header states against double precision and
+// checks the stated bound, through the scalar calls and the array kernels (SIMD unless the build
+// is MATH_NO_SIMD or MATH_PRECISE). Odd counts leave a scalar tail in the array kernels.
+
+static const int sweepCount = (1 << 21) + 3;
+static const double piDouble = 3.14159265358979323846;
+
+// evenly spaced over [lo, hi] with both ends included
+static std::vector<float> sweep(float lo, float hi, int count)
+{
+	std::vector<float> x(count);
+	for (int i = 0; i < count; i++)
+		x[i] = (float)((double)lo + ((double)hi - lo) * i / (count - 1));
+	x[count - 1] = hi;
+	return x;
+}
+
+TEST_CASE(fastMathSinCos)
+{
+	std::vector<float> x = sweep(-8192.0f, 8192.0f, sweepCount);
+	std::vector<float> s(x.size()), c(x.size());
+	FastMath::sincos(x.data(), s.data(), c.data(), (int)x.size());
+	double arrayError = 0.0, scalarError = 0.0;
+	for (size_t i = 0; i < x.size(); i++) {
+		double rs = sin((double)x[i]), rc = cos((double)x[i]);
+		arrayError = fmax(arrayError, fmax(fabs(s[i] - rs), fabs(c[i] - rc)));
+		float ss, cs;
+		FastMath::sincos(x[i], ss, cs);
+		scalarError = fmax(scalarError, fmax(fabs(ss - rs), fabs(cs - rc)));
+		scalarError = fmax(scalarError, fmax(fabs(FastMath::sin(x[i]) - rs), fabs(FastMath::cos(x[i]) - rc)));
+	}
+	CHECK_BOUND("sincos array, |x| <= 8192, absolute", arrayError, 1e-7);
+	CHECK_BOUND("sincos scalar, |x| <= 8192, absolute", scalarError, 1e-7);
+	// degrees go through the same kernel after a float multiply, so the bound holds for that product
+	double degreeError = 0.0;
+	for (int d = -720; d <= 720; d++) {
+		float sd, cd;
+		FastMath::sincosDeg((float)d, sd, cd);
+		double r = (double)((float)d * FastMath::degToRad);
+		degreeError = fmax(degreeError, fmax(fabs(sd - sin(r)), fabs(cd - cos(r))));
+	}
+	CHECK_BOUND("sincosDeg, whole degrees in [-720, 720]", degreeError, 1e-7);
+}
+
+TEST_CASE(fastMathAcos)
+{
+	std::vector<float> x = sweep(-1.0f, 1.0f, sweepCount);
+	std::vector<float> out(x.size());
+	FastMath::acos(x.data(), out.data(), (int)x.size());
+	double arrayError = 0.0, scalarError = 0.0;
+	for (size_t i = 0; i < x.size(); i++) {
+		double r = acos((double)x[i]);
+		arrayError = fmax(arrayError, fabs(out[i] - r));
+		scalarError = fmax(scalarError, fabs(FastMath::acos(x[i]) - r));
+	}
+	CHECK_BOUND("acos array, [-1, 1], absolute", arrayError, 5e-7);
+	CHECK_BOUND("acos scalar, [-1, 1], absolute", scalarError, 5e-7);
+	CHECK(FastMath::acos(1.0f) == 0.0f);
+	CHECK(fabs(FastMath::acos(-1.0f) - piDouble) < 5e-7);
+#ifndef MATH_PRECISE
+	// dot products a rounding step past 1 clamp instead of giving NaN
+	CHECK(FastMath::acos(1.0000001f) == 0.0f);
+	CHECK(fabs(FastMath::acos(-1.0000001f) - piDouble) < 5e-7);
+#endif
+}
+
+TEST_CASE(fastMathExp)
+{
+	std::vector<float> x = sweep(FastMath::expMin, FastMath::expMax, sweepCount);
+	std::vector<float> out(x.size());
+	FastMath::exp(x.data(), out.data(), (int)x.size());
+	double arrayError = 0.0, scalarError = 0.0;
+	for (size_t i = 0; i < x.size(); i++) {
+		double r = exp((double)x[i]);
+		arrayError = fmax(arrayError, fabs(out[i] - r) / r);
+		scalarError = fmax(scalarError, fabs(FastMath::exp(x[i]) - r) / r);
+	}
+	CHECK_BOUND("exp array, [-87.3, 88.3], relative", arrayError, 1e-7);
+	CHECK_BOUND("exp scalar, [-87.3, 88.3], relative", scalarError, 1e-7);
+	CHECK(FastMath::exp(0.0f) == 1.0f);
+#ifndef MATH_PRECISE
+	// below the range is flushed to 0 rather than denormal, above it saturates at exp(expMax)
+	float low[9] = { -87.4f, -88.0f, -100.0f, -1000.0f, -1e30f, -87.31f, -90.0f, -200.0f, -87.5f };
+	float lowOut[9];
+	FastMath::exp(low, lowOut, 9);
+	for (int i = 0; i < 9; i++) {
+		CHECK(lowOut[i] == 0.0f);
+		CHECK(FastMath::exp(low[i]) == 0.0f);
+	}
+	float high[9] = { 88.3f, 88.5f, 89.0f, 100.0f, 1000.0f, 1e30f, 88.31f, 95.0f, 500.0f };
+	float highOut[9];
+	FastMath::exp(high, highOut, 9);
+	float top = FastMath::exp(FastMath::expMax);
+	CHECK(std::isfinite(top));
+	for (int i = 0; i < 9; i++) {
+		CHECK(highOut[i] == top);
+		CHECK(FastMath::exp(high[i]) == top);
+	}
+#endif
+}
+
+// the array forms may write over their input
+TEST_CASE(fastMathInPlace)
+{
+	std::vector<float> x = sweep(-10.0f, 10.0f, 1001);
+	std::vector<float> s = x, c(x.size()), e = x, a = sweep(-1.0f, 1.0f, 1001), a0 = a;
+	FastMath::sincos(s.data(), s.data(), c.data(), (int)s.size());
+	FastMath::exp(e.data(), e.data(), (int)e.size());
+	FastMath::acos(a.data(), a.data(), (int)a.size());
+	double error = 0.0;
+	for (size_t i = 0; i < x.size(); i++) {
+		error = fmax(error, fabs(s[i] - sin((double)x[i])));
+		error = fmax(error, fabs(e[i] - exp((double)x[i])) / exp((double)x[i]));
+		error = fmax(error, fabs(a[i] - acos((double)a0[i])));
+	}
+	CHECK_BOUND("in place sincos, exp, acos", error, 5e-7);
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include <fstream>
+#include "EngineModels.h"
+#include "Actor.h"
+
+// A pen of hens set up as Levels.h does, for headless targets built against headless/d3d12: the
+// four hen models shared through a ModelCache, and a player circling the pen that the hens flee,
+// walking and running in turns and now and then catching and releasing one.
+class HenCrowd {
+public:
+	Core core;
+	ModelCache models;
+	PSOManager psos;
+	EventBus eventBus;
+	Window window;
+	Player player;
+	std::vector<Object*> objects;
+	ActorList actors;
+	int frame = 0;
+
+	HenCrowd() : player(&window) {}
+
+	HenCrowd(const HenCrowd&) = delete;
+	HenCrowd& operator=(const HenCrowd&) = delete;
+
+	~HenCrowd()
+	{
+		for (Actor* actor : actors.actors)
+			delete actor;
+		for (Object* object : objects)
+			delete object;
+	}
+
+	// false when a hen model is missing from the checkout
+	bool build(int count, JobSystem* jobs, unsigned int seed = 11)
+	{
+		const char* names[] = { "Hen-brown", "Hen-white", "Rooster-dark", "Rooster-brown" };
+		for (const char* name : names) {
+			if (!std::ifstream(EngineModels::path(name), std::ios::binary).good()) {
+				printf("  %s not found, skipped\n", EngineModels::path(name).c_str());
+				return false;
+			}
+		}
+		actors.jobs = jobs;
+		actors.clipEvictionInterval = 0.0f;
+		player.position = Vec3(30.0f, 0.0f, 0.0f);
+		srand(seed);
+		for (int i = 0; i < count; i++) {
+			Object* object = new Object(&psos);
+			object->loadGEM(&core, models, EngineModels::path(names[rand() % 4]).c_str(), "animatedPSO");
+			object->scale = Vec3(0.05f, 0.05f, 0.05f);
+			objects.push_back(object);
+			Hen* hen = new Hen();
+			hen->init(object);
+			hen->setPlayer(&player);
+			hen->position = Vec3(((float)(rand() % 1000) / 1000.0f - 0.5f) * 100.0f, 0.0f, ((float)(rand() % 1000) / 1000.0f - 0.5f) * 100.0f);
+			hen->subscribeEvent(&eventBus);
+			actors.addActor(hen);
+		}
+		return true;
+	}
+
+	// one 60 Hz frame: the player moves, the list updates, then the queued events are dispatched
+	void step()
+	{
+		const float dt = 1.0f / 60.0f;
+		float angle = frame * 0.05f;
+		Vec3 previous = player.position;
+		player.position = Vec3(cosf(angle) * 30.0f, 0.0f, sinf(angle) * 30.0f);
+		player.forward = (player.position - previous).normalize();
+		player.speed = (frame / 60) % 2 ? PLAYER_RUN_SPEED : PLAYER_WALK_SPEED;
+		if (frame % 120 == 60) {
+			PlayerCatchEvent caught;
+			caught.player = &player;
+			caught.catchPosition = player.position;
+			caught.playerForward = player.forward;
+			eventBus.queue<PlayerCatchEvent>(caught);
+		}
+		else if (frame % 120 == 110) {
+			PlayerReleaseEvent released;
+			released.player = &player;
+			released.releasePosition = player.position;
+			released.playerForward = player.forward;
+			eventBus.queue<PlayerReleaseEvent>(released);
+		}
+		actors.update(dt);
+		eventBus.dispatch();
+		frame++;
+	}
+
+	int boneCount(int actor)
+	{
+		return actors.actors[actor]->getAnimation()->bonesSize();
+	}
+};
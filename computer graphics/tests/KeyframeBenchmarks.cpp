@@ -0,0 +1,131 @@
+#include "TestFramework.h"
+#include "EngineModels.h"
+
+// Sampling a Hen clip's keys from the KeyframeBuffer against the layout it replaced, in million
+// bones per second. OldSequence is the original storage: one AnimationFrame per key holding three
+// vectors, filled a push_back at a time for every clip in file order as loadGEM did.
+namespace {
+	struct OldFrame {
+		std::vector<Vec3> positions;
+		std::vector<Quat> rotations;
+		std::vector<Vec3> scales;
+	};
+
+	struct OldSequence {
+		std::vector<OldFrame> frames;
+
+		int nextFrame(int frame) const
+		{
+			return min(frame + 1, (int)frames.size() - 1);
+		}
+
+		// the per bone sampling of the old interpolateBoneToGlobal, without the matrix build
+		void sample(int baseFrame, float t, LocalPose& pose, int bones) const
+		{
+			const OldFrame& a = frames[baseFrame];
+			const OldFrame& b = frames[nextFrame(baseFrame)];
+			for (int i = 0; i < bones; i++) {
+				pose.positions[i] = a.positions[i] * (1.0f - t) + b.positions[i] * t;
+				pose.rotations[i] = Quat::slerp(a.rotations[i], b.rotations[i], t);
+				pose.scales[i] = a.scales[i] * (1.0f - t) + b.scales[i] * t;
+			}
+		}
+	};
+
+	std::vector<OldSequence> buildOldLayout(const GEMLoader::GEMAnimation& gemanimation)
+	{
+		std::vector<OldSequence> sequences(gemanimation.animations.size());
+		for (size_t n = 0; n < gemanimation.animations.size(); n++) {
+			for (const GEMLoader::GEMAnimationFrame& gemframe : gemanimation.animations[n].frames) {
+				OldFrame frame;
+				for (size_t i = 0; i < gemframe.positions.size(); i++) {
+					Vec3 p, s;
+					Quat q;
+					memcpy(&p, &gemframe.positions[i], sizeof(Vec3));
+					memcpy(&q, &gemframe.rotations[i], sizeof(Quat));
+					memcpy(&s, &gemframe.scales[i], sizeof(Vec3));
+					frame.positions.push_back(p);
+					frame.rotations.push_back(q);
+					frame.scales.push_back(s);
+				}
+				sequences[n].frames.push_back(frame);
+			}
+		}
+		return sequences;
+	}
+
+	float poseDifference(const LocalPose& a, const LocalPose& b, int bones)
+	{
+		float worst = 0.0f;
+		for (int i = 0; i < bones; i++) {
+			for (int k = 0; k < 3; k++) {
+				worst = max(worst, fabsf(a.positions[i].v[k] - b.positions[i].v[k]));
+				worst = max(worst, fabsf(a.scales[i].v[k] - b.scales[i].v[k]));
+			}
+			for (int k = 0; k < 4; k++)
+				worst = max(worst, fabsf(a.rotations[i].v[k] - b.rotations[i].v[k]));
+		}
+		return worst;
+	}
+
+	volatile float keyframeSink;
+}
+
+TEST_CASE(benchKeyframeSampling)
+{
+	Animation animation;
+	GEMLoader::GEMAnimation gemanimation;
+	if (!EngineModels::load("Hen-white", animation, nullptr, &gemanimation))
+		return;
+	std::vector<OldSequence> oldSequences = buildOldLayout(gemanimation);
+	int handle = EngineModels::longestClip(animation);
+	AnimationSequence& sequence = animation.clip(handle);
+	// handles follow the map's name order, the GEM file keeps its own
+	const OldSequence* old = nullptr;
+	auto it = std::next(animation.animations.begin(), handle);
+	for (size_t n = 0; n < gemanimation.animations.size(); n++)
+		if (gemanimation.animations[n].name == it->first)
+			old = &oldSequences[n];
+	CHECK(old != nullptr);
+	if (old == nullptr) return;
+
+	int bones = animation.bonesSize();
+	std::vector<int> allBones(bones);
+	for (int i = 0; i < bones; i++) allBones[i] = i;
+	printf("  clip %s: %d frames, %d bones, %zu key bytes\n", it->first.c_str(), sequence.frameCount(), bones, sequence.keyBytes());
+
+	LocalPose oldPose, bonePose, batchPose;
+	oldPose.resize(bones);
+	bonePose.resize(bones);
+	batchPose.resize(bones);
+	const int samples = Test::iterations(200000);
+	float duration = sequence.duration();
+	auto run = [&](const char* name, auto sample) {
+		double s = Test::seconds([&] {
+			for (int n = 0; n < samples; n++) {
+				int frame;
+				float fact;
+				sequence.calcFrame(fmodf(n * 0.0137f, duration), frame, fact);
+				sample(frame, fact);
+			}
+		});
+		printf("  %-32s %8.1f M bones/s\n", name, (double)samples * bones / s / 1e6);
+	};
+	run("old AnimationFrame layout", [&](int frame, float fact) { old->sample(frame, fact, oldPose, bones); });
+	run("KeyframeBuffer, per bone", [&](int frame, float fact) { sequence.sampleBones(frame, fact, bonePose, allBones, true); });
+	run("KeyframeBuffer, sampleLocalPose", [&](int frame, float fact) { sequence.sampleLocalPose(frame, fact, batchPose, bones); });
+
+	// same keys and the same arithmetic, so the layouts agree at every sample up to FMA contraction
+	float worst = 0.0f;
+	for (int n = 0; n < 1000; n++) {
+		int frame;
+		float fact;
+		sequence.calcFrame(fmodf(n * 0.0137f, duration), frame, fact);
+		old->sample(frame, fact, oldPose, bones);
+		sequence.sampleBones(frame, fact, bonePose, allBones, true);
+		sequence.sampleLocalPose(frame, fact, batchPose, bones);
+		worst = max(worst, max(poseDifference(oldPose, bonePose, bones), poseDifference(oldPose, batchPose, bones)));
+	}
+	CHECK(worst <= 1e-5f);
+	keyframeSink = oldPose.positions[bones - 1].v[0] + batchPose.rotations[bones - 1].v[3] + bonePose.scales[0].v[1];
+}
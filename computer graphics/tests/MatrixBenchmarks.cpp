@@ -0,0 +1,139 @@
+#include "TestFramework.h"
+#include "Vector.h"
+
+// Mat4 products and vector transforms against the implementation they replaced, in million
+// operations per second. OldMat4 is the scalar original: identity filled by loops in the
+// constructor, a triple loop product and one vector at a time transforms.
+struct OldMat4 {
+	float m[4][4];
+	OldMat4()
+	{
+		for (int i = 0; i < 4; i++)
+			m[i][i] = 1.0f;
+		for (int i = 0; i < 4; i++)
+			for (int j = 0; j < 4; j++)
+				if (i != j)
+					m[i][j] = 0.0f;
+	}
+
+	OldMat4 operator*(const OldMat4& mat) const
+	{
+		OldMat4 result;
+		for (int i = 0; i < 4; i++) {
+			for (int j = 0; j < 4; j++) {
+				result.m[i][j] = m[i][0] * mat.m[0][j] +
+					m[i][1] * mat.m[1][j] +
+					m[i][2] * mat.m[2][j] +
+					m[i][3] * mat.m[3][j];
+			}
+		}
+		return result;
+	}
+
+	void transform(const float* v, float* result) const
+	{
+		result[0] = m[0][0] * v[0] + m[0][1] * v[1] + m[0][2] * v[2] + m[0][3] * v[3];
+		result[1] = m[1][0] * v[0] + m[1][1] * v[1] + m[1][2] * v[2] + m[1][3] * v[3];
+		result[2] = m[2][0] * v[0] + m[2][1] * v[1] + m[2][2] * v[2] + m[2][3] * v[3];
+		result[3] = m[3][0] * v[0] + m[3][1] * v[1] + m[3][2] * v[2] + m[3][3] * v[3];
+	}
+};
+
+static volatile float matrixSink;
+
+template<typename Work>
+static void report(const char* name, int count, int repeats, Work work)
+{
+	double s = Test::seconds([&] { for (int r = 0; r < repeats; r++) work(); });
+	printf("  %-32s %8.1f M/s\n", name, (double)count * repeats / s / 1e6);
+}
+
+// well conditioned matrices with values around one, so repeated products stay finite
+static void fillMatrices(std::vector<Mat4>& mats, std::vector<OldMat4>& old)
+{
+	unsigned int seed = 12345u;
+	for (size_t n = 0; n < mats.size(); n++) {
+		for (int i = 0; i < 4; i++) {
+			for (int j = 0; j < 4; j++) {
+				seed = seed * 1664525u + 1013904223u;
+				float r = (float)(seed >> 8) / 16777216.0f - 0.5f;
+				mats[n].m[i][j] = old[n].m[i][j] = (i == j ? 1.0f : 0.0f) + 0.25f * r;
+			}
+		}
+	}
+}
+
+static float maxDifference(const Mat4& a, const OldMat4& b)
+{
+	float worst = 0.0f;
+	for (int i = 0; i < 4; i++)
+		for (int j = 0; j < 4; j++)
+			worst = max(worst, fabsf(a.m[i][j] - b.m[i][j]));
+	return worst;
+}
+
+TEST_CASE(benchMatrixMultiply)
+{
+	const int count = 4096;
+	int repeats = Test::iterations(500);
+	std::vector<Mat4> a(count), b(count), out(count);
+	std::vector<OldMat4> oldA(count), oldB(count), oldOut(count);
+	fillMatrices(a, oldA);
+	fillMatrices(b, oldB);
+	std::reverse(b.begin(), b.end());
+	std::reverse(oldB.begin(), oldB.end());
+
+	report("old operator*", count, repeats, [&] { for (int i = 0; i < count; i++) oldOut[i] = oldA[i] * oldB[i]; });
+	report("Mat4 operator*", count, repeats, [&] { for (int i = 0; i < count; i++) out[i] = a[i] * b[i]; });
+	report("Mat4::multiply", count, repeats, [&] { for (int i = 0; i < count; i++) Mat4::multiply(a[i], b[i], out[i]); });
+	report("Mat4::multiplyBatch", count, repeats, [&] { Mat4::multiplyBatch(a.data(), b.data(), out.data(), count); });
+	float worst = 0.0f;
+	for (int i = 0; i < count; i++) worst = max(worst, maxDifference(out[i], oldOut[i]));
+	CHECK(worst <= 1e-5f);
+
+	// one parent against many children, as when concatenating a hierarchy level
+	report("old operator*, shared left", count, repeats, [&] { for (int i = 0; i < count; i++) oldOut[i] = oldA[0] * oldB[i]; });
+	report("Mat4::multiplyBatch, shared left", count, repeats, [&] { Mat4::multiplyBatch(a[0], b.data(), out.data(), count); });
+	worst = 0.0f;
+	for (int i = 0; i < count; i++) worst = max(worst, maxDifference(out[i], oldOut[i]));
+	CHECK(worst <= 1e-5f);
+
+	// a dependent chain, where latency rather than throughput bounds the product
+	OldMat4 oldChain;
+	Mat4 chain;
+	int chainRepeats = Test::iterations(200);
+	report("old operator*, chained", count, chainRepeats, [&] { for (int i = 0; i < count; i++) oldChain = oldChain * oldB[i]; });
+	report("Mat4::multiply, chained", count, chainRepeats, [&] { for (int i = 0; i < count; i++) Mat4::multiply(chain, b[i], chain); });
+	matrixSink = out[count / 2].m[1][2] + oldOut[count / 3].m[2][1] + chain.m[0][0] + oldChain.m[0][0];
+}
+
+TEST_CASE(benchMatrixTransform)
+{
+	const int count = 1 << 16;
+	int repeats = Test::iterations(500);
+	std::vector<Mat4> mats(1);
+	std::vector<OldMat4> oldMats(1);
+	fillMatrices(mats, oldMats);
+	std::vector<Vec4> in(count), out(count);
+	std::vector<Vec3> points(count), pointsOut(count);
+	std::vector<float> oldOut(count * 4);
+	for (int i = 0; i < count; i++) {
+		float x = (float)(i % 97) - 48.0f, y = (float)(i % 89) - 44.0f, z = (float)(i % 83) - 41.0f;
+		in[i] = Vec4(x, y, z, 1.0f);
+		points[i] = Vec3(x, y, z);
+	}
+
+	report("old transform", count, repeats, [&] { for (int i = 0; i < count; i++) oldMats[0].transform(in[i].v, &oldOut[i * 4]); });
+	report("Vec4::transform", count, repeats, [&] { for (int i = 0; i < count; i++) out[i] = in[i].transform(mats[0]); });
+	report("transformBatch", count, repeats, [&] { transformBatch(mats[0], in.data(), out.data(), count); });
+	report("transformPoints", count, repeats, [&] { transformPoints(mats[0], points.data(), pointsOut.data(), count); });
+	float worst = 0.0f;
+	for (int i = 0; i < count; i++) {
+		for (int k = 0; k < 4; k++)
+			worst = max(worst, fabsf(out[i].v[k] - oldOut[i * 4 + k]));
+		for (int k = 0; k < 3; k++)
+			worst = max(worst, fabsf(pointsOut[i].v[k] - oldOut[i * 4 + k]));
+	}
+	CHECK(worst <= 1e-4f);
+	matrixSink = out[count / 2].v[1] + pointsOut[count / 3].v[2];
+}
@@ -0,0 +1,154 @@
+#include "TestFramework.h"
+#include "Vector.h"
+
+// Mat4 inverses against a double precision Gauss-Jordan reference. invert() is invertSIMD in SSE
+// builds and invertScalar otherwise, so the scalar target covers the fallback through the same case.
+namespace {
+	struct Random {
+		unsigned int seed;
+		// uniform in [lo, hi)
+		float next(float lo, float hi)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			return lo + (hi - lo) * ((float)(seed >> 8) / 16777216.0f);
+		}
+	};
+
+	// inverse with partial pivoting, false if the matrix is singular
+	bool referenceInverse(const Mat4& mat, double out[4][4])
+	{
+		double a[4][8];
+		for (int i = 0; i < 4; i++) {
+			for (int j = 0; j < 4; j++) {
+				a[i][j] = mat.m[i][j];
+				a[i][j + 4] = i == j ? 1.0 : 0.0;
+			}
+		}
+		for (int c = 0; c < 4; c++) {
+			int pivot = c;
+			for (int r = c + 1; r < 4; r++)
+				if (fabs(a[r][c]) > fabs(a[pivot][c])) pivot = r;
+			if (a[pivot][c] == 0.0) return false;
+			for (int j = 0; j < 8; j++) std::swap(a[c][j], a[pivot][j]);
+			double d = a[c][c];
+			for (int j = 0; j < 8; j++) a[c][j] /= d;
+			for (int r = 0; r < 4; r++) {
+				if (r == c) continue;
+				double f = a[r][c];
+				for (int j = 0; j < 8; j++) a[r][j] -= f * a[c][j];
+			}
+		}
+		for (int i = 0; i < 4; i++)
+			for (int j = 0; j < 4; j++)
+				out[i][j] = a[i][j + 4];
+		return true;
+	}
+
+	// largest element error relative to the largest element of the reference
+	double relativeError(const Mat4& mat, const double ref[4][4])
+	{
+		double error = 0.0, scale = 1.0;
+		for (int i = 0; i < 4; i++) {
+			for (int j = 0; j < 4; j++) {
+				error = max(error, fabs(mat.m[i][j] - ref[i][j]));
+				scale = max(scale, fabs(ref[i][j]));
+			}
+		}
+		return error / scale;
+	}
+
+	Vec3 randomAxis(Random& random)
+	{
+		return Vec3(random.next(-1.0f, 1.0f), random.next(-1.0f, 1.0f), random.next(-1.0f, 1.0f) + 0.01f);
+	}
+
+	Mat4 randomRigid(Random& random)
+	{
+		return Mat4::Translate(random.next(-10.0f, 10.0f), random.next(-10.0f, 10.0f), random.next(-10.0f, 10.0f)) *
+			Mat4::Rotate(random.next(-180.0f, 180.0f), randomAxis(random));
+	}
+
+	const int inverseSamples = 20000;
+}
+
+TEST_CASE(matrixInvertGeneral)
+{
+	Random random{ 1u };
+	double worst = 0.0, worstScalar = 0.0;
+#ifdef MATH_SIMD_SSE
+	double worstSIMD = 0.0;
+#endif
+	int tested = 0;
+	for (int n = 0; n < inverseSamples; n++) {
+		Mat4 mat = Mat4(Mat4::Uninitialised());
+		for (int i = 0; i < 4; i++)
+			for (int j = 0; j < 4; j++)
+				mat.m[i][j] = random.next(-2.0f, 2.0f);
+		double ref[4][4];
+		if (!referenceInverse(mat, ref)) continue;
+		// float inverses of ill-conditioned matrices are not expected to match
+		double size = 0.0;
+		for (int i = 0; i < 4; i++)
+			for (int j = 0; j < 4; j++)
+				size = max(size, fabs(ref[i][j]));
+		if (size > 50.0) continue;
+		worst = max(worst, relativeError(mat.invert(), ref));
+		worstScalar = max(worstScalar, relativeError(mat.invertScalar(), ref));
+#ifdef MATH_SIMD_SSE
+		worstSIMD = max(worstSIMD, relativeError(mat.invertSIMD(), ref));
+#endif
+		tested++;
+	}
+	CHECK(tested > inverseSamples / 2);
+	CHECK_BOUND("invert, relative error", worst, 1e-4);
+	CHECK_BOUND("invertScalar, relative error", worstScalar, 1e-4);
+#ifdef MATH_SIMD_SSE
+	CHECK_BOUND("invertSIMD, relative error", worstSIMD, 1e-4);
+#endif
+}
+
+TEST_CASE(matrixInvertAffine)
+{
+	Random random{ 2u };
+	double worst = 0.0, worstGeneral = 0.0;
+	for (int n = 0; n < inverseSamples; n++) {
+		float s = random.next(0.1f, 2.0f);
+		Mat4 mat = randomRigid(random) * Mat4::Scale(s, s * 1.5f, s * 0.7f);
+		double ref[4][4];
+		CHECK(referenceInverse(mat, ref));
+		Mat4 inv = mat.invertAffine();
+		worst = max(worst, relativeError(inv, ref));
+		worstGeneral = max(worstGeneral, relativeError(mat.invert(), ref));
+		CHECK(inv.m[3][0] == 0.0f && inv.m[3][1] == 0.0f && inv.m[3][2] == 0.0f && inv.m[3][3] == 1.0f);
+	}
+	CHECK_BOUND("invertAffine, relative error", worst, 1e-5);
+	CHECK_BOUND("invert on TRS, relative error", worstGeneral, 1e-5);
+}
+
+TEST_CASE(matrixInvertRigid)
+{
+	Random random{ 3u };
+	double worst = 0.0;
+	for (int n = 0; n < inverseSamples; n++) {
+		Mat4 mat = randomRigid(random);
+		double ref[4][4];
+		CHECK(referenceInverse(mat, ref));
+		worst = max(worst, relativeError(mat.invertRigid(), ref));
+	}
+	CHECK_BOUND("invertRigid, relative error", worst, 1e-5);
+}
+
+TEST_CASE(matrixInvertSingular)
+{
+	// singular input falls back to identity rather than dividing by zero
+	Mat4 singular;
+	singular.m[3][3] = 0.0f;
+	Mat4 inv = singular.invert();
+	Mat4 affine = Mat4::Scale(1.0f, 0.0f, 1.0f).invertAffine();
+	for (int i = 0; i < 4; i++) {
+		for (int j = 0; j < 4; j++) {
+			CHECK(inv.m[i][j] == (i == j ? 1.0f : 0.0f));
+			CHECK(affine.m[i][j] == (i == j ? 1.0f : 0.0f));
+		}
+	}
+}
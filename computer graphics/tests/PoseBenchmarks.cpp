@@ -0,0 +1,89 @@
+#include "TestFramework.h"
+#include "EngineModels.h"
+
+// Pose evaluation for a field of 10k hens, in million bones per second: AnimationInstance::update
+// (local TRS, composeTRSBatch, the ordered affine hierarchy pass, folded offsets) against the
+// per bone pipeline it replaced, which built T, R and S matrices, multiplied by the parent and then
+// by offset and globalInverse in a second loop. Both read the same keys through the same slerp, so
+// the difference is the matrix work.
+namespace {
+	void oldPose(Animation& animation, AnimationSequence& sequence, float t, Mat4* matrices)
+	{
+		int frame;
+		float fact;
+		sequence.calcFrame(t, frame, fact);
+		int next = sequence.nextFrame(frame);
+		Skeleton& skeleton = animation.skeleton;
+		for (int i = 0; i < animation.bonesSize(); i++) {
+			Vec3 s = sequence.interpolate(sequence.keys.frameScales(frame)[i], sequence.keys.frameScales(next)[i], fact);
+			Quat r = sequence.interpolate(sequence.keys.frameRotations(frame)[i], sequence.keys.frameRotations(next)[i], fact);
+			Vec3 p = sequence.interpolate(sequence.keys.framePositions(frame)[i], sequence.keys.framePositions(next)[i], fact);
+			Mat4 local = Mat4::Translate(p.v[0], p.v[1], p.v[2]) * Mat4::rotationQuaternion(r.v[0], r.v[1], r.v[2], r.v[3]) * Mat4::Scale(s.v[0], s.v[1], s.v[2]);
+			int parent = skeleton.bones[i].parentIndex;
+			matrices[i] = parent > -1 ? matrices[parent] * local : local;
+		}
+		for (int i = 0; i < animation.bonesSize(); i++)
+			matrices[i] = matrices[i] * skeleton.bones[i].offset * skeleton.globalInverse;
+	}
+
+	volatile float poseSink;
+}
+
+TEST_CASE(benchPose10kHens)
+{
+	Animation animation;
+	if (!EngineModels::load("Hen-white", animation))
+		return;
+	int clip = animation.findClip("walk");
+	clip = clip < 0 ? 0 : clip;
+	AnimationSequence& sequence = animation.clip(clip);
+	int bones = animation.bonesSize();
+	const int hens = 10000;
+	const float dt = 1.0f / 60.0f;
+	int frames = Test::iterations(40);
+
+	std::vector<AnimationInstance> instances(hens);
+	std::vector<float> times(hens);
+	std::vector<Mat4> oldMatrices((size_t)hens * bones);
+	for (int i = 0; i < hens; i++) {
+		instances[i].animation = &animation;
+		instances[i].update(clip, 0.0f);
+		instances[i].t = times[i] = (i % 97) * 0.0113f;
+	}
+
+	// the same poses from both pipelines before timing them
+	float worst = 0.0f, scale = 1.0f;
+	for (int i = 0; i < hens; i += 997) {
+		instances[i].update(clip, 0.0f);
+		oldPose(animation, sequence, instances[i].t, &oldMatrices[(size_t)i * bones]);
+		for (int b = 0; b < bones; b++) {
+			for (int r = 0; r < 4; r++) {
+				for (int c = 0; c < 4; c++) {
+					float a = instances[i].matrices[b].m[r][c], o = oldMatrices[(size_t)i * bones + b].m[r][c];
+					worst = max(worst, fabsf(a - o));
+					scale = max(scale, fabsf(o));
+				}
+			}
+		}
+	}
+	CHECK(worst <= 1e-5f * scale);
+
+	double oldSeconds = Test::seconds([&] {
+		for (int f = 0; f < frames; f++) {
+			for (int i = 0; i < hens; i++) {
+				times[i] = fmodf(times[i] + dt, sequence.duration());
+				oldPose(animation, sequence, times[i], &oldMatrices[(size_t)i * bones]);
+			}
+		}
+	});
+	double newSeconds = Test::seconds([&] {
+		for (int f = 0; f < frames; f++)
+			for (int i = 0; i < hens; i++)
+				instances[i].update(clip, dt);
+	});
+	double boneCount = (double)frames * hens * bones;
+	printf("  %d hens x %d bones\n", hens, bones);
+	printf("  %-32s %8.2f ms/frame %8.1f M bones/s\n", "old per bone pipeline", oldSeconds * 1000.0 / frames, boneCount / oldSeconds / 1e6);
+	printf("  %-32s %8.2f ms/frame %8.1f M bones/s\n", "AnimationInstance::update", newSeconds * 1000.0 / frames, boneCount / newSeconds / 1e6);
+	poseSink = oldMatrices[bones - 1].m[0][3] + instances[hens - 1].matrices[bones - 1].m[1][3];
+}
@@ -0,0 +1,154 @@
+#include "TestFramework.h"
+#include "Quat.h"
+
+// Quat::slerp and fromRotation against double precision references. The slerp reference is the
+// textbook sin((1 - t) theta) / sin(theta) form along the shortest arc.
+namespace {
+	struct Random {
+		unsigned int seed;
+		// uniform in [lo, hi)
+		float next(float lo, float hi)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			return lo + (hi - lo) * ((float)(seed >> 8) / 16777216.0f);
+		}
+	};
+
+	Quat randomQuat(Random& random)
+	{
+		Quat q(random.next(-1.0f, 1.0f), random.next(-1.0f, 1.0f), random.next(-1.0f, 1.0f), random.next(-1.0f, 1.0f));
+		return q.Dot(q) < 1e-4f ? Quat() : q.normalize();
+	}
+
+	// q with every component nudged by up to epsilon, renormalized
+	Quat perturb(Random& random, const Quat& q, float epsilon)
+	{
+		return Quat(q.v[0] + random.next(-epsilon, epsilon), q.v[1] + random.next(-epsilon, epsilon),
+			q.v[2] + random.next(-epsilon, epsilon), q.v[3] + random.next(-epsilon, epsilon)).normalize();
+	}
+
+	void referenceSlerp(const Quat& a, const Quat& b, double t, double out[4])
+	{
+		double d = 0.0;
+		for (int k = 0; k < 4; k++) d += (double)a.v[k] * b.v[k];
+		double sign = d < 0.0 ? -1.0 : 1.0;
+		d = fabs(d) > 1.0 ? 1.0 : fabs(d);
+		double theta = acos(d);
+		double cA = 1.0 - t, cB = t;
+		if (theta > 1e-12) {
+			cA = sin((1.0 - t) * theta) / sin(theta);
+			cB = sin(t * theta) / sin(theta);
+		}
+		for (int k = 0; k < 4; k++) out[k] = cA * a.v[k] + sign * cB * b.v[k];
+	}
+
+	double slerpError(const Quat& a, const Quat& b, float t)
+	{
+		Quat r = Quat::slerp(a, b, t);
+		double ref[4];
+		referenceSlerp(a, b, t, ref);
+		double error = 0.0;
+		for (int k = 0; k < 4; k++) error = max(error, fabs(r.v[k] - ref[k]));
+		return error;
+	}
+
+	// q and -q are the same rotation
+	double rotationError(const Quat& q, const Quat& ref)
+	{
+		double plus = 0.0, minus = 0.0;
+		for (int k = 0; k < 4; k++) {
+			plus = max(plus, fabs((double)q.v[k] - ref.v[k]));
+			minus = max(minus, fabs((double)q.v[k] + ref.v[k]));
+		}
+		return min(plus, minus);
+	}
+
+	const int quatSamples = 200000;
+}
+
+TEST_CASE(quatSlerp)
+{
+	Random random{ 1u };
+	double worst = 0.0, worstNear = 0.0;
+	for (int n = 0; n < quatSamples; n++) {
+		Quat a = randomQuat(random);
+		Quat b = randomQuat(random);
+		float t = (float)(n % 1001) / 1000.0f;
+		// keep a quarter of the pairs within 90 degrees, the keyframe case the fit is tuned for
+		if (n % 4 == 0) {
+			b = perturb(random, a, 0.3f);
+			worstNear = max(worstNear, slerpError(a, b, t));
+		}
+		else {
+			worst = max(worst, slerpError(a, b, t));
+		}
+	}
+	CHECK_BOUND("slerp, neighbouring keys", worstNear, 1e-6);
+	CHECK_BOUND("slerp, any pair", worst, 5e-5);
+}
+
+TEST_CASE(quatSlerpParallel)
+{
+	// dot(a, b) close to +1 and -1, where sin(theta) / theta forms divide by ~0
+	Random random{ 2u };
+	double worstPlus = 0.0, worstMinus = 0.0;
+	for (int n = 0; n < quatSamples / 10; n++) {
+		Quat a = randomQuat(random);
+		float epsilon = n % 3 == 0 ? 0.0f : (n % 3 == 1 ? 1e-6f : 1e-3f);
+		Quat b = perturb(random, a, epsilon);
+		float t = (float)(n % 101) / 100.0f;
+		worstPlus = max(worstPlus, slerpError(a, b, t));
+		worstMinus = max(worstMinus, slerpError(a, -b, t));
+		// -b is the same rotation, so the shortest arc result stays on a's side
+		Quat r = Quat::slerp(a, -b, t);
+		CHECK(r.Dot(a) > 0.99f);
+		CHECK(fabsf(r.Dot(r) - 1.0f) < 1e-5f);
+	}
+	CHECK_BOUND("slerp, dot near +1", worstPlus, 1e-6);
+	CHECK_BOUND("slerp, dot near -1", worstMinus, 1e-6);
+}
+
+TEST_CASE(quatSlerpBatch)
+{
+	// the SSE batch must agree with the scalar slerp, including the scalar tail
+	Random random{ 3u };
+	const int count = 1027;
+	std::vector<Quat> a(count), b(count), out(count);
+	for (int i = 0; i < count; i++) {
+		a[i] = randomQuat(random);
+		b[i] = i % 5 == 0 ? -perturb(random, a[i], 1e-4f) : randomQuat(random);
+	}
+	double worst = 0.0;
+	for (float t : { 0.0f, 0.37f, 1.0f }) {
+		Quat::slerpBatch(a.data(), b.data(), t, out.data(), count);
+		for (int i = 0; i < count; i++) {
+			Quat r = Quat::slerp(a[i], b[i], t);
+			for (int k = 0; k < 4; k++) worst = max(worst, (double)fabsf(r.v[k] - out[i].v[k]));
+		}
+	}
+	CHECK_BOUND("slerpBatch against slerp", worst, 1e-6);
+}
+
+TEST_CASE(quatFromRotation)
+{
+	Random random{ 4u };
+	double worst = 0.0, worstHalfTurn = 0.0;
+	for (int n = 0; n < quatSamples; n++) {
+		Quat q = randomQuat(random);
+		worst = max(worst, rotationError(Quat::fromRotation(q.toMat4()), q));
+	}
+	// near half turns about each axis the trace is close to -1 and every branch is taken
+	const Vec3 axes[] = { Vec3(1.0f, 0.0f, 0.0f), Vec3(0.0f, 1.0f, 0.0f), Vec3(0.0f, 0.0f, 1.0f), Vec3(1.0f, 1.0f, 0.0f), Vec3(0.3f, -0.2f, 0.9f) };
+	for (Vec3 axis : axes) {
+		Vec3 unit = axis.normalize();
+		for (int n = 0; n < 1000; n++) {
+			Quat q = Quat::fromAxisAngle(unit, 180.0f + random.next(-1.0f, 1.0f)).normalize();
+			worstHalfTurn = max(worstHalfTurn, rotationError(Quat::fromRotation(q.toMat4()), q));
+		}
+		// a rotation built straight from the axis and angle, not through toMat4
+		Quat ref(unit.v[0], unit.v[1], unit.v[2], 0.0f);
+		worstHalfTurn = max(worstHalfTurn, rotationError(Quat::fromRotation(Mat4::Rotate(180.0f, unit)), ref));
+	}
+	CHECK_BOUND("fromRotation(toMat4(q)) against q", worst, 2e-6);
+	CHECK_BOUND("fromRotation near half turns", worstHalfTurn, 1e-5);
+}
@@ -0,0 +1,79 @@
+#include <thread>
+#include "TestFramework.h"
+#include "EngineModels.h"
+#include "Skinning.h"
+
+// CPU skinning throughput on Farmer-male and Hen, in million vertices per second and per core. The
+// model is repeated into a crowd so the threaded runs have enough work per thread; the scalar line
+// is a straightforward per vertex blend of whole Mat4s, the shader's algorithm written naively.
+namespace {
+	void naiveSkin(const Mat4* bones, const ANIMATED_VERTEX* in, STATIC_VERTEX* out, int count)
+	{
+		for (int i = 0; i < count; i++) {
+			const ANIMATED_VERTEX& v = in[i];
+			Mat4 blend = bones[v.bonesIDs[0]] * v.boneWeights[0];
+			for (int k = 1; k < 4; k++)
+				blend += bones[v.bonesIDs[k]] * v.boneWeights[k];
+			Vec4 p = Vec4(v.pos.v[0], v.pos.v[1], v.pos.v[2], 1.0f).transform(blend);
+			Vec4 n = Vec4(v.normal.v[0], v.normal.v[1], v.normal.v[2], 0.0f).transform(blend);
+			Vec4 t = Vec4(v.tangent.v[0], v.tangent.v[1], v.tangent.v[2], 0.0f).transform(blend);
+			out[i].pos = Vec3(p.v[0], p.v[1], p.v[2]);
+			out[i].normal = Vec3(n.v[0], n.v[1], n.v[2]).normalize();
+			out[i].tangent = Vec3(t.v[0], t.v[1], t.v[2]).normalize();
+			out[i].uv[0] = v.uv[0];
+			out[i].uv[1] = v.uv[1];
+		}
+	}
+
+	volatile float skinningSink;
+
+	void benchModel(const char* name)
+	{
+		Animation animation;
+		std::vector<GEMLoader::GEMMesh> meshes;
+		if (!EngineModels::load(name, animation, &meshes))
+			return;
+		std::vector<ANIMATED_VERTEX> vertices = EngineModels::animatedVertices(meshes);
+		AnimationInstance instance;
+		instance.animation = &animation;
+		instance.update(EngineModels::longestClip(animation), 0.37f);
+		SkinPalette palette;
+		palette.set(instance.getBoneMatrices(), animation.bonesSize());
+
+		std::vector<ANIMATED_VERTEX> crowd;
+		const int target = Test::quick ? 1 << 16 : 1 << 20;
+		while ((int)crowd.size() < target)
+			crowd.insert(crowd.end(), vertices.begin(), vertices.end());
+		int count = (int)crowd.size();
+		std::vector<STATIC_VERTEX> out(count);
+		std::vector<Vec3> positions(count);
+		int repeats = Test::iterations(20);
+		printf("  %s: %d vertices, %d bones, crowd of %d vertices\n", name, (int)vertices.size(), animation.bonesSize(), count);
+
+		auto report = [&](const char* what, int threads, auto work) {
+			double s = Test::seconds([&] { for (int r = 0; r < repeats; r++) work(); });
+			double rate = (double)count * repeats / s / 1e6;
+			printf("  %-28s %2d threads %8.1f M vertices/s %8.1f per core\n", what, threads, rate, rate / threads);
+		};
+		report("naive scalar Mat4 blend", 1, [&] { naiveSkin(instance.getBoneMatrices(), crowd.data(), out.data(), count); });
+		report("Skinning::skin", 1, [&] { Skinning::skin(palette, crowd.data(), out.data(), 0, count); });
+		report("Skinning::skinPositions", 1, [&] { Skinning::skinPositions(palette, crowd.data(), positions.data(), 0, count); });
+		int cores = (int)std::thread::hardware_concurrency();
+		cores = cores > 0 ? cores : 1;
+		for (int threads = 2; threads <= cores; threads *= 2)
+			report("Skinning::skinParallel", threads, [&] { Skinning::skinParallel(palette, crowd.data(), out.data(), count, threads); });
+		if (cores > 1 && (cores & (cores - 1)) != 0)
+			report("Skinning::skinParallel", cores, [&] { Skinning::skinParallel(palette, crowd.data(), out.data(), count, cores); });
+		skinningSink = out[count / 2].pos.v[1] + positions[count / 3].v[0];
+	}
+}
+
+TEST_CASE(benchSkinningHen)
+{
+	benchModel("Hen-white");
+}
+
+TEST_CASE(benchSkinningFarmer)
+{
+	benchModel("Farmer-male");
+}
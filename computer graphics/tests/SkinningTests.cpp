@@ -0,0 +1,137 @@
+#include "TestFramework.h"
+#include "EngineModels.h"
+#include "Skinning.h"
+
+// The skinning kernels (SSE, or the scalar fallback in the MATH_NO_SIMD target) against a double
+// precision skin of the same vertices, and the threaded versions against the single threaded one.
+namespace {
+	// the vertex shader's blend in double: M = sum of w * bone, position M * p, normal and tangent
+	// through the upper 3x3 and renormalised
+	void referenceSkin(const Mat4* bones, const Mat4& world, const ANIMATED_VERTEX& v, double pos[3], double normal[3], double tangent[3])
+	{
+		double blend[3][4] = {};
+		for (int k = 0; k < 4; k++)
+			for (int r = 0; r < 3; r++)
+				for (int c = 0; c < 4; c++)
+					blend[r][c] += (double)v.boneWeights[k] * bones[v.bonesIDs[k]].m[r][c];
+		double m[3][4];
+		for (int r = 0; r < 3; r++) {
+			for (int c = 0; c < 4; c++) {
+				m[r][c] = world.m[r][0] * blend[0][c] + world.m[r][1] * blend[1][c] + world.m[r][2] * blend[2][c];
+				if (c == 3) m[r][c] += world.m[r][3];
+			}
+		}
+		const Vec3* in[3] = { &v.pos, &v.normal, &v.tangent };
+		double* out[3] = { pos, normal, tangent };
+		for (int n = 0; n < 3; n++) {
+			for (int r = 0; r < 3; r++)
+				out[n][r] = m[r][0] * in[n]->v[0] + m[r][1] * in[n]->v[1] + m[r][2] * in[n]->v[2] + (n == 0 ? m[r][3] : 0.0);
+			if (n == 0) continue;
+			double length = sqrt(out[n][0] * out[n][0] + out[n][1] * out[n][1] + out[n][2] * out[n][2]);
+			for (int r = 0; r < 3; r++) out[n][r] /= length;
+		}
+	}
+
+	struct SkinErrors {
+		double position = 0.0;	// relative to the largest reference coordinate
+		double direction = 0.0;
+	};
+
+	SkinErrors compare(const Mat4* bones, const Mat4& world, const std::vector<ANIMATED_VERTEX>& vertices, const std::vector<STATIC_VERTEX>& skinned)
+	{
+		SkinErrors errors;
+		double scale = 1.0;
+		for (size_t i = 0; i < vertices.size(); i++) {
+			double pos[3], normal[3], tangent[3];
+			referenceSkin(bones, world, vertices[i], pos, normal, tangent);
+			for (int r = 0; r < 3; r++) {
+				errors.position = max(errors.position, fabs(skinned[i].pos.v[r] - pos[r]));
+				scale = max(scale, fabs(pos[r]));
+				errors.direction = max(errors.direction, fabs(skinned[i].normal.v[r] - normal[r]));
+				errors.direction = max(errors.direction, fabs(skinned[i].tangent.v[r] - tangent[r]));
+			}
+		}
+		errors.position /= scale;
+		return errors;
+	}
+
+	bool sameVertices(const std::vector<STATIC_VERTEX>& a, const std::vector<STATIC_VERTEX>& b)
+	{
+		return a.size() == b.size() && memcmp(a.data(), b.data(), a.size() * sizeof(STATIC_VERTEX)) == 0;
+	}
+
+	void checkModel(const char* name)
+	{
+		Animation animation;
+		std::vector<GEMLoader::GEMMesh> meshes;
+		if (!EngineModels::load(name, animation, &meshes))
+			return;
+		std::vector<ANIMATED_VERTEX> vertices = EngineModels::animatedVertices(meshes);
+		int count = (int)vertices.size();
+		AnimationInstance instance;
+		instance.animation = &animation;
+		instance.update(EngineModels::longestClip(animation), 0.37f);
+		const Mat4* bones = instance.getBoneMatrices();
+		int boneCount = animation.bonesSize();
+
+		SkinPalette palette;
+		palette.set(bones, boneCount);
+		std::vector<STATIC_VERTEX> skinned(count);
+		Skinning::skin(palette, vertices.data(), skinned.data(), 0, count);
+		SkinErrors errors = compare(bones, Mat4(), vertices, skinned);
+		printf("  %s: %d vertices, %d bones\n", name, count, boneCount);
+		CHECK_BOUND("skin, position", errors.position, 1e-6);
+		CHECK_BOUND("skin, normal and tangent", errors.direction, 1e-6);
+		bool uvs = true;
+		for (int i = 0; i < count; i++)
+			uvs = uvs && skinned[i].uv[0] == vertices[i].uv[0] && skinned[i].uv[1] == vertices[i].uv[1];
+		CHECK(uvs);
+
+		// world space palette
+		Mat4 world = Mat4::Translate(3.0f, -1.0f, 12.0f) * Mat4::Rotate(35.0f, Vec3(0.2f, 1.0f, 0.1f)) * Mat4::Scale(0.5f, 0.5f, 0.5f);
+		SkinPalette worldPalette;
+		worldPalette.set(bones, boneCount, world);
+		std::vector<STATIC_VERTEX> worldSkinned(count);
+		Skinning::skin(worldPalette, vertices.data(), worldSkinned.data(), 0, count);
+		SkinErrors worldErrors = compare(bones, world, vertices, worldSkinned);
+		CHECK_BOUND("skin with world, position", worldErrors.position, 1e-6);
+		CHECK_BOUND("skin with world, normal and tangent", worldErrors.direction, 1e-6);
+
+		// positions only must match the full kernel exactly
+		std::vector<Vec3> positions(count);
+		Skinning::skinPositions(palette, vertices.data(), positions.data(), 0, count);
+		bool samePositions = true;
+		for (int i = 0; i < count; i++)
+			samePositions = samePositions && memcmp(&positions[i], &skinned[i].pos, sizeof(Vec3)) == 0;
+		CHECK(samePositions);
+
+		// the model repeated until every thread gets several ranges' worth, then split 1 to 8 ways;
+		// ranges are independent so the result must be bit identical
+		std::vector<ANIMATED_VERTEX> crowd;
+		while ((int)crowd.size() < 8 * Skinning::minVerticesPerThread * 2)
+			crowd.insert(crowd.end(), vertices.begin(), vertices.end());
+		int crowdCount = (int)crowd.size();
+		std::vector<STATIC_VERTEX> single(crowdCount), threaded(crowdCount);
+		Skinning::skin(palette, crowd.data(), single.data(), 0, crowdCount);
+		std::vector<Vec3> singlePositions(crowdCount), threadedPositions(crowdCount);
+		Skinning::skinPositions(palette, crowd.data(), singlePositions.data(), 0, crowdCount);
+		for (int threads = 1; threads <= 8; threads++) {
+			memset(threaded.data(), 0, threaded.size() * sizeof(STATIC_VERTEX));
+			Skinning::skinParallel(palette, crowd.data(), threaded.data(), crowdCount, threads);
+			CHECK(sameVertices(single, threaded));
+			memset(threadedPositions.data(), 0, threadedPositions.size() * sizeof(Vec3));
+			Skinning::skinPositionsParallel(palette, crowd.data(), threadedPositions.data(), crowdCount, threads);
+			CHECK(memcmp(singlePositions.data(), threadedPositions.data(), crowdCount * sizeof(Vec3)) == 0);
+		}
+	}
+}
+
+TEST_CASE(skinningHen)
+{
+	checkModel("Hen-white");
+}
+
+TEST_CASE(skinningFarmer)
+{
+	checkModel("Farmer-male");
+}
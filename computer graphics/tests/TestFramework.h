@@ -0,0 +1,95 @@
+#pragma once
+// Windows.h first, as in the app: the engine headers rely on its min/max macros
+#include <Windows.h>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <chrono>
+
+// Minimal test and benchmark runner for the headless targets. TEST_CASE registers a function,
+// CHECK and CHECK_BOUND record failures without stopping the case, and runAll runs every case
+// whose name contains the first command line argument (all of them without one).
+namespace Test {
+	struct Case {
+		const char* name;
+		void (*run)();
+	};
+
+	inline std::vector<Case>& cases()
+	{
+		static std::vector<Case> all;
+		return all;
+	}
+
+	inline int failures = 0;
+	inline bool quick = false;	// --quick: benchmarks run a fraction of their iterations
+
+	struct Register {
+		Register(const char* name, void (*run)()) { cases().push_back({ name, run }); }
+	};
+
+	inline void fail(const char* file, int line, const std::string& message)
+	{
+		failures++;
+		printf("  FAILED %s:%d: %s\n", file, line, message.c_str());
+	}
+
+	// worst error seen against its bound, printed so regressions show before they fail
+	inline bool checkBound(const char* file, int line, const char* what, double error, double bound)
+	{
+		bool ok = error <= bound;
+		if (!ok)
+			fail(file, line, std::string(what) + " = " + std::to_string(error) + " exceeds " + std::to_string(bound));
+		else
+			printf("  %-48s %.3g (bound %.3g)\n", what, error, bound);
+		return ok;
+	}
+
+	// iterations scaled down under --quick, at least one
+	inline int iterations(int full)
+	{
+		int n = quick ? full / 20 : full;
+		return n > 0 ? n : 1;
+	}
+
+	// seconds taken by work()
+	template<typename Work>
+	double seconds(Work work)
+	{
+		auto start = std::chrono::steady_clock::now();
+		work();
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	inline int runAll(int argc, char** argv)
+	{
+		const char* filter = nullptr;
+		for (int i = 1; i < argc; i++) {
+			if (strcmp(argv[i], "--quick") == 0) quick = true;
+			else filter = argv[i];
+		}
+		int run = 0;
+		for (const Case& c : cases()) {
+			if (filter != nullptr && strstr(c.name, filter) == nullptr) continue;
+			printf("[%s]\n", c.name);
+			int before = failures;
+			c.run();
+			printf("[%s] %s\n", c.name, failures == before ? "ok" : "FAILED");
+			run++;
+		}
+		printf("%d cases, %d failures\n", run, failures);
+		return failures == 0 && run > 0 ? 0 : 1;
+	}
+}
+
+#define TEST_CASE(name) \
+	static void name(); \
+	static Test::Register name##Registration(#name, name); \
+	static void name()
+
+#define CHECK(condition) \
+	do { if (!(condition)) Test::fail(__FILE__, __LINE__, #condition); } while (0)
+
+#define CHECK_BOUND(what, error, bound) Test::checkBound(__FILE__, __LINE__, what, error, bound)
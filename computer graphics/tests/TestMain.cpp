@@ -0,0 +1,27 @@
+#include "TestFramework.h"
+#include "SIMD.h"
+
+int main(int argc, char** argv)
+{
+#if defined(MATH_SIMD_AVX)
+	const char* simd = "AVX";
+#if defined(__GNUC__)
+	// built for AVX on a machine without it; ctest reports the skip
+	if (!__builtin_cpu_supports("avx")) {
+		printf("skipped: this CPU has no AVX\n");
+		return 77;
+	}
+#endif
+#elif defined(MATH_SIMD_SSE)
+	const char* simd = "SSE";
+#else
+	const char* simd = "scalar";
+#endif
+#ifdef MATH_PRECISE
+	const char* fastMath = "CRT (MATH_PRECISE)";
+#else
+	const char* fastMath = "polynomial";
+#endif
+	printf("SIMD path %s, FastMath %s\n", simd, fastMath);
+	return Test::runAll(argc, argv);
+}
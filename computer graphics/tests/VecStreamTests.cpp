@@ -0,0 +1,278 @@
+#include "TestFramework.h"
+#include "VectorStream.h"
+
+// VecStream's kernels against the same operation on each Vec3 or Vec4 in turn, for counts that
+// leave a partial register at the end in SSE (4 lanes) and AVX (8 lanes) builds. After every
+// operation the lanes past count must still be zero, the invariant the next kernel relies on.
+namespace {
+	struct Random {
+		unsigned int seed;
+		// uniform in [lo, hi)
+		float next(float lo, float hi)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			return lo + (hi - lo) * ((float)(seed >> 8) / 16777216.0f);
+		}
+	};
+
+	const int counts[] = { 1, 3, 4, 5, 7, 8, 9, 13, 31, 100 };
+
+	template<int N>
+	std::vector<typename VecStream<N>::VecType> randomVectors(Random& random, int count)
+	{
+		std::vector<typename VecStream<N>::VecType> v(count);
+		for (int i = 0; i < count; i++)
+			for (int k = 0; k < N; k++)
+				v[i].v[k] = random.next(-10.0f, 10.0f);
+		return v;
+	}
+
+	// every lane from count to the allocated capacity is zero
+	template<int N>
+	bool paddingZero(const VecStream<N>& s)
+	{
+		for (int k = 0; k < N; k++)
+			for (int i = s.count; i < s.capacity; i++)
+				if (s.c[k][i] != 0.0f)
+					return false;
+		return true;
+	}
+
+	// error relative to the reference, absolute below 1
+	double relative(float value, float ref)
+	{
+		double scale = fabs(ref) > 1.0 ? fabs(ref) : 1.0;
+		return fabs((double)value - ref) / scale;
+	}
+
+	template<int N>
+	double streamError(const VecStream<N>& s, const std::vector<typename VecStream<N>::VecType>& ref)
+	{
+		double error = 0.0;
+		for (int i = 0; i < s.count; i++) {
+			typename VecStream<N>::VecType v = s.get(i);
+			for (int k = 0; k < N; k++)
+				error = max(error, relative(v.v[k], ref[i].v[k]));
+		}
+		return error;
+	}
+
+	double floatError(const FloatStream& s, const std::vector<float>& ref)
+	{
+		double error = 0.0;
+		for (int i = 0; i < s.count; i++)
+			error = max(error, relative(s.get(i), ref[i]));
+		return error;
+	}
+
+	// worst error per operation over every count, and whether the padding stayed clean throughout
+	struct Errors {
+		double add = 0.0, sub = 0.0, scale = 0.0, madd = 0.0, dot = 0.0, length = 0.0, normalize = 0.0;
+		double minimum = 0.0, maximum = 0.0, bounds = 0.0;
+		bool padding = true;
+		bool sizes = true;
+	};
+
+	template<int N>
+	void checkCount(Random& random, int count, Errors& e)
+	{
+		typedef typename VecStream<N>::VecType V;
+		std::vector<V> va = randomVectors<N>(random, count);
+		std::vector<V> vb = randomVectors<N>(random, count);
+		VecStream<N> a, b, out;
+		a.fromVector(va);
+		b.fromVector(vb);
+		FloatStream scalars;
+		float s = random.next(-3.0f, 3.0f);
+		std::vector<V> ref(count);
+		std::vector<float> refScalars(count);
+
+		VecStream<N>::add(a, b, out);
+		for (int i = 0; i < count; i++) ref[i] = va[i] + vb[i];
+		e.add = max(e.add, streamError(out, ref));
+		e.padding = e.padding && paddingZero(out);
+		e.sizes = e.sizes && out.count == count;
+
+		VecStream<N>::sub(a, b, out);
+		for (int i = 0; i < count; i++) ref[i] = va[i] - vb[i];
+		e.sub = max(e.sub, streamError(out, ref));
+		e.padding = e.padding && paddingZero(out);
+
+		VecStream<N>::scale(a, s, out);
+		for (int i = 0; i < count; i++) ref[i] = va[i] * s;
+		e.scale = max(e.scale, streamError(out, ref));
+		e.padding = e.padding && paddingZero(out);
+
+		// FMA builds round once instead of twice
+		VecStream<N>::madd(a, b, s, out);
+		for (int i = 0; i < count; i++) ref[i] = va[i] + vb[i] * s;
+		e.madd = max(e.madd, streamError(out, ref));
+		e.padding = e.padding && paddingZero(out);
+
+		VecStream<N>::dot(a, b, scalars);
+		for (int i = 0; i < count; i++) refScalars[i] = va[i].Dot(vb[i]);
+		e.dot = max(e.dot, floatError(scalars, refScalars));
+		e.padding = e.padding && paddingZero(scalars);
+		e.sizes = e.sizes && scalars.count == count;
+
+		VecStream<N>::length(a, scalars);
+		for (int i = 0; i < count; i++) refScalars[i] = va[i].getLength();
+		e.length = max(e.length, floatError(scalars, refScalars));
+		e.padding = e.padding && paddingZero(scalars);
+
+		VecStream<N>::normalize(a, out);
+		for (int i = 0; i < count; i++) ref[i] = va[i].normalize();
+		e.normalize = max(e.normalize, streamError(out, ref));
+		e.padding = e.padding && paddingZero(out);
+
+		VecStream<N>::minimum(a, b, out);
+		for (int i = 0; i < count; i++)
+			for (int k = 0; k < N; k++)
+				ref[i].v[k] = va[i].v[k] < vb[i].v[k] ? va[i].v[k] : vb[i].v[k];
+		e.minimum = max(e.minimum, streamError(out, ref));
+		e.padding = e.padding && paddingZero(out);
+
+		VecStream<N>::maximum(a, b, out);
+		for (int i = 0; i < count; i++)
+			for (int k = 0; k < N; k++)
+				ref[i].v[k] = va[i].v[k] > vb[i].v[k] ? va[i].v[k] : vb[i].v[k];
+		e.maximum = max(e.maximum, streamError(out, ref));
+		e.padding = e.padding && paddingZero(out);
+
+		// bounds must ignore the zero padding, so all-positive and all-negative data are both tried
+		for (float offset : { 20.0f, -20.0f }) {
+			std::vector<V> shifted = va;
+			for (V& v : shifted)
+				for (int k = 0; k < N; k++)
+					v.v[k] += offset;
+			VecStream<N> stream;
+			stream.fromVector(shifted);
+			V lo, hi;
+			stream.bounds(lo, hi);
+			for (int k = 0; k < N; k++) {
+				float refLo = shifted[0].v[k], refHi = shifted[0].v[k];
+				for (const V& v : shifted) {
+					refLo = v.v[k] < refLo ? v.v[k] : refLo;
+					refHi = v.v[k] > refHi ? v.v[k] : refHi;
+				}
+				e.bounds = max(e.bounds, relative(lo.v[k], refLo));
+				e.bounds = max(e.bounds, relative(hi.v[k], refHi));
+			}
+		}
+
+		// in place, the output aliasing the first input
+		VecStream<N> alias = a;
+		VecStream<N>::add(alias, b, alias);
+		for (int i = 0; i < count; i++) ref[i] = va[i] + vb[i];
+		e.add = max(e.add, streamError(alias, ref));
+		e.padding = e.padding && paddingZero(alias);
+	}
+
+	template<int N>
+	void checkOperations(const char* name, unsigned int seed)
+	{
+		Random random{ seed };
+		Errors e;
+		for (int count : counts)
+			checkCount<N>(random, count, e);
+		std::string prefix = std::string(name) + " ";
+		CHECK_BOUND((prefix + "add").c_str(), e.add, 0.0);
+		CHECK_BOUND((prefix + "sub").c_str(), e.sub, 0.0);
+		CHECK_BOUND((prefix + "scale").c_str(), e.scale, 0.0);
+		CHECK_BOUND((prefix + "madd").c_str(), e.madd, 1e-6);
+		CHECK_BOUND((prefix + "dot").c_str(), e.dot, 1e-6);
+		CHECK_BOUND((prefix + "length").c_str(), e.length, 1e-6);
+		// one Newton step on the reciprocal square root estimate in SIMD builds
+		CHECK_BOUND((prefix + "normalize").c_str(), e.normalize, 1e-6);
+		CHECK_BOUND((prefix + "minimum").c_str(), e.minimum, 0.0);
+		CHECK_BOUND((prefix + "maximum").c_str(), e.maximum, 0.0);
+		CHECK_BOUND((prefix + "bounds").c_str(), e.bounds, 0.0);
+		CHECK(e.padding);
+		CHECK(e.sizes);
+	}
+}
+
+TEST_CASE(vecStreamOperations)
+{
+	printf("  SIMD width %d\n", SIMD::width);
+	checkOperations<3>("Vec3Stream", 3u);
+	checkOperations<4>("Vec4Stream", 4u);
+}
+
+TEST_CASE(vecStreamCross)
+{
+	Random random{ 5u };
+	double error = 0.0;
+	bool padding = true;
+	for (int count : counts) {
+		std::vector<Vec3> va = randomVectors<3>(random, count);
+		std::vector<Vec3> vb = randomVectors<3>(random, count);
+		Vec3Stream a, b, out;
+		a.fromVector(va);
+		b.fromVector(vb);
+		Vec3Stream::cross(a, b, out);
+		std::vector<Vec3> ref(count);
+		for (int i = 0; i < count; i++) ref[i] = va[i].cross(vb[i]);
+		error = max(error, streamError(out, ref));
+		padding = padding && paddingZero(out);
+	}
+	CHECK_BOUND("Vec3Stream cross", error, 1e-6);
+	CHECK(padding);
+}
+
+TEST_CASE(vecStreamNormalizeZero)
+{
+	// zero-length vectors scattered through full and partial registers stay zero, as with Vec3
+	for (int count : counts) {
+		Vec3Stream a(count), out;
+		for (int i = 0; i < count; i++)
+			if (i % 3 != 0)
+				a.set(i, Vec3(1.0f, -2.0f, 2.0f) * (float)i);
+		Vec3Stream::normalize(a, out);
+		bool zeros = true, units = true;
+		for (int i = 0; i < count; i++) {
+			Vec3 v = out.get(i);
+			if (i % 3 == 0)
+				zeros = zeros && v.v[0] == 0.0f && v.v[1] == 0.0f && v.v[2] == 0.0f;
+			else
+				units = units && fabsf(v.getLength() - 1.0f) < 1e-5f;
+		}
+		CHECK(zeros);
+		CHECK(units);
+		CHECK(paddingZero(out));
+	}
+	Vec4Stream zero4(5), out4;
+	Vec4Stream::normalize(zero4, out4);
+	bool zeros4 = true;
+	for (int i = 0; i < 5; i++)
+		zeros4 = zeros4 && out4.get(i).getLength() == 0.0f;
+	CHECK(zeros4);
+}
+
+TEST_CASE(vecStreamRoundTrip)
+{
+	Random random{ 9u };
+	for (int count : counts) {
+		std::vector<Vec3> v3 = randomVectors<3>(random, count);
+		std::vector<Vec4> v4 = randomVectors<4>(random, count);
+		Vec3Stream s3;
+		Vec4Stream s4;
+		s3.fromVector(v3);
+		s4.fromVector(v4);
+		std::vector<Vec3> back3 = s3.toVector();
+		std::vector<Vec4> back4 = s4.toVector();
+		CHECK(back3.size() == v3.size() && memcmp(back3.data(), v3.data(), count * sizeof(Vec3)) == 0);
+		CHECK(back4.size() == v4.size() && memcmp(back4.data(), v4.data(), count * sizeof(Vec4)) == 0);
+		CHECK(paddingZero(s3) && paddingZero(s4));
+
+		// push_back growth, copies and shrinking keep the elements and clear what is dropped
+		Vec3Stream pushed;
+		for (const Vec3& v : v3)
+			pushed.push_back(v);
+		Vec3Stream copy = pushed;
+		std::vector<Vec3> backPushed = copy.toVector();
+		CHECK(memcmp(backPushed.data(), v3.data(), count * sizeof(Vec3)) == 0);
+		copy.resize(count / 2);
+		CHECK(copy.count == count / 2 && paddingZero(copy));
+	}
+}
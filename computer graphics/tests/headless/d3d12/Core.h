@@ -0,0 +1,150 @@
+#pragma once
+// Stand-in for the D3D12 device, so Mesh.h and Actor.h build headless. Buffers are plain memory:
+// uploads and maps go to host bytes and draws are only counted.
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+typedef unsigned int UINT;
+typedef long HRESULT;
+typedef uint64_t D3D12_GPU_VIRTUAL_ADDRESS;
+
+enum { D3D12_APPEND_ALIGNED_ELEMENT = 0xffffffff };
+enum { D3D12_HEAP_FLAG_NONE = 0, D3D12_RESOURCE_FLAG_NONE = 0 };
+
+enum DXGI_FORMAT {
+	DXGI_FORMAT_UNKNOWN,
+	DXGI_FORMAT_R32G32B32A32_FLOAT,
+	DXGI_FORMAT_R32G32B32A32_UINT,
+	DXGI_FORMAT_R32G32B32_FLOAT,
+	DXGI_FORMAT_R32G32_FLOAT,
+	DXGI_FORMAT_R32_UINT
+};
+
+enum D3D12_INPUT_CLASSIFICATION {
+	D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA,
+	D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA
+};
+
+struct D3D12_INPUT_ELEMENT_DESC {
+	const char* SemanticName;
+	UINT SemanticIndex;
+	DXGI_FORMAT Format;
+	UINT InputSlot;
+	UINT AlignedByteOffset;
+	D3D12_INPUT_CLASSIFICATION InputSlotClass;
+	UINT InstanceDataStepRate;
+};
+
+struct D3D12_INPUT_LAYOUT_DESC {
+	const D3D12_INPUT_ELEMENT_DESC* pInputElementDescs;
+	UINT NumElements;
+};
+
+enum D3D12_HEAP_TYPE { D3D12_HEAP_TYPE_DEFAULT, D3D12_HEAP_TYPE_UPLOAD };
+
+struct D3D12_HEAP_PROPERTIES {
+	D3D12_HEAP_TYPE Type;
+	UINT CreationNodeMask;
+	UINT VisibleNodeMask;
+	D3D12_HEAP_PROPERTIES() {}
+	D3D12_HEAP_PROPERTIES(D3D12_HEAP_TYPE type) : Type(type) {}
+};
+
+enum D3D12_RESOURCE_DIMENSION { D3D12_RESOURCE_DIMENSION_BUFFER };
+enum D3D12_TEXTURE_LAYOUT { D3D12_TEXTURE_LAYOUT_ROW_MAJOR };
+
+enum D3D12_RESOURCE_STATES {
+	D3D12_RESOURCE_STATE_COMMON,
+	D3D12_RESOURCE_STATE_GENERIC_READ,
+	D3D12_RESOURCE_STATE_INDEX_BUFFER,
+	D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER
+};
+
+struct DXGI_SAMPLE_DESC {
+	UINT Count;
+	UINT Quality;
+};
+
+struct D3D12_RESOURCE_DESC {
+	D3D12_RESOURCE_DIMENSION Dimension;
+	uint64_t Alignment;
+	uint64_t Width;
+	UINT Height;
+	UINT DepthOrArraySize;
+	UINT MipLevels;
+	DXGI_FORMAT Format;
+	DXGI_SAMPLE_DESC SampleDesc;
+	D3D12_TEXTURE_LAYOUT Layout;
+	int Flags;
+};
+
+struct D3D12_VERTEX_BUFFER_VIEW {
+	D3D12_GPU_VIRTUAL_ADDRESS BufferLocation;
+	UINT SizeInBytes;
+	UINT StrideInBytes;
+};
+
+struct D3D12_INDEX_BUFFER_VIEW {
+	D3D12_GPU_VIRTUAL_ADDRESS BufferLocation;
+	UINT SizeInBytes;
+	DXGI_FORMAT Format;
+};
+
+enum D3D_PRIMITIVE_TOPOLOGY { D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST };
+
+#define IID_PPV_ARGS(resource) (resource)
+
+struct ID3D12Resource {
+	std::vector<unsigned char> bytes;
+
+	D3D12_GPU_VIRTUAL_ADDRESS GetGPUVirtualAddress()
+	{
+		return (D3D12_GPU_VIRTUAL_ADDRESS)bytes.data();
+	}
+
+	HRESULT Map(int subresource, const void* range, void** data)
+	{
+		*data = bytes.data();
+		return 0;
+	}
+};
+
+struct ID3D12Device {
+	HRESULT CreateCommittedResource(const D3D12_HEAP_PROPERTIES* heap, int flags, const D3D12_RESOURCE_DESC* desc, D3D12_RESOURCE_STATES state, const void* clear, ID3D12Resource** resource)
+	{
+		*resource = new ID3D12Resource();
+		(*resource)->bytes.resize(desc->Width);
+		return 0;
+	}
+};
+
+struct ID3D12GraphicsCommandList {
+	int draws = 0;
+
+	void IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY topology) {}
+	void IASetVertexBuffers(UINT slot, UINT count, const D3D12_VERTEX_BUFFER_VIEW* views) {}
+	void IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW* view) {}
+
+	void DrawIndexedInstanced(UINT indices, UINT instances, UINT firstIndex, int baseVertex, UINT firstInstance)
+	{
+		draws++;
+	}
+};
+
+class Core {
+public:
+	ID3D12Device deviceStub;
+	ID3D12Device* device = &deviceStub;
+	ID3D12GraphicsCommandList commandList;
+
+	ID3D12GraphicsCommandList* getCommandList()
+	{
+		return &commandList;
+	}
+
+	void uploadResource(ID3D12Resource* resource, const void* data, size_t size, D3D12_RESOURCE_STATES state)
+	{
+		memcpy(resource->bytes.data(), data, size);
+	}
+};
@@ -0,0 +1,8 @@
+#pragma once
+// Stand-in for textures, which headless builds never load.
+class Core;
+
+class Image {
+public:
+	void apply(Core* core, int slot) {}
+};
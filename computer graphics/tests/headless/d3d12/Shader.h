@@ -0,0 +1,31 @@
+#pragma once
+// Stand-in for the shader and PSO tables: constant buffer updates are dropped.
+#include <string>
+#include <map>
+
+enum ShaderType { VERTEX_SHADER, PIXEL_SHADER };
+
+#define DIFFUSE_TEXTURE_SLOT 0
+#define NORMAL_TEXTURE_SLOT 1
+
+class Core;
+
+class Shader {
+public:
+	void updateAllConstantBuffers() {}
+	void updateConstantBuffer(const std::string& buffer, const std::string& variable, const void* data, ShaderType type) {}
+	void updateConstantBuffer(const std::string& buffer, const std::string& variable, const void* data, unsigned int size, ShaderType type) {}
+};
+
+class PSOManager {
+public:
+	std::map<std::string, Shader> shaders;
+
+	Shader* getShader(const std::string& name)
+	{
+		return &shaders[name];
+	}
+
+	void set(Core* core, const std::string& name) {}
+	void advance(const std::string& name) {}
+};
@@ -0,0 +1,18 @@
+#pragma once
+// Stand-in for the Win32 window: only the input state actors and the camera read.
+#include <string>
+
+#ifndef VK_SHIFT
+#define VK_SHIFT 0x10
+#endif
+
+class Window {
+public:
+	std::string name;
+	int width = 0;
+	int height = 0;
+	bool keys[256] = { false };
+	bool mouseButtons[3] = { false };
+	int mousex = 0;
+	int mousey = 0;
+};
@@ -0,0 +1,53 @@
+#pragma once
+// Stand-in for the handful of Win32 names the engine headers use, so the tests build off Windows.
+// The standard headers go in before min/max are defined, as they would behind the real Windows.h.
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <typeindex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+typedef void* HWND;
+typedef void* HINSTANCE;
+typedef long LRESULT;
+typedef unsigned int UINT;
+typedef uintptr_t WPARAM;
+typedef intptr_t LPARAM;
+#define CALLBACK
+#define LOWORD(l) ((unsigned short)((uintptr_t)(l) & 0xffff))
+#define HIWORD(l) ((unsigned short)(((uintptr_t)(l) >> 16) & 0xffff))
+#define VK_SHIFT 0x10
+
+#ifndef max
+#define max(a, b) (((a) > (b)) ? (a) : (b))
+#endif
+#ifndef min
+#define min(a, b) (((a) < (b)) ? (a) : (b))
+#endif
+
+inline void OutputDebugStringA(const char* message)
+{
+	fputs(message, stderr);
+}